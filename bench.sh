@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Times jingle's -format modes against the binutils tools they reproduce, over every ELF file under a directory
+# (default /usr/lib), and checks that both print the same bytes.
+#
+#   ./bench.sh [DIR]
+
+set -e
+
+dir=${1:-/usr/lib}
+export LC_ALL=C
+
+./build.sh
+
+files=$(mktemp)
+a=$(mktemp)
+b=$(mktemp)
+trap 'rm -f "$files" "$a" "$b"' EXIT
+
+find "$dir" -type f -size +0 -print0 | xargs -0 file -N --mime-type | grep -E ': application/x-(sharedlib|executable|pie-executable|object)$' | cut -d: -f1 > "$files"
+echo "$(wc -l < "$files") ELF files, $(xargs du -cb < "$files" | tail -1 | cut -f1) bytes under $dir"
+
+run() {
+    local what=$1 ref=$2 ours=$3
+    local start=$(date +%s.%N)
+    xargs -n 256 $ref < "$files" > "$a" 2>/dev/null || true
+    local mid=$(date +%s.%N)
+    xargs -n 256 ./main $ours < "$files" > "$b" 2>/dev/null || true
+    local end=$(date +%s.%N)
+
+    local same=identical
+    cmp -s "$a" "$b" || same=DIFFERENT
+    awk -v what="$what" -v s="$start" -v m="$mid" -v e="$end" -v same="$same" \
+        'BEGIN { printf "%-14s binutils %7.2fs  jingle %7.2fs  %5.1fx  output %s\n", what, m - s, e - m, (m - s) / (e - m), same }'
+}
+
+run "readelf -sW"    "readelf -sW"    "--format readelf --syms"
+run "readelf -rW"    "readelf -rW"    "--format readelf --reloc"
+run "readelf -hSW"   "readelf -hSW"   "--format readelf --header --sections"
+run "readelf -hSrsW" "readelf -hSrsW" "--format readelf --header --sections --reloc --syms"
+run "nm -P"          "nm -P"          "--format nm"
@@ -2,4 +2,4 @@
 
 set -xe
 
-gcc -Wall -o main main.c
+gcc -Wall -pthread -o main main.c -lz
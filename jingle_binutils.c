@@ -0,0 +1,845 @@
+#ifndef JINGLE_BINUTILS_C_
+#define JINGLE_BINUTILS_C_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <elf.h>
+
+// Not in every elf.h
+#define JINGLE_VERSYM_VERSION     0x7fff
+#define JINGLE_VERSYM_HIDDEN      0x8000
+#define JINGLE_SHN_X86_64_LCOMMON 0xff02
+
+
+/// Output in the formats of GNU readelf -W (-h, -S, -r, -s) and nm -P, byte for byte as binutils 2.40 prints them,
+/// so scripts parsing those tools can run on jingle instead.
+///
+/// Everything is printed from the normalized Elf64 views, except the few tables the reader has no view for
+/// (symbol versions, the dynamic section, RELR), which are read here straight from the file. Machine specific
+/// parts (e_flags decoding, processor specific section types) are only covered for x86. nm sorts names with
+/// strcmp, which is what it does under LC_ALL=C.
+
+static bool
+jingle_is_32(Jingle_File *jf)
+{
+    return (unsigned char)jf->file.data[EI_CLASS] == ELFCLASS32;
+}
+
+/// Reads an unsigned field of size bytes in the file's byte order
+static uint64_t
+jingle_file_word(Jingle_File *jf, const unsigned char *p, size_t size)
+{
+    bool msb = (unsigned char)jf->file.data[EI_DATA] == ELFDATA2MSB;
+    uint64_t v = 0;
+    for (size_t i = 0; i < size; ++i) v |= (uint64_t)p[msb ? size - 1 - i : i] << (8*i);
+    return v;
+}
+
+/// The bytes of section i, NULL for NOBITS sections or ones that don't fit in the file
+static const unsigned char *
+jingle_file_section(Jingle_File *jf, size_t i, size_t *size)
+{
+    Elf64_Shdr *sh = &jf->shdrs[i];
+    if (sh->sh_type == SHT_NOBITS || sh->sh_offset > jf->file.count || sh->sh_size > jf->file.count - sh->sh_offset) return NULL;
+    *size = sh->sh_size;
+    return (const unsigned char *)jf->file.data + sh->sh_offset;
+}
+
+static const char *
+jingle_shstr(Jingle_File *jf, uint32_t name)
+{
+    Elf64_Shdr *sh = &jf->shdrs[jf->ehdr->e_shstrndx];
+    if (name >= sh->sh_size) return "<corrupt>";
+    return jf->file.data + sh->sh_offset + name;
+}
+
+/// Like binutils' print_symbol in wide mode: control characters come out as ^X. Returns the number of columns.
+static int
+jingle_put_printable(const char *s, FILE *out)
+{
+    int n = 0;
+    for (; *s; ++s) {
+        unsigned char c = *s;
+        if (c < 0x20 || c == 0x7f) {
+            fputc('^', out);
+            fputc(c == 0x7f ? '?' : c + 0x40, out);
+            n += 2;
+        } else {
+            fputc(c, out);
+            n += 1;
+        }
+    }
+    return n;
+}
+
+/// File header
+
+static const char *
+jingle_readelf_osabi(unsigned char osabi, char *buf, size_t size)
+{
+    switch (osabi) {
+    case ELFOSABI_NONE:       return "UNIX - System V";
+    case ELFOSABI_HPUX:       return "UNIX - HP-UX";
+    case ELFOSABI_NETBSD:     return "UNIX - NetBSD";
+    case ELFOSABI_GNU:        return "UNIX - GNU";
+    case ELFOSABI_SOLARIS:    return "UNIX - Solaris";
+    case ELFOSABI_AIX:        return "UNIX - AIX";
+    case ELFOSABI_IRIX:       return "UNIX - IRIX";
+    case ELFOSABI_FREEBSD:    return "UNIX - FreeBSD";
+    case ELFOSABI_TRU64:      return "UNIX - TRU64";
+    case ELFOSABI_MODESTO:    return "Novell - Modesto";
+    case ELFOSABI_OPENBSD:    return "UNIX - OpenBSD";
+    case 13:                  return "VMS - OpenVMS";
+    case 14:                  return "HP - Non-Stop Kernel";
+    case 15:                  return "AROS";
+    case 16:                  return "FenixOS";
+    case 17:                  return "Nuxi CloudABI";
+    case 18:                  return "Stratus Technologies OpenVOS";
+    default:
+        snprintf(buf, size, "<unknown: %x>", osabi);
+        return buf;
+    }
+}
+
+static const char *
+jingle_readelf_machine(uint16_t machine, char *buf, size_t size)
+{
+    switch (machine) {
+    case EM_NONE:        return "None";
+    case EM_M32:         return "WE32100";
+    case EM_SPARC:       return "Sparc";
+    case EM_386:         return "Intel 80386";
+    case EM_68K:         return "MC68000";
+    case EM_88K:         return "MC88000";
+    case EM_IAMCU:       return "Intel MCU";
+    case EM_860:         return "Intel 80860";
+    case EM_MIPS:        return "MIPS R3000";
+    case EM_S370:        return "IBM System/370";
+    case EM_MIPS_RS3_LE: return "MIPS R4000 big-endian";
+    case EM_PARISC:      return "HPPA";
+    case EM_SPARC32PLUS: return "Sparc v8+" ;
+    case EM_960:         return "Intel 80960";
+    case EM_PPC:         return "PowerPC";
+    case EM_PPC64:       return "PowerPC64";
+    case EM_S390:        return "IBM S/390";
+    case EM_SPU:         return "SPU";
+    case EM_ARM:         return "ARM";
+    case EM_SH:          return "Renesas / SuperH SH";
+    case EM_SPARCV9:     return "Sparc v9";
+    case EM_IA_64:       return "Intel IA-64";
+    case EM_X86_64:      return "Advanced Micro Devices X86-64";
+    case EM_AARCH64:     return "AArch64";
+    case EM_RISCV:       return "RISC-V";
+    case EM_BPF:         return "Linux BPF";
+    case 258:            return "LoongArch";
+    default:
+        snprintf(buf, size, "<unknown>: 0x%x", machine);
+        return buf;
+    }
+}
+
+/// DYN files are position independent executables if their dynamic section says so
+static bool
+jingle_is_pie(Jingle_File *jf)
+{
+    size_t entsize = jingle_is_32(jf) ? sizeof(Elf32_Dyn) : sizeof(Elf64_Dyn);
+    size_t word = entsize / 2;
+
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        size_t size;
+        const unsigned char *p;
+        if (jf->shdrs[i].sh_type != SHT_DYNAMIC || (p = jingle_file_section(jf, i, &size)) == NULL) continue;
+
+        for (size_t at = 0; at + entsize <= size; at += entsize) {
+            uint64_t tag = jingle_file_word(jf, p + at, word);
+            if (tag == DT_NULL) break;
+            if (tag == DT_FLAGS_1) return (jingle_file_word(jf, p + at + word, word) & DF_1_PIE) != 0;
+        }
+    }
+    return false;
+}
+
+static const char *
+jingle_readelf_type(Jingle_File *jf, char *buf, size_t size)
+{
+    uint16_t type = jf->ehdr->e_type;
+    switch (type) {
+    case ET_NONE: return "NONE (None)";
+    case ET_REL:  return "REL (Relocatable file)";
+    case ET_EXEC: return "EXEC (Executable file)";
+    case ET_DYN:  return jingle_is_pie(jf) ? "DYN (Position-Independent Executable file)" : "DYN (Shared object file)";
+    case ET_CORE: return "CORE (Core file)";
+    }
+    if (type >= ET_LOPROC) snprintf(buf, size, "Processor Specific: (%x)", type);
+    else if (type >= ET_LOOS && type <= ET_HIOS) snprintf(buf, size, "OS Specific: (%x)", type);
+    else snprintf(buf, size, "<unknown>: %x", type);
+    return buf;
+}
+
+/// readelf -hW
+void
+jingle_readelf_header(Jingle_File *jf, FILE *out)
+{
+    Elf64_Ehdr *eh = jf->ehdr;
+    const unsigned char *ident = (const unsigned char *)jf->file.data;
+    char buf[64];
+
+    fprintf(out, "ELF Header:\n");
+    fprintf(out, "  Magic:   ");
+    for (size_t i = 0; i < EI_NIDENT; ++i) fprintf(out, "%2.2x ", ident[i]);
+    fprintf(out, "\n");
+    fprintf(out, "  Class:                             %s\n", ident[EI_CLASS] == ELFCLASS32 ? "ELF32" : "ELF64");
+    fprintf(out, "  Data:                              %s\n", ident[EI_DATA] == ELFDATA2LSB ? "2's complement, little endian" : "2's complement, big endian");
+    fprintf(out, "  Version:                           %d%s\n", ident[EI_VERSION], ident[EI_VERSION] == EV_CURRENT ? " (current)" : ident[EI_VERSION] != EV_NONE ? " <unknown>" : "");
+    fprintf(out, "  OS/ABI:                            %s\n", jingle_readelf_osabi(ident[EI_OSABI], buf, sizeof(buf)));
+    fprintf(out, "  ABI Version:                       %d\n", ident[EI_ABIVERSION]);
+    fprintf(out, "  Type:                              %s\n", jingle_readelf_type(jf, buf, sizeof(buf)));
+    fprintf(out, "  Machine:                           %s\n", jingle_readelf_machine(eh->e_machine, buf, sizeof(buf)));
+    fprintf(out, "  Version:                           0x%x\n", eh->e_version);
+    fprintf(out, "  Entry point address:               0x%lx\n", eh->e_entry);
+    fprintf(out, "  Start of program headers:          %ld (bytes into file)\n", eh->e_phoff);
+    fprintf(out, "  Start of section headers:          %ld (bytes into file)\n", eh->e_shoff);
+    fprintf(out, "  Flags:                             0x%x\n", eh->e_flags);
+    fprintf(out, "  Size of this header:               %u (bytes)\n", eh->e_ehsize);
+    fprintf(out, "  Size of program headers:           %u (bytes)\n", eh->e_phentsize);
+    fprintf(out, "  Number of program headers:         %u\n", eh->e_phnum);
+    fprintf(out, "  Size of section headers:           %u (bytes)\n", eh->e_shentsize);
+    fprintf(out, "  Number of section headers:         %u\n", eh->e_shnum);
+    fprintf(out, "  Section header string table index: %u\n", eh->e_shstrndx);
+}
+
+/// Section headers
+
+static const char *
+jingle_readelf_section_type(Jingle_File *jf, uint32_t type, char *buf, size_t size)
+{
+    switch (type) {
+    case SHT_NULL:           return "NULL";
+    case SHT_PROGBITS:       return "PROGBITS";
+    case SHT_SYMTAB:         return "SYMTAB";
+    case SHT_STRTAB:         return "STRTAB";
+    case SHT_RELA:           return "RELA";
+    case SHT_RELR:           return "RELR";
+    case SHT_HASH:           return "HASH";
+    case SHT_DYNAMIC:        return "DYNAMIC";
+    case SHT_NOTE:           return "NOTE";
+    case SHT_NOBITS:         return "NOBITS";
+    case SHT_REL:            return "REL";
+    case SHT_SHLIB:          return "SHLIB";
+    case SHT_DYNSYM:         return "DYNSYM";
+    case SHT_INIT_ARRAY:     return "INIT_ARRAY";
+    case SHT_FINI_ARRAY:     return "FINI_ARRAY";
+    case SHT_PREINIT_ARRAY:  return "PREINIT_ARRAY";
+    case SHT_GNU_HASH:       return "GNU_HASH";
+    case SHT_GROUP:          return "GROUP";
+    case SHT_SYMTAB_SHNDX:   return "SYMTAB SECTION INDICES";
+    case SHT_GNU_verdef:     return "VERDEF";
+    case SHT_GNU_verneed:    return "VERNEED";
+    case SHT_GNU_versym:     return "VERSYM";
+    case 0x6ffffff0:         return "VERSYM";
+    case 0x6ffffffc:         return "VERDEF";
+    case 0x7ffffffd:         return "AUXILIARY";
+    case 0x7fffffff:         return "FILTER";
+    case SHT_GNU_LIBLIST:    return "GNU_LIBLIST";
+    case SHT_GNU_ATTRIBUTES: return "GNU_ATTRIBUTES";
+    case 0x6ffffff4:         return "GNU_SFRAME";
+    case 0x6fff4700:         return "GNU_INCREMENTAL_INPUTS";
+    }
+
+    if (type >= SHT_LOPROC && type <= SHT_HIPROC) {
+        uint16_t machine = jf->ehdr->e_machine;
+        if (machine == EM_X86_64 && type == SHT_X86_64_UNWIND) return "X86_64_UNWIND";
+        snprintf(buf, size, "LOPROC+%#x", type - SHT_LOPROC);
+    } else if (type >= SHT_LOOS && type <= SHT_HIOS) {
+        snprintf(buf, size, "LOOS+%#x", type - SHT_LOOS);
+    } else if (type >= SHT_LOUSER && type <= SHT_HIUSER) {
+        snprintf(buf, size, "LOUSER+%#x", type - SHT_LOUSER);
+    } else {
+        snprintf(buf, size, "<unknown>: %x", type);
+    }
+    return buf;
+}
+
+static const char *
+jingle_readelf_section_flags(Jingle_File *jf, uint64_t flags, char *buf)
+{
+    unsigned char osabi = jf->file.data[EI_OSABI];
+    uint16_t machine = jf->ehdr->e_machine;
+    bool os = false, proc = false, unknown = false;
+    char *p = buf;
+
+    while (flags) {
+        uint64_t flag = flags & -flags;
+        flags &= ~flag;
+
+        switch (flag) {
+        case SHF_WRITE:            *p++ = 'W'; break;
+        case SHF_ALLOC:            *p++ = 'A'; break;
+        case SHF_EXECINSTR:        *p++ = 'X'; break;
+        case SHF_MERGE:            *p++ = 'M'; break;
+        case SHF_STRINGS:          *p++ = 'S'; break;
+        case SHF_INFO_LINK:        *p++ = 'I'; break;
+        case SHF_LINK_ORDER:       *p++ = 'L'; break;
+        case SHF_OS_NONCONFORMING: *p++ = 'O'; break;
+        case SHF_GROUP:            *p++ = 'G'; break;
+        case SHF_TLS:              *p++ = 'T'; break;
+        case SHF_EXCLUDE:          *p++ = 'E'; break;
+        case SHF_COMPRESSED:       *p++ = 'C'; break;
+        default:
+            if ((machine == EM_X86_64) && flag == 0x10000000) {
+                *p++ = 'l';
+            } else if (flag & SHF_MASKOS) {
+                if ((osabi == ELFOSABI_GNU || osabi == ELFOSABI_FREEBSD) && flag == SHF_GNU_RETAIN) *p++ = 'R';
+                else if ((osabi == ELFOSABI_GNU || osabi == ELFOSABI_FREEBSD || osabi == ELFOSABI_NONE) && flag == 0x01000000) *p++ = 'D';
+                else os = true;
+            } else if (flag & SHF_MASKPROC) {
+                proc = true;
+            } else {
+                unknown = true;
+            }
+            break;
+        }
+    }
+    if (os) *p++ = 'o';
+    if (proc) *p++ = 'p';
+    if (unknown) *p++ = 'x';
+    *p = '\0';
+    return buf;
+}
+
+/// readelf -SW; after_header leaves out the line readelf only prints without -h
+void
+jingle_readelf_sections(Jingle_File *jf, bool after_header, FILE *out)
+{
+    Elf64_Ehdr *eh = jf->ehdr;
+    bool is32 = jingle_is_32(jf);
+    char buf[64];
+
+    if (eh->e_shnum == 0) {
+        fprintf(out, "\nThere are no sections in this file.\n");
+        return;
+    }
+    if (!after_header) {
+        fprintf(out, "There %s %d section header%s, starting at offset 0x%lx:\n", eh->e_shnum == 1 ? "is" : "are", eh->e_shnum, eh->e_shnum == 1 ? "" : "s", eh->e_shoff);
+    }
+
+    fprintf(out, "\nSection Header%s:\n", eh->e_shnum == 1 ? "" : "s");
+    if (is32) fprintf(out, "  [Nr] Name              Type            Addr     Off    Size   ES Flg Lk Inf Al\n");
+    else fprintf(out, "  [Nr] Name              Type            Address          Off    Size   ES Flg Lk Inf Al\n");
+
+    for (size_t i = 0; i < eh->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
+        char flags[32];
+
+        fprintf(out, "  [%2zu] ", i);
+        int n = jingle_put_printable(jingle_shstr(jf, sh->sh_name), out);
+        if (n < 17) fprintf(out, "%-*s", 17 - n, " ");
+        fprintf(out, " %-15s ", jingle_readelf_section_type(jf, sh->sh_type, buf, sizeof(buf)));
+        if (is32) fprintf(out, "%8.8lx", sh->sh_addr);
+        else fprintf(out, "%16.16lx", sh->sh_addr);
+        fprintf(out, " %6.6lx %6.6lx %2.2lx", sh->sh_offset, sh->sh_size, sh->sh_entsize);
+        fprintf(out, " %3s ", jingle_readelf_section_flags(jf, sh->sh_flags, flags));
+        fprintf(out, "%2u %3u %2lu\n", sh->sh_link, sh->sh_info, sh->sh_addralign);
+    }
+
+    unsigned char osabi = jf->file.data[EI_OSABI];
+    fprintf(out, "Key to Flags:\n");
+    fprintf(out, "  W (write), A (alloc), X (execute), M (merge), S (strings), I (info),\n");
+    fprintf(out, "  L (link order), O (extra OS processing required), G (group), T (TLS),\n");
+    fprintf(out, "  C (compressed), x (unknown), o (OS specific), E (exclude),\n  ");
+    if (osabi == ELFOSABI_GNU || osabi == ELFOSABI_FREEBSD) fprintf(out, "R (retain), ");
+    if (osabi == ELFOSABI_GNU || osabi == ELFOSABI_FREEBSD || osabi == ELFOSABI_NONE) fprintf(out, "D (mbind), ");
+    if (eh->e_machine == EM_X86_64) fprintf(out, "l (large), ");
+    else if (eh->e_machine == EM_ARM) fprintf(out, "y (purecode), ");
+    else if (eh->e_machine == EM_PPC) fprintf(out, "v (VLE), ");
+    fprintf(out, "p (processor specific)\n");
+}
+
+/// Symbol versions, from the GNU version sections of the file
+
+typedef struct {
+    const unsigned char *versym;
+    size_t versym_count;
+    const unsigned char *verdef;
+    size_t verdef_size;
+    const unsigned char *verneed;
+    size_t verneed_size;
+} Jingle_Versions;
+
+typedef enum {
+    JINGLE_VERSION_NONE,
+    JINGLE_VERSION_PUBLIC,    // name@@VERSION
+    JINGLE_VERSION_HIDDEN,    // name@VERSION
+    JINGLE_VERSION_UNDEFINED, // name@VERSION (n), from a needed library
+} Jingle_Version_Kind;
+
+static Jingle_Versions
+jingle_read_versions(Jingle_File *jf)
+{
+    Jingle_Versions v = {0};
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        size_t size;
+        const unsigned char *p = jingle_file_section(jf, i, &size);
+        if (p == NULL) continue;
+        switch (jf->shdrs[i].sh_type) {
+        case SHT_GNU_versym:  v.versym = p; v.versym_count = size / 2; break;
+        case SHT_GNU_verdef:  v.verdef = p; v.verdef_size = size; break;
+        case SHT_GNU_verneed: v.verneed = p; v.verneed_size = size; break;
+        }
+    }
+    return v;
+}
+
+/// The version of dynamic symbol index, the way readelf finds it: first among the definitions (for defined symbols),
+/// then among the needed versions. NULL if the symbol has none worth printing.
+static const char *
+jingle_symbol_version(Jingle_File *jf, Jingle_Versions *v, Elf64_Sym *sym, size_t index, const char *strtab, size_t strtab_size, Jingle_Version_Kind *kind, unsigned *other)
+{
+    *kind = JINGLE_VERSION_NONE;
+    if (v->versym == NULL || index >= v->versym_count) return NULL;
+
+    unsigned vers = jingle_file_word(jf, v->versym + 2*index, 2);
+    if (vers == 0) return NULL;
+
+    unsigned max_ndx = 0;
+    if (sym->st_shndx != SHN_UNDEF && vers != 0x8001 && v->verdef != NULL) {
+        // Elf_Verdef: vd_version, vd_flags, vd_ndx (2 bytes each), vd_cnt (2), vd_hash, vd_aux, vd_next (4 each)
+        size_t off = 0;
+        unsigned ndx = 0, flags = 0;
+        uint64_t next = 0, aux = 0;
+        do {
+            if (off + sizeof(Elf64_Verdef) > v->verdef_size) break;
+            const unsigned char *d = v->verdef + off;
+            flags = jingle_file_word(jf, d + 2, 2);
+            ndx = jingle_file_word(jf, d + 4, 2);
+            aux = jingle_file_word(jf, d + 12, 4);
+            next = jingle_file_word(jf, d + 16, 4);
+            if (ndx > max_ndx) max_ndx = ndx;
+            off += next;
+        } while (ndx != (vers & JINGLE_VERSYM_VERSION) && next != 0);
+
+        if (ndx == (vers & JINGLE_VERSYM_VERSION)) {
+            if (ndx == 1 && flags == VER_FLG_BASE) return NULL;
+            size_t at = off - next + aux;
+            if (at + sizeof(Elf64_Verdaux) <= v->verdef_size) {
+                uint64_t name = jingle_file_word(jf, v->verdef + at, 4);
+                if (sym->st_name != name) {
+                    *kind = vers & JINGLE_VERSYM_HIDDEN ? JINGLE_VERSION_HIDDEN : JINGLE_VERSION_PUBLIC;
+                    return name < strtab_size ? strtab + name : "<corrupt>";
+                }
+            }
+        }
+    }
+
+    if (v->verneed != NULL) {
+        // Elf_Verneed: vn_version, vn_cnt (2 each), vn_file, vn_aux, vn_next (4 each)
+        // Elf_Vernaux: vna_hash (4), vna_flags, vna_other (2 each), vna_name, vna_next (4 each)
+        size_t off = 0;
+        uint64_t vn_next = 0, name = 0;
+        unsigned vna_other = 0;
+        do {
+            if (off + sizeof(Elf64_Verneed) > v->verneed_size) break;
+            const unsigned char *n = v->verneed + off;
+            size_t at = off + jingle_file_word(jf, n + 8, 4);
+            vn_next = jingle_file_word(jf, n + 12, 4);
+            uint64_t vna_next = 0;
+            do {
+                if (at + sizeof(Elf64_Vernaux) > v->verneed_size) break;
+                const unsigned char *a = v->verneed + at;
+                vna_other = jingle_file_word(jf, a + 6, 2);
+                name = jingle_file_word(jf, a + 8, 4);
+                vna_next = jingle_file_word(jf, a + 12, 4);
+                at += vna_next;
+            } while (vna_other != vers && vna_next != 0);
+            if (vna_other == vers) break;
+            off += vn_next;
+        } while (vn_next != 0);
+
+        if (vna_other == vers) {
+            *kind = JINGLE_VERSION_UNDEFINED;
+            *other = vna_other;
+            return name < strtab_size ? strtab + name : "<corrupt>";
+        }
+        if ((max_ndx || (vers & JINGLE_VERSYM_VERSION) != 1) && (vers & JINGLE_VERSYM_VERSION) > max_ndx) return "<corrupt>";
+    }
+    return NULL;
+}
+
+/// Relocations
+
+static void
+jingle_readelf_relr(Jingle_File *jf, size_t shndx, FILE *out)
+{
+    size_t size;
+    const unsigned char *p = jingle_file_section(jf, shndx, &size);
+    size_t word = jingle_is_32(jf) ? 4 : 8;
+    if (p == NULL) return;
+
+    // An even entry is an address, an odd one a bitmap of the words following the last address
+    for (int pass = 0; pass < 2; ++pass) {
+        size_t count = 0;
+        uint64_t where = 0;
+        for (size_t at = 0; at + word <= size; at += word) {
+            uint64_t entry = jingle_file_word(jf, p + at, word);
+            if ((entry & 1) == 0) {
+                if (pass) fprintf(out, word == 4 ? "%8.8lx\n" : "%16.16lx\n", entry);
+                count++;
+                where = entry + word;
+                continue;
+            }
+            for (size_t bit = 1; bit < 8*word; ++bit) {
+                if (!((entry >> bit) & 1)) continue;
+                if (pass) fprintf(out, word == 4 ? "%8.8lx\n" : "%16.16lx\n", where + (bit - 1) * word);
+                count++;
+            }
+            where += (8*word - 1) * word;
+        }
+        if (!pass) fprintf(out, "  %zu offset%s\n", count, count == 1 ? "" : "s");
+    }
+}
+
+/// readelf -rW
+void
+jingle_readelf_relocs(Jingle_File *jf, FILE *out)
+{
+    Elf64_Ehdr *eh = jf->ehdr;
+    bool is32 = jingle_is_32(jf);
+    const Jingle_Reloc_Arch *arch = jingle_reloc_arch(eh->e_machine);
+    Jingle_Versions versions = jingle_read_versions(jf);
+    bool found = false;
+
+    for (size_t i = 0; i < eh->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
+        if (sh->sh_type != SHT_RELA && sh->sh_type != SHT_REL && sh->sh_type != SHT_RELR) continue;
+        if (sh->sh_size == 0 || sh->sh_entsize == 0) continue;
+        found = true;
+
+        size_t count = sh->sh_size / sh->sh_entsize;
+        fprintf(out, "\nRelocation section '");
+        jingle_put_printable(jingle_shstr(jf, sh->sh_name), out);
+        fprintf(out, "' at offset 0x%lx contains %zu entr%s:\n", sh->sh_offset, count, count == 1 ? "y" : "ies");
+
+        if (sh->sh_type == SHT_RELR) {
+            jingle_readelf_relr(jf, i, out);
+            continue;
+        }
+
+        bool is_rela = sh->sh_type == SHT_RELA;
+        if (is32) fprintf(out, " Offset     Info    Type                Sym. Value  Symbol's Name%s\n", is_rela ? " + Addend" : "");
+        else fprintf(out, "    Offset             Info             Type               Symbol's Value  Symbol's Name%s\n", is_rela ? " + Addend" : "");
+
+        // The symbols the entries refer to
+        Elf64_Sym *syms = NULL;
+        size_t nsyms = 0;
+        const char *strtab = NULL;
+        size_t strtab_size = 0;
+        bool is_dynsym = false;
+        if (sh->sh_link != 0 && sh->sh_link < eh->e_shnum) {
+            Elf64_Shdr *symsh = &jf->shdrs[sh->sh_link];
+            if ((symsh->sh_type == SHT_SYMTAB || symsh->sh_type == SHT_DYNSYM) && symsh->sh_entsize != 0) {
+                syms = jf->tables[sh->sh_link];
+                nsyms = symsh->sh_size / symsh->sh_entsize;
+                is_dynsym = symsh->sh_type == SHT_DYNSYM;
+                strtab = jf->file.data + jf->shdrs[symsh->sh_link].sh_offset;
+                strtab_size = jf->shdrs[symsh->sh_link].sh_size;
+            }
+        }
+
+        for (size_t j = 0; j < count; ++j) {
+            Elf64_Rela *r = (Elf64_Rela *)((char *)jf->tables[i] + j * (is_rela ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel)));
+            uint64_t type = ELF64_R_TYPE(r->r_info);
+            size_t symndx = ELF64_R_SYM(r->r_info);
+
+            if (is32) fprintf(out, "%8.8lx  %8.8lx ", r->r_offset & 0xffffffff, ELF32_R_INFO(symndx, type) & 0xffffffffUL);
+            else fprintf(out, "%16.16lx  %16.16lx ", r->r_offset, r->r_info);
+
+            const char *name = jingle_reloc_desc(arch, type)->name;
+            if (name == NULL) fprintf(out, "unrecognized: %-7lx", type & 0xffffffff);
+            else fprintf(out, "%s%-*s", arch->prefix, (int)(22 - strlen(arch->prefix)), name);
+
+            if (symndx != 0) {
+                if (syms == NULL || symndx >= nsyms) {
+                    fprintf(out, " bad symbol index: %08zx in reloc", symndx);
+                } else {
+                    Elf64_Sym *sym = &syms[symndx];
+                    Jingle_Version_Kind kind = JINGLE_VERSION_NONE;
+                    unsigned other = 0;
+                    const char *version = is_dynsym ? jingle_symbol_version(jf, &versions, sym, symndx, strtab, strtab_size, &kind, &other) : NULL;
+
+                    fprintf(out, " ");
+                    if (ELF64_ST_TYPE(sym->st_info) == STT_GNU_IFUNC) {
+                        // Shown as name() rather than a value, the function is called to get the address
+                        int width = is32 ? 8 : 14;
+                        int len = 0;
+                        if (sym->st_name != 0 && sym->st_name < strtab_size) len = jingle_put_printable(strtab + sym->st_name, out);
+                        if (version) fprintf(out, kind == JINGLE_VERSION_PUBLIC ? "@@%s" : "@%s", version);
+                        fprintf(out, "()%-*s", len <= width ? (width + 1) - len : 1, " ");
+                    } else {
+                        fprintf(out, is32 ? "%8.8lx   " : "%16.16lx ", sym->st_value);
+                    }
+
+                    if (sym->st_name == 0) {
+                        const char *sec = "<null>";
+                        char buf[40];
+                        if (ELF64_ST_TYPE(sym->st_info) == STT_SECTION) {
+                            if (sym->st_shndx < eh->e_shnum) sec = jingle_shstr(jf, jf->shdrs[sym->st_shndx].sh_name);
+                            else if (sym->st_shndx == SHN_ABS) sec = "ABS";
+                            else if (sym->st_shndx == SHN_COMMON) sec = "COMMON";
+                            else {
+                                snprintf(buf, sizeof(buf), "<section 0x%x>", sym->st_shndx);
+                                sec = buf;
+                            }
+                        }
+                        jingle_put_printable(sec, out);
+                    } else if (sym->st_name >= strtab_size) {
+                        fprintf(out, "<corrupt string table index: %3u>", sym->st_name);
+                    } else {
+                        jingle_put_printable(strtab + sym->st_name, out);
+                        if (version) fprintf(out, kind == JINGLE_VERSION_PUBLIC ? "@@%s" : "@%s", version);
+                    }
+
+                    if (is_rela) {
+                        if (r->r_addend < 0) fprintf(out, " - %lx", (uint64_t)-r->r_addend);
+                        else fprintf(out, " + %lx", (uint64_t)r->r_addend);
+                    }
+                }
+            } else if (is_rela) {
+                fprintf(out, "%*c", is32 ? 12 : 20, ' ');
+                if (r->r_addend < 0) fprintf(out, "-%lx", (uint64_t)-r->r_addend);
+                else fprintf(out, "%lx", (uint64_t)r->r_addend);
+            }
+            fprintf(out, "\n");
+        }
+    }
+
+    if (!found) fprintf(out, "\nThere are no relocations in this file.\n");
+}
+
+/// Symbols
+
+static const char *
+jingle_readelf_symbol_type(Jingle_File *jf, unsigned type, char *buf, size_t size)
+{
+    unsigned char osabi = jf->file.data[EI_OSABI];
+    switch (type) {
+    case STT_NOTYPE:  return "NOTYPE";
+    case STT_OBJECT:  return "OBJECT";
+    case STT_FUNC:    return "FUNC";
+    case STT_SECTION: return "SECTION";
+    case STT_FILE:    return "FILE";
+    case STT_COMMON:  return "COMMON";
+    case STT_TLS:     return "TLS";
+    }
+    if (type == STT_GNU_IFUNC && (osabi == ELFOSABI_GNU || osabi == ELFOSABI_FREEBSD)) return "IFUNC";
+    if (type >= STT_LOPROC && type <= STT_HIPROC) snprintf(buf, size, "<processor specific>: %d", type);
+    else if (type >= STT_LOOS && type <= STT_HIOS) snprintf(buf, size, "<OS specific>: %d", type);
+    else snprintf(buf, size, "<unknown>: %d", type);
+    return buf;
+}
+
+static const char *
+jingle_readelf_symbol_bind(Jingle_File *jf, unsigned bind, char *buf, size_t size)
+{
+    unsigned char osabi = jf->file.data[EI_OSABI];
+    switch (bind) {
+    case STB_LOCAL:  return "LOCAL";
+    case STB_GLOBAL: return "GLOBAL";
+    case STB_WEAK:   return "WEAK";
+    }
+    if (bind == STB_GNU_UNIQUE && osabi == ELFOSABI_GNU) return "UNIQUE";
+    if (bind >= STB_LOPROC && bind <= STB_HIPROC) snprintf(buf, size, "<processor specific>: %d", bind);
+    else if (bind >= STB_LOOS && bind <= STB_HIOS) snprintf(buf, size, "<OS specific>: %d", bind);
+    else snprintf(buf, size, "<unknown>: %d", bind);
+    return buf;
+}
+
+static const char *
+jingle_readelf_symbol_index(Jingle_File *jf, uint16_t shndx, char *buf, size_t size)
+{
+    switch (shndx) {
+    case SHN_UNDEF:  return "UND";
+    case SHN_ABS:    return "ABS";
+    case SHN_COMMON: return "COM";
+    }
+    if (shndx == JINGLE_SHN_X86_64_LCOMMON && jf->ehdr->e_machine == EM_X86_64) return "LARGE_COM";
+    if (shndx >= SHN_LOPROC && shndx <= SHN_HIPROC) snprintf(buf, size, "PRC[0x%04x]", shndx);
+    else if (shndx >= SHN_LOOS && shndx <= SHN_HIOS) snprintf(buf, size, "OS [0x%04x]", shndx);
+    else if (shndx >= SHN_LORESERVE) snprintf(buf, size, "RSV[0x%04x]", shndx);
+    else if (jf->ehdr->e_shnum != 0 && shndx >= jf->ehdr->e_shnum) snprintf(buf, size, "bad section index[%3d]", shndx);
+    else snprintf(buf, size, "%3d", shndx);
+    return buf;
+}
+
+/// readelf -sW
+void
+jingle_readelf_symbols(Jingle_File *jf, FILE *out)
+{
+    Elf64_Ehdr *eh = jf->ehdr;
+    bool is32 = jingle_is_32(jf);
+    Jingle_Versions versions = jingle_read_versions(jf);
+    static const char *VISIBILITY[4] = { "DEFAULT", "INTERNAL", "HIDDEN", "PROTECTED" };
+
+    for (size_t i = 0; i < eh->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
+        if ((sh->sh_type != SHT_SYMTAB && sh->sh_type != SHT_DYNSYM) || sh->sh_entsize == 0) continue;
+
+        size_t count = sh->sh_size / sh->sh_entsize;
+        Elf64_Sym *syms = jf->tables[i];
+        Elf64_Shdr *strsh = &jf->shdrs[sh->sh_link];
+        const char *strtab = jf->file.data + strsh->sh_offset;
+        size_t strtab_size = strsh->sh_size;
+        bool is_dynsym = sh->sh_type == SHT_DYNSYM;
+
+        fprintf(out, "\nSymbol table '");
+        jingle_put_printable(jingle_shstr(jf, sh->sh_name), out);
+        fprintf(out, "' contains %zu entr%s:\n", count, count == 1 ? "y" : "ies");
+        if (is32) fprintf(out, "   Num:    Value  Size Type    Bind   Vis      Ndx Name\n");
+        else fprintf(out, "   Num:    Value          Size Type    Bind   Vis      Ndx Name\n");
+
+        for (size_t j = 0; j < count; ++j) {
+            Elf64_Sym *sym = &syms[j];
+            char buf[64];
+
+            fprintf(out, "%6zu: ", j);
+            fprintf(out, is32 ? "%8.8lx" : "%16.16lx", sym->st_value);
+            if (sym->st_size <= 99999) fprintf(out, " %5lu", sym->st_size);
+            else fprintf(out, " 0x%lx", sym->st_size);
+            fprintf(out, " %-7s", jingle_readelf_symbol_type(jf, ELF64_ST_TYPE(sym->st_info), buf, sizeof(buf)));
+            fprintf(out, " %-6s", jingle_readelf_symbol_bind(jf, ELF64_ST_BIND(sym->st_info), buf, sizeof(buf)));
+            unsigned vis = ELF64_ST_VISIBILITY(sym->st_other);
+            fprintf(out, " %-7s", VISIBILITY[vis]);
+            if (sym->st_other ^ vis) fprintf(out, " [<other>: %x] ", sym->st_other ^ vis);
+            fprintf(out, " %4s ", jingle_readelf_symbol_index(jf, sym->st_shndx, buf, sizeof(buf)));
+
+            if (ELF64_ST_TYPE(sym->st_info) == STT_SECTION && sym->st_shndx < eh->e_shnum && sym->st_name == 0) {
+                jingle_put_printable(jingle_shstr(jf, jf->shdrs[sym->st_shndx].sh_name), out);
+            } else {
+                jingle_put_printable(sym->st_name < strtab_size ? strtab + sym->st_name : "<corrupt>", out);
+            }
+
+            Jingle_Version_Kind kind = JINGLE_VERSION_NONE;
+            unsigned other = 0;
+            const char *version = is_dynsym ? jingle_symbol_version(jf, &versions, sym, j, strtab, strtab_size, &kind, &other) : NULL;
+            if (version != NULL) {
+                if (kind == JINGLE_VERSION_UNDEFINED) fprintf(out, "@%s (%u)", version, other);
+                else fprintf(out, kind == JINGLE_VERSION_HIDDEN ? "@%s" : "@@%s", version);
+            }
+            fprintf(out, "\n");
+        }
+    }
+}
+
+/// nm -P
+
+typedef struct {
+    const char *name;
+    char type;
+    uint64_t value;
+    uint64_t size;
+    size_t index;
+} Jingle_Nm_Symbol;
+
+static int
+jingle_nm_compare(const void *a, const void *b)
+{
+    const Jingle_Nm_Symbol *x = a, *y = b;
+    // Empty names first, then by name, then in symbol table order
+    if (*x->name == '\0' || *y->name == '\0') {
+        if (*x->name != *y->name) return *x->name == '\0' ? -1 : 1;
+    } else {
+        int c = strcmp(x->name, y->name);
+        if (c != 0) return c;
+    }
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/// The letter nm shows for a symbol defined in section shndx, before upper-casing for globals
+static char
+jingle_nm_section_letter(Jingle_File *jf, size_t shndx)
+{
+    Elf64_Shdr *sh = &jf->shdrs[shndx];
+    bool alloc = sh->sh_flags & SHF_ALLOC;
+    bool contents = sh->sh_type != SHT_NOBITS;
+    bool readonly = !(sh->sh_flags & SHF_WRITE);
+
+    if (sh->sh_flags & SHF_EXECINSTR) return 't';
+    if (alloc && contents) return readonly ? 'r' : 'd';
+    if (!contents) return 'b';
+
+    const char *name = jingle_shstr(jf, sh->sh_name);
+    if (!alloc && (strncmp(name, ".debug", 6) == 0 || strncmp(name, ".gnu.debuglto_.debug_", 21) == 0 ||
+                   strncmp(name, ".gnu.linkonce.wi.", 17) == 0 || strncmp(name, ".zdebug", 7) == 0 ||
+                   strncmp(name, ".line", 5) == 0 || strncmp(name, ".stab", 5) == 0 || strcmp(name, ".gdb_index") == 0)) {
+        return 'N';
+    }
+    return readonly ? 'n' : '?';
+}
+
+static char
+jingle_nm_letter(Jingle_File *jf, Elf64_Sym *sym)
+{
+    unsigned type = ELF64_ST_TYPE(sym->st_info);
+    unsigned bind = ELF64_ST_BIND(sym->st_info);
+    bool object = type == STT_OBJECT;
+
+    if (sym->st_shndx == SHN_COMMON || (sym->st_shndx == JINGLE_SHN_X86_64_LCOMMON && jf->ehdr->e_machine == EM_X86_64)) return 'C';
+    if (sym->st_shndx == SHN_UNDEF) return bind == STB_WEAK ? (object ? 'v' : 'w') : 'U';
+    if (type == STT_GNU_IFUNC) return 'i';
+    if (bind == STB_WEAK) return object ? 'V' : 'W';
+    if (bind == STB_GNU_UNIQUE) return 'u';
+    if (bind != STB_GLOBAL && bind != STB_LOCAL) return '?';
+
+    char c;
+    if (sym->st_shndx == SHN_ABS) c = 'a';
+    else if (sym->st_shndx < jf->ehdr->e_shnum) c = jingle_nm_section_letter(jf, sym->st_shndx);
+    else return '?';
+
+    return bind == STB_GLOBAL && c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+}
+
+/// nm -P: every symbol but section and file ones, sorted by name. Returns false if the file has no symbols.
+bool
+jingle_nm_posix(Jingle_File *jf, FILE *out)
+{
+    Jingle_Symtab symtab = jingle_read_symtab(jf);
+    if (symtab.count == 0) return false;
+
+    Jingle_Nm_Symbol *list = NULL;
+    for (size_t i = 1; i < symtab.count; ++i) {
+        Elf64_Sym *sym = &symtab.data[i];
+        unsigned type = ELF64_ST_TYPE(sym->st_info);
+        if (type == STT_SECTION || type == STT_FILE) continue;
+
+        Jingle_Nm_Symbol s = {
+            .name = sym->st_name < symtab.names_count ? &symtab.names[sym->st_name] : "",
+            .type = jingle_nm_letter(jf, sym),
+            // Common symbols keep their alignment in st_value; nm shows the size there
+            .value = sym->st_shndx == SHN_COMMON ? sym->st_size : sym->st_value,
+            .size = sym->st_size,
+            .index = i,
+        };
+        arrput(list, s);
+    }
+
+    if (arrlen(list) > 1) qsort(list, arrlen(list), sizeof(*list), jingle_nm_compare);
+
+    for (size_t i = 0; i < (size_t)arrlen(list); ++i) {
+        Jingle_Nm_Symbol *s = &list[i];
+        fprintf(out, "%s %c ", s->name, s->type);
+        if (s->type == 'U' || s->type == 'w' || s->type == 'v') {
+            fprintf(out, "        ");
+        } else {
+            fprintf(out, "%lx ", s->value);
+            if (s->size) fprintf(out, "%lx", s->size);
+        }
+        fprintf(out, "\n");
+    }
+
+    arrfree(list);
+    return true;
+}
+
+#endif // JINGLE_BINUTILS_C_
@@ -0,0 +1,391 @@
+#ifndef JINGLE_BUILDID_C_
+#define JINGLE_BUILDID_C_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/stat.h>
+
+#include "stb_ds.h"
+#include "jingle_scan.c"
+
+/// GNU build-id lookup.
+///
+/// A build-id is a 20 byte note, so instead of loading the whole binary we pread the ELF header, the program
+/// header table (or the section header table for relocatable files without one) and then only the note segments
+/// themselves. Both classes and both byte orders are handled here, since these few fields are all we ever look at.
+
+#define JINGLE_BUILD_ID_MAX 64
+
+typedef struct {
+    unsigned char bytes[JINGLE_BUILD_ID_MAX];
+    size_t count;
+} Jingle_Build_Id;
+
+typedef struct {
+    bool is64;
+    bool msb;
+} Jingle_Build_Id_Format;
+
+static uint64_t
+jingle_bid_get(Jingle_Build_Id_Format f, const unsigned char *p, size_t size)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < size; ++i) {
+        size_t byte = f.msb ? i : size - 1 - i;
+        v = v << 8 | p[byte];
+    }
+    return v;
+}
+
+static bool
+jingle_pread_all(int fd, void *buf, size_t n, uint64_t offset)
+{
+    while (n > 0) {
+        ssize_t r = pread(fd, buf, n, offset);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        buf = (char *)buf + r;
+        n -= r;
+        offset += r;
+    }
+    return true;
+}
+
+/// Where the headers and notes are read from: a file descriptor, or a file already in memory (archive members and
+/// decompressed files, which only the input layer knows how to get at)
+typedef struct {
+    int fd;
+    const unsigned char *data;
+    size_t size;
+} Jingle_Bid_Source;
+
+static bool
+jingle_bid_read(Jingle_Bid_Source src, void *buf, size_t n, uint64_t offset)
+{
+    if (src.data == NULL) return jingle_pread_all(src.fd, buf, n, offset);
+    if (offset > src.size || n > src.size - offset) return false;
+    memcpy(buf, src.data + offset, n);
+    return true;
+}
+
+/// Looks for NT_GNU_BUILD_ID in a buffer of notes aligned to align (4 or 8) bytes.
+static bool
+jingle_bid_parse_notes(Jingle_Build_Id_Format f, const unsigned char *p, size_t n, size_t align, Jingle_Build_Id *id)
+{
+    if (align < 4) align = 4;
+    size_t pos = 0;
+
+    while (pos + 12 <= n) {
+        uint64_t namesz = jingle_bid_get(f, p + pos, 4);
+        uint64_t descsz = jingle_bid_get(f, p + pos + 4, 4);
+        uint64_t type   = jingle_bid_get(f, p + pos + 8, 4);
+        pos += 12;
+
+        uint64_t name_end = pos + ((namesz + align - 1) & ~(align - 1));
+        uint64_t desc_end = name_end + ((descsz + align - 1) & ~(align - 1));
+        if (name_end > n || name_end + descsz > n) return false;
+
+        if (type == NT_GNU_BUILD_ID && namesz == 4 && memcmp(p + pos, "GNU", 4) == 0) {
+            if (descsz == 0 || descsz > JINGLE_BUILD_ID_MAX) return false;
+            memcpy(id->bytes, p + name_end, descsz);
+            id->count = descsz;
+            return true;
+        }
+
+        // The last note's desc needn't be padded out to align, which leaves nothing after it to read
+        if (desc_end >= n) break;
+        pos = desc_end;
+    }
+
+    return false;
+}
+
+static bool
+jingle_bid_read_notes(Jingle_Bid_Source src, Jingle_Build_Id_Format f, uint64_t offset, uint64_t size, uint64_t align, Jingle_Build_Id *id)
+{
+    // Notes are tiny; anything bigger than this is not worth reading just for the build-id
+    if (size == 0 || size > (1 << 20)) return false;
+
+    unsigned char *buf = malloc(size);
+    bool found = buf && jingle_bid_read(src, buf, size, offset) && jingle_bid_parse_notes(f, buf, size, align, id);
+    free(buf);
+    return found;
+}
+
+static bool
+jingle_bid_find(Jingle_Bid_Source src, Jingle_Build_Id *id)
+{
+    bool found = false;
+    unsigned char eh[sizeof(Elf64_Ehdr)];
+    unsigned char *table = NULL;
+
+    if (!jingle_bid_read(src, eh, EI_NIDENT, 0) || memcmp(eh, ELFMAG, SELFMAG) != 0) goto done;
+    if (eh[EI_CLASS] != ELFCLASS32 && eh[EI_CLASS] != ELFCLASS64) goto done;
+
+    Jingle_Build_Id_Format f = { .is64 = eh[EI_CLASS] == ELFCLASS64, .msb = eh[EI_DATA] == ELFDATA2MSB };
+    size_t ehsize = f.is64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr);
+    if (!jingle_bid_read(src, eh + EI_NIDENT, ehsize - EI_NIDENT, EI_NIDENT)) goto done;
+
+#define EH(field) jingle_bid_get(f, eh + (f.is64 ? offsetof(Elf64_Ehdr, field) : offsetof(Elf32_Ehdr, field)), \
+                                 f.is64 ? sizeof(((Elf64_Ehdr *)0)->field) : sizeof(((Elf32_Ehdr *)0)->field))
+    uint64_t phoff = EH(e_phoff), phentsize = EH(e_phentsize), phnum = EH(e_phnum);
+    uint64_t shoff = EH(e_shoff), shentsize = EH(e_shentsize), shnum = EH(e_shnum);
+#undef EH
+
+    if (phnum > 0 && phentsize >= (f.is64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr))) {
+        table = malloc(phnum * phentsize);
+        if (!table || !jingle_bid_read(src, table, phnum * phentsize, phoff)) goto done;
+
+        for (size_t i = 0; i < phnum && !found; ++i) {
+            unsigned char *ph = table + i * phentsize;
+#define PH(field) jingle_bid_get(f, ph + (f.is64 ? offsetof(Elf64_Phdr, field) : offsetof(Elf32_Phdr, field)), \
+                                 f.is64 ? sizeof(((Elf64_Phdr *)0)->field) : sizeof(((Elf32_Phdr *)0)->field))
+            if (PH(p_type) != PT_NOTE) continue;
+            found = jingle_bid_read_notes(src, f, PH(p_offset), PH(p_filesz), PH(p_align), id);
+#undef PH
+        }
+    } else if (shnum > 0 && shentsize >= (f.is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr))) {
+        table = malloc(shnum * shentsize);
+        if (!table || !jingle_bid_read(src, table, shnum * shentsize, shoff)) goto done;
+
+        for (size_t i = 0; i < shnum && !found; ++i) {
+            unsigned char *sh = table + i * shentsize;
+#define SH(field) jingle_bid_get(f, sh + (f.is64 ? offsetof(Elf64_Shdr, field) : offsetof(Elf32_Shdr, field)), \
+                                 f.is64 ? sizeof(((Elf64_Shdr *)0)->field) : sizeof(((Elf32_Shdr *)0)->field))
+            if (SH(sh_type) != SHT_NOTE) continue;
+            found = jingle_bid_read_notes(src, f, SH(sh_offset), SH(sh_size), SH(sh_addralign), id);
+#undef SH
+        }
+    }
+
+done:
+    free(table);
+    return found;
+}
+
+bool
+jingle_read_build_id(const char *path, Jingle_Build_Id *id)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    bool found = jingle_bid_find((Jingle_Bid_Source){ .fd = fd }, id);
+    close(fd);
+    return found;
+}
+
+/// jingle_read_build_id for a file that is already in memory
+bool
+jingle_read_build_id_data(const void *data, size_t size, Jingle_Build_Id *id)
+{
+    if (data == NULL) return false;
+    return jingle_bid_find((Jingle_Bid_Source){ .fd = -1, .data = data, .size = size }, id);
+}
+
+void
+jingle_build_id_hex(Jingle_Build_Id *id, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < id->count; ++i) {
+        out[2*i]     = digits[id->bytes[i] >> 4];
+        out[2*i + 1] = digits[id->bytes[i] & 0xF];
+    }
+    out[2 * id->count] = '\0';
+}
+
+/// Resolving build-ids to separate debug files.
+///
+/// The usual layout is DEBUG_DIR/.build-id/ab/cdef....debug, which is checked first. Debug stores that don't
+/// follow it are indexed by reading the build-id of every ELF file under DEBUG_DIR once. Every resolution is
+/// remembered in a cache file of "BUILD_ID PATH" lines, so later runs answer straight from the cache and never
+/// walk the store again. Build-ids without a debug file are remembered too, as "BUILD_ID -": those only get the
+/// .build-id probe, unless DEBUG_DIR changed after the cache was written, in which case they are looked up afresh.
+
+#define JINGLE_DEBUG_MISSING "-"
+
+typedef struct {
+    char *key;   // hex build-id
+    char *value; // debug file path
+} Jingle_Debug_Entry;
+
+typedef struct {
+    const char *debug_dir;
+    const char *cache_path; // NULL to keep the cache in memory only
+    Jingle_Debug_Entry *map; // stb_ds string hash map
+    bool scanned;
+    bool dirty;
+} Jingle_Debug_Cache;
+
+void
+jingle_debug_cache_load(Jingle_Debug_Cache *c, const char *debug_dir, const char *cache_path)
+{
+    *c = (Jingle_Debug_Cache){ .debug_dir = debug_dir, .cache_path = cache_path };
+    sh_new_strdup(c->map);
+
+    if (cache_path == NULL) return;
+
+    FILE *f = fopen(cache_path, "r");
+    if (f == NULL) return;
+
+    // Misses are only worth keeping while the store is as it was when the cache was written
+    struct stat cache_st, dir_st;
+    bool keep_missing = debug_dir != NULL && fstat(fileno(f), &cache_st) == 0 && stat(debug_dir, &dir_st) == 0 &&
+                        dir_st.st_mtime <= cache_st.st_mtime;
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    while ((n = getline(&line, &cap, f)) > 0) {
+        if (line[n-1] == '\n') line[--n] = '\0';
+        char *space = strchr(line, ' ');
+        if (space == NULL) continue;
+        *space = '\0';
+        if (!keep_missing && strcmp(space + 1, JINGLE_DEBUG_MISSING) == 0) {
+            c->dirty = true;
+            continue;
+        }
+        shput(c->map, line, strdup(space + 1));
+    }
+
+    free(line);
+    fclose(f);
+}
+
+static void
+jingle_debug_cache_put(Jingle_Debug_Cache *c, const char *hex, const char *path)
+{
+    ptrdiff_t i = shgeti(c->map, (char *)hex);
+    if (i >= 0) {
+        if (strcmp(c->map[i].value, path) == 0) return;
+        free(c->map[i].value);
+        c->map[i].value = strdup(path);
+    } else {
+        shput(c->map, (char *)hex, strdup(path));
+    }
+    c->dirty = true;
+}
+
+static void
+jingle_debug_cache_index(Jingle_Debug_Cache *c)
+{
+    c->scanned = true;
+
+    struct stat st;
+    if (stat(c->debug_dir, &st) != 0 || !S_ISDIR(st.st_mode)) return;
+
+    Jingle_Sniff *files = jingle_scan(c->debug_dir);
+    for (size_t i = 0; i < (size_t)arrlen(files); ++i) {
+        if (!files[i].is_elf) continue;
+
+        Jingle_Build_Id id;
+        if (!jingle_read_build_id(files[i].path, &id)) continue;
+
+        char hex[2 * JINGLE_BUILD_ID_MAX + 1];
+        jingle_build_id_hex(&id, hex);
+        ptrdiff_t known = shgeti(c->map, hex);
+        if (known < 0 || strcmp(c->map[known].value, JINGLE_DEBUG_MISSING) == 0) jingle_debug_cache_put(c, hex, files[i].path);
+    }
+    jingle_sniff_free(files);
+}
+
+/// Returns the debug file for a build-id, or NULL. The string belongs to the cache.
+const char *
+jingle_debug_resolve(Jingle_Debug_Cache *c, Jingle_Build_Id *id)
+{
+    char hex[2 * JINGLE_BUILD_ID_MAX + 1];
+    jingle_build_id_hex(id, hex);
+
+    // A cached file that has since disappeared is forgotten and looked up again. A cached miss skips the index.
+    bool missing = false;
+    ptrdiff_t i = shgeti(c->map, hex);
+    if (i >= 0 && strcmp(c->map[i].value, JINGLE_DEBUG_MISSING) == 0) {
+        missing = true;
+    } else if (i >= 0) {
+        if (access(c->map[i].value, R_OK) == 0) return c->map[i].value;
+        free(c->map[i].value);
+        (void)shdel(c->map, hex);
+        c->dirty = true;
+    }
+
+    if (c->debug_dir == NULL || id->count < 2) return NULL;
+
+    size_t len = strlen(c->debug_dir) + strlen("/.build-id/xx/") + strlen(hex) + strlen(".debug") + 1;
+    char *path = malloc(len);
+    snprintf(path, len, "%s/.build-id/%.2s/%s.debug", c->debug_dir, hex, hex + 2);
+
+    if (access(path, R_OK) == 0) {
+        jingle_debug_cache_put(c, hex, path);
+        free(path);
+        return shget(c->map, hex);
+    }
+    free(path);
+
+    if (!missing && !c->scanned) {
+        jingle_debug_cache_index(c);
+        i = shgeti(c->map, hex);
+        if (i >= 0) return c->map[i].value;
+    }
+
+    jingle_debug_cache_put(c, hex, JINGLE_DEBUG_MISSING);
+    return NULL;
+}
+
+/// Writes the cache back if anything was added, replacing the old file atomically. The new file is a fresh mkstemp
+/// file next to it, so jobs sharing a cache never write into each other's temporary.
+bool
+jingle_debug_cache_save(Jingle_Debug_Cache *c)
+{
+    if (c->cache_path == NULL || !c->dirty) return true;
+
+    size_t len = strlen(c->cache_path) + sizeof(".XXXXXX");
+    char *tmp = malloc(len);
+    snprintf(tmp, len, "%s.XXXXXX", c->cache_path);
+
+    // mkstemp makes the file 0600; keep the old cache's permissions, or give a new one the usual 0666 less the umask
+    struct stat st;
+    mode_t mode;
+    if (stat(c->cache_path, &st) == 0) {
+        mode = st.st_mode & 07777;
+    } else {
+        mode_t mask = umask(0);
+        umask(mask);
+        mode = 0666 & ~mask;
+    }
+
+    int fd = mkstemp(tmp);
+    FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+    if (f == NULL) {
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        free(tmp);
+        return false;
+    }
+    fchmod(fd, mode);
+    for (size_t i = 0; i < (size_t)shlen(c->map); ++i) {
+        fprintf(f, "%s %s\n", c->map[i].key, c->map[i].value);
+    }
+    bool ok = fclose(f) == 0 && rename(tmp, c->cache_path) == 0;
+    if (!ok) unlink(tmp);
+
+    free(tmp);
+    c->dirty = !ok;
+    return ok;
+}
+
+void
+jingle_debug_cache_free(Jingle_Debug_Cache *c)
+{
+    for (size_t i = 0; i < (size_t)shlen(c->map); ++i) free(c->map[i].value);
+    shfree(c->map);
+}
+
+#endif // JINGLE_BUILDID_C_
@@ -0,0 +1,1070 @@
+#ifndef JINGLE_DISASM_C_
+#define JINGLE_DISASM_C_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/// A table-driven x86-64 decoder, enough to read compiler output in Intel syntax.
+///
+/// Every opcode map is a table of { mnemonic, operands } entries written in the notation of the opcode maps in the
+/// Intel SDM, and one generic routine reads the prefixes, ModRM, SIB, displacement and immediates any entry asks
+/// for. The instruction length falls out of the same walk, so an entry that is right about its operands is also
+/// right about its length.
+///
+/// Mnemonics:
+///   "add"             plain
+///   "#1"              the opcode extension group JINGLE_GROUPS[1], indexed by ModRM.reg
+///   "movups|movupd|movss|movsd"
+///                     picked by the mandatory prefix (none, 66, F3, F2). An empty or missing variant falls back
+///                     to the first one, and that prefix then keeps its usual meaning
+///   "cbw/cwde/cdqe"   picked by operand size (16, 32, 64)
+///   "movs*"           * becomes w, d or q by operand size
+///
+/// Operands are comma separated. A token starting with an uppercase letter is an addressing method followed by a
+/// size, anything else is printed as it is ("cl", "1", "st"):
+///   A accumulator, Z register from the low opcode bits, G ModRM.reg, E ModRM.rm (register or memory),
+///   M memory only, I immediate sign extended to the first operand, K immediate as is, J relative branch target,
+///   O absolute address, S segment register, C control register, D debug register, V xmm from ModRM.reg,
+///   W xmm or memory from ModRM.rm, U xmm from ModRM.rm, H xmm from VEX.vvvv (left out without VEX), P mmx from
+///   ModRM.reg, Q mmx or memory, N mmx from ModRM.rm, F x87 stack register from ModRM.rm, B general register
+///   from VEX.vvvv, L xmm from the top 4 bits of an immediate byte
+/// Sizes: b 8, w 16, d 32, q 64, v 16/32/64 by operand size, z 16/32 by operand size, y 32/64 by REX.W,
+///   o 128, x 128/256 by VEX.L, h u e a half, quarter and eighth of x, t 80, p far pointer, B and W 8 and 16 in
+///   memory but a 32 bit register
+
+#define JINGLE_DIS_D64 0x01 // operand size defaults to 64 bits (push, pop, indirect branches)
+#define JINGLE_DIS_VEX 0x02 // only exists VEX encoded
+#define JINGLE_DIS_V   0x04 // no xmm operands, but also VEX encoded with a "v" in front
+
+typedef struct {
+    const char *mnemonic;
+    const char *operands;
+    unsigned char flags;
+} Jingle_Opcode;
+
+typedef struct {
+    size_t length;
+    char text[160];
+    bool has_target;   // a relative branch (target is where it goes) or a RIP-relative operand (target is the address)
+    bool target_is_rip;
+    uint64_t target;
+} Jingle_Insn;
+
+#define JINGLE_ALU(base, name) \
+    [(base)+0] = { name, "Eb,Gb" }, [(base)+1] = { name, "Ev,Gv" }, [(base)+2] = { name, "Gb,Eb" }, \
+    [(base)+3] = { name, "Gv,Ev" }, [(base)+4] = { name, "Ab,Ib" }, [(base)+5] = { name, "Av,Iz" }
+
+#define JINGLE_CC(base, prefix, suffix, operands) \
+    [(base)+0x0] = { prefix "o" suffix, operands },  [(base)+0x1] = { prefix "no" suffix, operands }, \
+    [(base)+0x2] = { prefix "b" suffix, operands },  [(base)+0x3] = { prefix "ae" suffix, operands }, \
+    [(base)+0x4] = { prefix "e" suffix, operands },  [(base)+0x5] = { prefix "ne" suffix, operands }, \
+    [(base)+0x6] = { prefix "be" suffix, operands }, [(base)+0x7] = { prefix "a" suffix, operands }, \
+    [(base)+0x8] = { prefix "s" suffix, operands },  [(base)+0x9] = { prefix "ns" suffix, operands }, \
+    [(base)+0xa] = { prefix "p" suffix, operands },  [(base)+0xb] = { prefix "np" suffix, operands }, \
+    [(base)+0xc] = { prefix "l" suffix, operands },  [(base)+0xd] = { prefix "ge" suffix, operands }, \
+    [(base)+0xe] = { prefix "le" suffix, operands }, [(base)+0xf] = { prefix "g" suffix, operands }
+
+#define JINGLE_RANGE8(base, name, operands, flags) \
+    [(base)+0] = { name, operands, flags }, [(base)+1] = { name, operands, flags }, \
+    [(base)+2] = { name, operands, flags }, [(base)+3] = { name, operands, flags }, \
+    [(base)+4] = { name, operands, flags }, [(base)+5] = { name, operands, flags }, \
+    [(base)+6] = { name, operands, flags }, [(base)+7] = { name, operands, flags }
+
+// MMX without a prefix, SSE2 with 66
+#define JINGLE_MMX(name) { name "|" name, "Pq,Qq|Vx,Hx,Wx" }
+
+static const Jingle_Opcode JINGLE_MAP_1[256] = {
+    JINGLE_ALU(0x00, "add"), JINGLE_ALU(0x08, "or"),  JINGLE_ALU(0x10, "adc"), JINGLE_ALU(0x18, "sbb"),
+    JINGLE_ALU(0x20, "and"), JINGLE_ALU(0x28, "sub"), JINGLE_ALU(0x30, "xor"), JINGLE_ALU(0x38, "cmp"),
+    JINGLE_RANGE8(0x50, "push", "Zv", JINGLE_DIS_D64),
+    JINGLE_RANGE8(0x58, "pop", "Zv", JINGLE_DIS_D64),
+    [0x63] = { "movsxd", "Gv,Ed" },
+    [0x68] = { "push", "Iz", JINGLE_DIS_D64 },
+    [0x69] = { "imul", "Gv,Ev,Iz" },
+    [0x6a] = { "push", "Ib", JINGLE_DIS_D64 },
+    [0x6b] = { "imul", "Gv,Ev,Ib" },
+    [0x6c] = { "insb", "" }, [0x6d] = { "ins*", "" }, [0x6e] = { "outsb", "" }, [0x6f] = { "outs*", "" },
+    JINGLE_CC(0x70, "j", "", "Jb"),
+    [0x80] = { "#1", "Eb,Ib" }, [0x81] = { "#1", "Ev,Iz" }, [0x83] = { "#1", "Ev,Ib" },
+    [0x84] = { "test", "Eb,Gb" }, [0x85] = { "test", "Ev,Gv" },
+    [0x86] = { "xchg", "Eb,Gb" }, [0x87] = { "xchg", "Ev,Gv" },
+    [0x88] = { "mov", "Eb,Gb" }, [0x89] = { "mov", "Ev,Gv" }, [0x8a] = { "mov", "Gb,Eb" }, [0x8b] = { "mov", "Gv,Ev" },
+    [0x8c] = { "mov", "Ew,Sw" }, [0x8d] = { "lea", "Gv,M" }, [0x8e] = { "mov", "Sw,Ew" },
+    [0x8f] = { "#2", "Ev", JINGLE_DIS_D64 },
+    [0x90] = { "nop", "" },
+    [0x91] = { "xchg", "Zv,Av" }, [0x92] = { "xchg", "Zv,Av" }, [0x93] = { "xchg", "Zv,Av" }, [0x94] = { "xchg", "Zv,Av" },
+    [0x95] = { "xchg", "Zv,Av" }, [0x96] = { "xchg", "Zv,Av" }, [0x97] = { "xchg", "Zv,Av" },
+    [0x98] = { "cbw/cwde/cdqe", "" }, [0x99] = { "cwd/cdq/cqo", "" },
+    [0x9b] = { "fwait", "" }, [0x9c] = { "pushf", "", JINGLE_DIS_D64 }, [0x9d] = { "popf", "", JINGLE_DIS_D64 },
+    [0x9e] = { "sahf", "" }, [0x9f] = { "lahf", "" },
+    [0xa0] = { "movabs", "Ab,Ob" }, [0xa1] = { "movabs", "Av,Ov" }, [0xa2] = { "movabs", "Ob,Ab" }, [0xa3] = { "movabs", "Ov,Av" },
+    [0xa4] = { "movsb", "" }, [0xa5] = { "movs*", "" }, [0xa6] = { "cmpsb", "" }, [0xa7] = { "cmps*", "" },
+    [0xa8] = { "test", "Ab,Ib" }, [0xa9] = { "test", "Av,Iz" },
+    [0xaa] = { "stosb", "" }, [0xab] = { "stos*", "" }, [0xac] = { "lodsb", "" }, [0xad] = { "lods*", "" },
+    [0xae] = { "scasb", "" }, [0xaf] = { "scas*", "" },
+    JINGLE_RANGE8(0xb0, "mov", "Zb,Kb", 0),
+    JINGLE_RANGE8(0xb8, "mov", "Zv,Kv", 0),
+    [0xc0] = { "#3", "Eb,Kb" }, [0xc1] = { "#3", "Ev,Kb" },
+    [0xc2] = { "ret", "Kw" }, [0xc3] = { "ret", "" },
+    [0xc6] = { "#11", "Eb,Ib" }, [0xc7] = { "#12", "Ev,Iz" },
+    [0xc8] = { "enter", "Kw,Kb" }, [0xc9] = { "leave", "", JINGLE_DIS_D64 },
+    [0xca] = { "retf", "Kw" }, [0xcb] = { "retf", "" },
+    [0xcc] = { "int3", "" }, [0xcd] = { "int", "Kb" }, [0xcf] = { "iretw/iret/iretq", "" },
+    [0xd0] = { "#3", "Eb,1" }, [0xd1] = { "#3", "Ev,1" }, [0xd2] = { "#3", "Eb,cl" }, [0xd3] = { "#3", "Ev,cl" },
+    [0xd7] = { "xlatb", "" },
+    [0xe0] = { "loopne", "Jb" }, [0xe1] = { "loope", "Jb" }, [0xe2] = { "loop", "Jb" }, [0xe3] = { "jrcxz", "Jb" },
+    [0xe4] = { "in", "Ab,Kb" }, [0xe5] = { "in", "Az,Kb" }, [0xe6] = { "out", "Kb,Ab" }, [0xe7] = { "out", "Kb,Az" },
+    [0xe8] = { "call", "Jz" }, [0xe9] = { "jmp", "Jz" }, [0xeb] = { "jmp", "Jb" },
+    [0xec] = { "in", "Ab,dx" }, [0xed] = { "in", "Az,dx" }, [0xee] = { "out", "dx,Ab" }, [0xef] = { "out", "dx,Az" },
+    [0xf1] = { "int1", "" }, [0xf4] = { "hlt", "" }, [0xf5] = { "cmc", "" },
+    [0xf6] = { "#4", "Eb" }, [0xf7] = { "#5", "Ev" },
+    [0xf8] = { "clc", "" }, [0xf9] = { "stc", "" }, [0xfa] = { "cli", "" }, [0xfb] = { "sti", "" },
+    [0xfc] = { "cld", "" }, [0xfd] = { "std", "" },
+    [0xfe] = { "#6", "Eb" }, [0xff] = { "#7", "Ev" },
+};
+
+static const Jingle_Opcode JINGLE_MAP_0F[256] = {
+    [0x00] = { "#8", "Ew" }, [0x01] = { "#9", "" },
+    [0x02] = { "lar", "Gv,Ew" }, [0x03] = { "lsl", "Gv,Ew" },
+    [0x05] = { "syscall", "" }, [0x06] = { "clts", "" }, [0x07] = { "sysret", "" },
+    [0x08] = { "invd", "" }, [0x09] = { "wbinvd", "" }, [0x0b] = { "ud2", "" },
+    [0x0d] = { "#10", "Mb" },
+    [0x10] = { "movups|movupd|movss|movsd", "Vx,Wx|Vx,Wx|Vx,Wd|Vx,Wq" },
+    [0x11] = { "movups|movupd|movss|movsd", "Wx,Vx|Wx,Vx|Wd,Vx|Wq,Vx" },
+    [0x12] = { "movlps|movlpd|movsldup|movddup", "Vo,Hx,Wq|Vo,Hx,Mq|Vx,Wx|Vx,Wq" },
+    [0x13] = { "movlps|movlpd", "Mq,Vo" },
+    [0x14] = { "unpcklps|unpcklpd", "Vx,Hx,Wx" },
+    [0x15] = { "unpckhps|unpckhpd", "Vx,Hx,Wx" },
+    [0x16] = { "movhps|movhpd|movshdup", "Vo,Hx,Wq|Vo,Hx,Mq|Vx,Wx" },
+    [0x17] = { "movhps|movhpd", "Mq,Vo" },
+    [0x18] = { "#13", "Mb" },
+    [0x19] = { "nop", "Ev" }, [0x1a] = { "nop", "Ev" }, [0x1b] = { "nop", "Ev" }, [0x1c] = { "nop", "Ev" },
+    [0x1d] = { "nop", "Ev" }, [0x1e] = { "nop", "Ev" }, [0x1f] = { "nop", "Ev" },
+    [0x20] = { "mov", "Rq,Cq" }, [0x21] = { "mov", "Rq,Dq" }, [0x22] = { "mov", "Cq,Rq" }, [0x23] = { "mov", "Dq,Rq" },
+    [0x28] = { "movaps|movapd", "Vx,Wx" },
+    [0x29] = { "movaps|movapd", "Wx,Vx" },
+    [0x2a] = { "cvtpi2ps|cvtpi2pd|cvtsi2ss|cvtsi2sd", "Vo,Qq|Vo,Qq|Vo,Hx,Ey|Vo,Hx,Ey" },
+    [0x2b] = { "movntps|movntpd", "Mx,Vx" },
+    [0x2c] = { "cvttps2pi|cvttpd2pi|cvttss2si|cvttsd2si", "Pq,Wq|Pq,Wo|Gy,Wd|Gy,Wq" },
+    [0x2d] = { "cvtps2pi|cvtpd2pi|cvtss2si|cvtsd2si", "Pq,Wq|Pq,Wo|Gy,Wd|Gy,Wq" },
+    [0x2e] = { "ucomiss|ucomisd", "Vo,Wd|Vo,Wq" },
+    [0x2f] = { "comiss|comisd", "Vo,Wd|Vo,Wq" },
+    [0x30] = { "wrmsr", "" }, [0x31] = { "rdtsc", "" }, [0x32] = { "rdmsr", "" }, [0x33] = { "rdpmc", "" },
+    [0x34] = { "sysenter", "" }, [0x35] = { "sysexit", "" }, [0x37] = { "getsec", "" },
+    JINGLE_CC(0x40, "cmov", "", "Gv,Ev"),
+    [0x50] = { "movmskps|movmskpd", "Gd,Ux" },
+    [0x51] = { "sqrtps|sqrtpd|sqrtss|sqrtsd", "Vx,Wx|Vx,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x52] = { "rsqrtps||rsqrtss", "Vx,Wx||Vo,Hx,Wd" },
+    [0x53] = { "rcpps||rcpss", "Vx,Wx||Vo,Hx,Wd" },
+    [0x54] = { "andps|andpd", "Vx,Hx,Wx" },
+    [0x55] = { "andnps|andnpd", "Vx,Hx,Wx" },
+    [0x56] = { "orps|orpd", "Vx,Hx,Wx" },
+    [0x57] = { "xorps|xorpd", "Vx,Hx,Wx" },
+    [0x58] = { "addps|addpd|addss|addsd", "Vx,Hx,Wx|Vx,Hx,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x59] = { "mulps|mulpd|mulss|mulsd", "Vx,Hx,Wx|Vx,Hx,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x5a] = { "cvtps2pd|cvtpd2ps|cvtss2sd|cvtsd2ss", "Vx,Wh|Vo,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x5b] = { "cvtdq2ps|cvtps2dq|cvttps2dq", "Vx,Wx" },
+    [0x5c] = { "subps|subpd|subss|subsd", "Vx,Hx,Wx|Vx,Hx,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x5d] = { "minps|minpd|minss|minsd", "Vx,Hx,Wx|Vx,Hx,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x5e] = { "divps|divpd|divss|divsd", "Vx,Hx,Wx|Vx,Hx,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x5f] = { "maxps|maxpd|maxss|maxsd", "Vx,Hx,Wx|Vx,Hx,Wx|Vo,Hx,Wd|Vo,Hx,Wq" },
+    [0x60] = JINGLE_MMX("punpcklbw"), [0x61] = JINGLE_MMX("punpcklwd"), [0x62] = JINGLE_MMX("punpckldq"),
+    [0x63] = JINGLE_MMX("packsswb"),  [0x64] = JINGLE_MMX("pcmpgtb"),   [0x65] = JINGLE_MMX("pcmpgtw"),
+    [0x66] = JINGLE_MMX("pcmpgtd"),   [0x67] = JINGLE_MMX("packuswb"),  [0x68] = JINGLE_MMX("punpckhbw"),
+    [0x69] = JINGLE_MMX("punpckhwd"), [0x6a] = JINGLE_MMX("punpckhdq"), [0x6b] = JINGLE_MMX("packssdw"),
+    [0x6c] = { "|punpcklqdq", "|Vx,Hx,Wx" },
+    [0x6d] = { "|punpckhqdq", "|Vx,Hx,Wx" },
+    [0x6e] = { "movd|movd", "Pq,Ey|Vo,Ey" },
+    [0x6f] = { "movq|movdqa|movdqu", "Pq,Qq|Vx,Wx|Vx,Wx" },
+    [0x70] = { "pshufw|pshufd|pshufhw|pshuflw", "Pq,Qq,Kb|Vx,Wx,Kb|Vx,Wx,Kb|Vx,Wx,Kb" },
+    [0x71] = { "#14", "" }, [0x72] = { "#15", "" }, [0x73] = { "#16", "" },
+    [0x74] = JINGLE_MMX("pcmpeqb"), [0x75] = JINGLE_MMX("pcmpeqw"), [0x76] = JINGLE_MMX("pcmpeqd"),
+    [0x77] = { "emms", "" },
+    [0x7c] = { "|haddpd||haddps", "|Vx,Hx,Wx||Vx,Hx,Wx" },
+    [0x7d] = { "|hsubpd||hsubps", "|Vx,Hx,Wx||Vx,Hx,Wx" },
+    [0x7e] = { "movd|movd|movq", "Ey,Pq|Ey,Vo|Vo,Wq" },
+    [0x7f] = { "movq|movdqa|movdqu", "Qq,Pq|Wx,Vx|Wx,Vx" },
+    JINGLE_CC(0x80, "j", "", "Jz"),
+    JINGLE_CC(0x90, "set", "", "Eb"),
+    [0xa0] = { "push", "fs" }, [0xa1] = { "pop", "fs" }, [0xa2] = { "cpuid", "" },
+    [0xa3] = { "bt", "Ev,Gv" }, [0xa4] = { "shld", "Ev,Gv,Kb" }, [0xa5] = { "shld", "Ev,Gv,cl" },
+    [0xa8] = { "push", "gs" }, [0xa9] = { "pop", "gs" }, [0xaa] = { "rsm", "" },
+    [0xab] = { "bts", "Ev,Gv" }, [0xac] = { "shrd", "Ev,Gv,Kb" }, [0xad] = { "shrd", "Ev,Gv,cl" },
+    [0xae] = { "#17", "" }, [0xaf] = { "imul", "Gv,Ev" },
+    [0xb0] = { "cmpxchg", "Eb,Gb" }, [0xb1] = { "cmpxchg", "Ev,Gv" },
+    [0xb2] = { "lss", "Gv,Mp" }, [0xb3] = { "btr", "Ev,Gv" }, [0xb4] = { "lfs", "Gv,Mp" }, [0xb5] = { "lgs", "Gv,Mp" },
+    [0xb6] = { "movzx", "Gv,Eb" }, [0xb7] = { "movzx", "Gv,Ew" },
+    [0xb8] = { "||popcnt", "||Gv,Ev" },
+    [0xb9] = { "ud1", "Gv,Ev" }, [0xba] = { "#18", "Ev,Kb" }, [0xbb] = { "btc", "Ev,Gv" },
+    [0xbc] = { "bsf||tzcnt", "Gv,Ev" }, [0xbd] = { "bsr||lzcnt", "Gv,Ev" },
+    [0xbe] = { "movsx", "Gv,Eb" }, [0xbf] = { "movsx", "Gv,Ew" },
+    [0xc0] = { "xadd", "Eb,Gb" }, [0xc1] = { "xadd", "Ev,Gv" },
+    [0xc2] = { "cmpps|cmppd|cmpss|cmpsd", "Vx,Hx,Wx,Kb|Vx,Hx,Wx,Kb|Vo,Hx,Wd,Kb|Vo,Hx,Wq,Kb" },
+    [0xc3] = { "movnti", "My,Gy" },
+    [0xc4] = { "pinsrw|pinsrw", "Pq,EW,Kb|Vo,Hx,EW,Kb" },
+    [0xc5] = { "pextrw|pextrw", "Gd,Nq,Kb|Gd,Uo,Kb" },
+    [0xc6] = { "shufps|shufpd", "Vx,Hx,Wx,Kb" },
+    [0xc7] = { "#19", "" },
+    JINGLE_RANGE8(0xc8, "bswap", "Zv", 0),
+    [0xd0] = { "|addsubpd||addsubps", "|Vx,Hx,Wx||Vx,Hx,Wx" },
+    [0xd1] = JINGLE_MMX("psrlw"),   [0xd2] = JINGLE_MMX("psrld"),   [0xd3] = JINGLE_MMX("psrlq"),
+    [0xd4] = JINGLE_MMX("paddq"),   [0xd5] = JINGLE_MMX("pmullw"),
+    [0xd6] = { "|movq", "|Wq,Vo" },
+    [0xd7] = { "pmovmskb|pmovmskb", "Gd,Nq|Gd,Ux" },
+    [0xd8] = JINGLE_MMX("psubusb"), [0xd9] = JINGLE_MMX("psubusw"), [0xda] = JINGLE_MMX("pminub"),
+    [0xdb] = JINGLE_MMX("pand"),    [0xdc] = JINGLE_MMX("paddusb"), [0xdd] = JINGLE_MMX("paddusw"),
+    [0xde] = JINGLE_MMX("pmaxub"),  [0xdf] = JINGLE_MMX("pandn"),   [0xe0] = JINGLE_MMX("pavgb"),
+    [0xe1] = JINGLE_MMX("psraw"),   [0xe2] = JINGLE_MMX("psrad"),   [0xe3] = JINGLE_MMX("pavgw"),
+    [0xe4] = JINGLE_MMX("pmulhuw"), [0xe5] = JINGLE_MMX("pmulhw"),
+    [0xe6] = { "|cvttpd2dq|cvtdq2pd|cvtpd2dq", "|Vo,Wx|Vx,Wh|Vo,Wx" },
+    [0xe7] = { "movntq|movntdq", "Mq,Pq|Mx,Vx" },
+    [0xe8] = JINGLE_MMX("psubsb"),  [0xe9] = JINGLE_MMX("psubsw"),  [0xea] = JINGLE_MMX("pminsw"),
+    [0xeb] = JINGLE_MMX("por"),     [0xec] = JINGLE_MMX("paddsb"),  [0xed] = JINGLE_MMX("paddsw"),
+    [0xee] = JINGLE_MMX("pmaxsw"),  [0xef] = JINGLE_MMX("pxor"),
+    [0xf0] = { "|||lddqu", "|||Vx,Mx" },
+    [0xf1] = JINGLE_MMX("psllw"),   [0xf2] = JINGLE_MMX("pslld"),   [0xf3] = JINGLE_MMX("psllq"),
+    [0xf4] = JINGLE_MMX("pmuludq"), [0xf5] = JINGLE_MMX("pmaddwd"), [0xf6] = JINGLE_MMX("psadbw"),
+    [0xf7] = { "maskmovq|maskmovdqu", "Pq,Nq|Vo,Uo" },
+    [0xf8] = JINGLE_MMX("psubb"),   [0xf9] = JINGLE_MMX("psubw"),   [0xfa] = JINGLE_MMX("psubd"),
+    [0xfb] = JINGLE_MMX("psubq"),   [0xfc] = JINGLE_MMX("paddb"),   [0xfd] = JINGLE_MMX("paddw"),
+    [0xfe] = JINGLE_MMX("paddd"),   [0xff] = { "ud0", "Gd,Ed" },
+};
+
+// 66 prefixed SSE4 forms
+#define JINGLE_SSE4(name, operands) { "|" name, "|" operands }
+
+// FMA at 0F 38 x6 to xF, x being 9, A or B. VEX.W picks between the single and double precision forms.
+#define JINGLE_FMA(base, order) \
+    [(base)+0x6] = { "|fmaddsub" order "ps/fmaddsub" order "ps/fmaddsub" order "pd", "|Vx,Hx,Wx", JINGLE_DIS_VEX }, \
+    [(base)+0x7] = { "|fmsubadd" order "ps/fmsubadd" order "ps/fmsubadd" order "pd", "|Vx,Hx,Wx", JINGLE_DIS_VEX }, \
+    [(base)+0x8] = { "|fmadd" order "ps/fmadd" order "ps/fmadd" order "pd", "|Vx,Hx,Wx", JINGLE_DIS_VEX }, \
+    [(base)+0x9] = { "|fmadd" order "ss/fmadd" order "ss/fmadd" order "sd", "|Vo,Hx,Wy", JINGLE_DIS_VEX }, \
+    [(base)+0xa] = { "|fmsub" order "ps/fmsub" order "ps/fmsub" order "pd", "|Vx,Hx,Wx", JINGLE_DIS_VEX }, \
+    [(base)+0xb] = { "|fmsub" order "ss/fmsub" order "ss/fmsub" order "sd", "|Vo,Hx,Wy", JINGLE_DIS_VEX }, \
+    [(base)+0xc] = { "|fnmadd" order "ps/fnmadd" order "ps/fnmadd" order "pd", "|Vx,Hx,Wx", JINGLE_DIS_VEX }, \
+    [(base)+0xd] = { "|fnmadd" order "ss/fnmadd" order "ss/fnmadd" order "sd", "|Vo,Hx,Wy", JINGLE_DIS_VEX }, \
+    [(base)+0xe] = { "|fnmsub" order "ps/fnmsub" order "ps/fnmsub" order "pd", "|Vx,Hx,Wx", JINGLE_DIS_VEX }, \
+    [(base)+0xf] = { "|fnmsub" order "ss/fnmsub" order "ss/fnmsub" order "sd", "|Vo,Hx,Wy", JINGLE_DIS_VEX }
+
+static const Jingle_Opcode JINGLE_MAP_0F38[256] = {
+    [0x00] = JINGLE_MMX("pshufb"),   [0x01] = JINGLE_MMX("phaddw"),   [0x02] = JINGLE_MMX("phaddd"),
+    [0x03] = JINGLE_MMX("phaddsw"),  [0x04] = JINGLE_MMX("pmaddubsw"), [0x05] = JINGLE_MMX("phsubw"),
+    [0x06] = JINGLE_MMX("phsubd"),   [0x07] = JINGLE_MMX("phsubsw"),  [0x08] = JINGLE_MMX("psignb"),
+    [0x09] = JINGLE_MMX("psignw"),   [0x0a] = JINGLE_MMX("psignd"),   [0x0b] = JINGLE_MMX("pmulhrsw"),
+    [0x0c] = { "|permilps", "|Vx,Hx,Wx", JINGLE_DIS_VEX },
+    [0x0d] = { "|permilpd", "|Vx,Hx,Wx", JINGLE_DIS_VEX },
+    [0x10] = JINGLE_SSE4("pblendvb", "Vx,Wx,xmm0"),
+    [0x14] = JINGLE_SSE4("blendvps", "Vx,Wx,xmm0"),
+    [0x15] = JINGLE_SSE4("blendvpd", "Vx,Wx,xmm0"),
+    [0x16] = { "|permps", "|Vx,Hx,Wx", JINGLE_DIS_VEX },
+    [0x17] = JINGLE_SSE4("ptest", "Vx,Wx"),
+    [0x18] = { "|broadcastss", "|Vx,Wd", JINGLE_DIS_VEX },
+    [0x19] = { "|broadcastsd", "|Vx,Wq", JINGLE_DIS_VEX },
+    [0x1a] = { "|broadcastf128", "|Vx,Mo", JINGLE_DIS_VEX },
+    [0x1c] = { "pabsb|pabsb", "Pq,Qq|Vx,Wx" },
+    [0x1d] = { "pabsw|pabsw", "Pq,Qq|Vx,Wx" },
+    [0x1e] = { "pabsd|pabsd", "Pq,Qq|Vx,Wx" },
+    [0x20] = JINGLE_SSE4("pmovsxbw", "Vx,Wh"), [0x21] = JINGLE_SSE4("pmovsxbd", "Vx,Wu"),
+    [0x22] = JINGLE_SSE4("pmovsxbq", "Vx,We"), [0x23] = JINGLE_SSE4("pmovsxwd", "Vx,Wh"),
+    [0x24] = JINGLE_SSE4("pmovsxwq", "Vx,Wu"), [0x25] = JINGLE_SSE4("pmovsxdq", "Vx,Wh"),
+    [0x28] = JINGLE_SSE4("pmuldq", "Vx,Hx,Wx"),  [0x29] = JINGLE_SSE4("pcmpeqq", "Vx,Hx,Wx"),
+    [0x2a] = JINGLE_SSE4("movntdqa", "Vx,Mx"),   [0x2b] = JINGLE_SSE4("packusdw", "Vx,Hx,Wx"),
+    [0x30] = JINGLE_SSE4("pmovzxbw", "Vx,Wh"), [0x31] = JINGLE_SSE4("pmovzxbd", "Vx,Wu"),
+    [0x32] = JINGLE_SSE4("pmovzxbq", "Vx,We"), [0x33] = JINGLE_SSE4("pmovzxwd", "Vx,Wh"),
+    [0x34] = JINGLE_SSE4("pmovzxwq", "Vx,Wu"), [0x35] = JINGLE_SSE4("pmovzxdq", "Vx,Wh"),
+    [0x36] = { "|permd", "|Vx,Hx,Wx", JINGLE_DIS_VEX },
+    [0x37] = JINGLE_SSE4("pcmpgtq", "Vx,Hx,Wx"),
+    [0x38] = JINGLE_SSE4("pminsb", "Vx,Hx,Wx"), [0x39] = JINGLE_SSE4("pminsd", "Vx,Hx,Wx"),
+    [0x3a] = JINGLE_SSE4("pminuw", "Vx,Hx,Wx"), [0x3b] = JINGLE_SSE4("pminud", "Vx,Hx,Wx"),
+    [0x3c] = JINGLE_SSE4("pmaxsb", "Vx,Hx,Wx"), [0x3d] = JINGLE_SSE4("pmaxsd", "Vx,Hx,Wx"),
+    [0x3e] = JINGLE_SSE4("pmaxuw", "Vx,Hx,Wx"), [0x3f] = JINGLE_SSE4("pmaxud", "Vx,Hx,Wx"),
+    [0x40] = JINGLE_SSE4("pmulld", "Vx,Hx,Wx"), [0x41] = JINGLE_SSE4("phminposuw", "Vo,Wo"),
+    [0x45] = { "|psrlvd", "|Vx,Hx,Wx", JINGLE_DIS_VEX },
+    [0x46] = { "|psravd", "|Vx,Hx,Wx", JINGLE_DIS_VEX },
+    [0x47] = { "|psllvd", "|Vx,Hx,Wx", JINGLE_DIS_VEX },
+    [0x58] = { "|pbroadcastd", "|Vx,Wd", JINGLE_DIS_VEX },
+    [0x59] = { "|pbroadcastq", "|Vx,Wq", JINGLE_DIS_VEX },
+    [0x78] = { "|pbroadcastb", "|Vx,Wb", JINGLE_DIS_VEX },
+    [0x79] = { "|pbroadcastw", "|Vx,Ww", JINGLE_DIS_VEX },
+    JINGLE_FMA(0x90, "132"), JINGLE_FMA(0xa0, "213"), JINGLE_FMA(0xb0, "231"),
+    [0xdb] = JINGLE_SSE4("aesimc", "Vo,Wo"),
+    [0xdc] = JINGLE_SSE4("aesenc", "Vx,Hx,Wx"),     [0xdd] = JINGLE_SSE4("aesenclast", "Vx,Hx,Wx"),
+    [0xde] = JINGLE_SSE4("aesdec", "Vx,Hx,Wx"),     [0xdf] = JINGLE_SSE4("aesdeclast", "Vx,Hx,Wx"),
+    [0xf0] = { "movbe|movbe||crc32", "Gv,Mv|Gv,Mv||Gy,Eb" },
+    [0xf1] = { "movbe|movbe||crc32", "Mv,Gv|Mv,Gv||Gy,Ev" },
+    [0xf2] = { "andn", "Gy,By,Ey", JINGLE_DIS_VEX },
+    [0xf3] = { "#20", "By,Ey", JINGLE_DIS_VEX },
+    [0xf5] = { "bzhi||pext|pdep", "Gy,Ey,By||Gy,By,Ey|Gy,By,Ey", JINGLE_DIS_VEX },
+    [0xf6] = { "|||mulx", "|||Gy,By,Ey", JINGLE_DIS_VEX },
+    [0xf7] = { "bextr|shlx|sarx|shrx", "Gy,Ey,By", JINGLE_DIS_VEX },
+};
+
+static const Jingle_Opcode JINGLE_MAP_0F3A[256] = {
+    [0x00] = { "|permq", "|Vx,Wx,Kb", JINGLE_DIS_VEX },
+    [0x01] = { "|permpd", "|Vx,Wx,Kb", JINGLE_DIS_VEX },
+    [0x02] = { "|pblendd", "|Vx,Hx,Wx,Kb", JINGLE_DIS_VEX },
+    [0x04] = { "|permilps", "|Vx,Wx,Kb", JINGLE_DIS_VEX },
+    [0x05] = { "|permilpd", "|Vx,Wx,Kb", JINGLE_DIS_VEX },
+    [0x06] = { "|perm2f128", "|Vx,Hx,Wx,Kb", JINGLE_DIS_VEX },
+    [0x08] = JINGLE_SSE4("roundps", "Vx,Wx,Kb"),    [0x09] = JINGLE_SSE4("roundpd", "Vx,Wx,Kb"),
+    [0x0a] = JINGLE_SSE4("roundss", "Vo,Hx,Wd,Kb"), [0x0b] = JINGLE_SSE4("roundsd", "Vo,Hx,Wq,Kb"),
+    [0x0c] = JINGLE_SSE4("blendps", "Vx,Hx,Wx,Kb"), [0x0d] = JINGLE_SSE4("blendpd", "Vx,Hx,Wx,Kb"),
+    [0x0e] = JINGLE_SSE4("pblendw", "Vx,Hx,Wx,Kb"),
+    [0x0f] = { "palignr|palignr", "Pq,Qq,Kb|Vx,Hx,Wx,Kb" },
+    [0x14] = JINGLE_SSE4("pextrb", "EB,Vo,Kb"),   [0x15] = JINGLE_SSE4("pextrw", "EW,Vo,Kb"),
+    [0x16] = JINGLE_SSE4("pextrd", "Ey,Vo,Kb"),   [0x17] = JINGLE_SSE4("extractps", "Ed,Vo,Kb"),
+    [0x18] = { "|insertf128", "|Vx,Hx,Wo,Kb", JINGLE_DIS_VEX },
+    [0x19] = { "|extractf128", "|Wo,Vx,Kb", JINGLE_DIS_VEX },
+    [0x20] = JINGLE_SSE4("pinsrb", "Vo,Hx,EB,Kb"), [0x21] = JINGLE_SSE4("insertps", "Vo,Hx,Wd,Kb"),
+    [0x22] = JINGLE_SSE4("pinsrd", "Vo,Hx,Ey,Kb"),
+    [0x38] = { "|inserti128", "|Vx,Hx,Wo,Kb", JINGLE_DIS_VEX },
+    [0x39] = { "|extracti128", "|Wo,Vx,Kb", JINGLE_DIS_VEX },
+    [0x40] = JINGLE_SSE4("dpps", "Vx,Hx,Wx,Kb"),   [0x41] = JINGLE_SSE4("dppd", "Vx,Hx,Wx,Kb"),
+    [0x42] = JINGLE_SSE4("mpsadbw", "Vx,Hx,Wx,Kb"),
+    [0x44] = JINGLE_SSE4("pclmulqdq", "Vx,Hx,Wx,Kb"),
+    [0x46] = { "|perm2i128", "|Vx,Hx,Wx,Kb", JINGLE_DIS_VEX },
+    [0x60] = JINGLE_SSE4("pcmpestrm", "Vo,Wo,Kb"), [0x61] = JINGLE_SSE4("pcmpestri", "Vo,Wo,Kb"),
+    [0x62] = JINGLE_SSE4("pcmpistrm", "Vo,Wo,Kb"), [0x63] = JINGLE_SSE4("pcmpistri", "Vo,Wo,Kb"),
+    [0x4a] = { "|blendvps", "|Vx,Hx,Wx,Lx", JINGLE_DIS_VEX },
+    [0x4b] = { "|blendvpd", "|Vx,Hx,Wx,Lx", JINGLE_DIS_VEX },
+    [0x4c] = { "|pblendvb", "|Vx,Hx,Wx,Lx", JINGLE_DIS_VEX },
+    [0xdf] = JINGLE_SSE4("aeskeygenassist", "Vo,Wo,Kb"),
+    [0xf0] = { "|||rorx", "|||Gy,Ey,Kb", JINGLE_DIS_VEX },
+};
+
+/// Opcode extension groups, indexed by ModRM.reg. reg[] holds the register (mod == 3) forms where they differ from
+/// the memory ones; an entry without operands takes those of the opcode that led here.
+typedef struct {
+    Jingle_Opcode mem[8];
+    Jingle_Opcode reg[8];
+} Jingle_Group;
+
+#define JINGLE_BAD { "(bad)", "" }
+
+static const Jingle_Group JINGLE_GROUPS[] = {
+    [1] = { .mem = { { "add" }, { "or" }, { "adc" }, { "sbb" }, { "and" }, { "sub" }, { "xor" }, { "cmp" } } },
+    [2] = { .mem = { { "pop" }, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD } },
+    [3] = { .mem = { { "rol" }, { "ror" }, { "rcl" }, { "rcr" }, { "shl" }, { "shr" }, { "sal" }, { "sar" } } },
+    [4] = { .mem = { { "test", "Eb,Ib" }, { "test", "Eb,Ib" }, { "not" }, { "neg" }, { "mul" }, { "imul" }, { "div" }, { "idiv" } } },
+    [5] = { .mem = { { "test", "Ev,Iz" }, { "test", "Ev,Iz" }, { "not" }, { "neg" }, { "mul" }, { "imul" }, { "div" }, { "idiv" } } },
+    [6] = { .mem = { { "inc" }, { "dec" }, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD } },
+    [7] = { .mem = {
+        { "inc" }, { "dec" }, { "call", "Ev", JINGLE_DIS_D64 }, { "call", "Mp" },
+        { "jmp", "Ev", JINGLE_DIS_D64 }, { "jmp", "Mp" }, { "push", "Ev", JINGLE_DIS_D64 }, JINGLE_BAD,
+    } },
+    [8] = { .mem = { { "sldt" }, { "str" }, { "lldt" }, { "ltr" }, { "verr" }, { "verw" }, JINGLE_BAD, JINGLE_BAD } },
+    // 0F 01; the register forms are all special cases, see JINGLE_0F01_REG
+    [9] = { .mem = {
+        { "sgdt", "M" }, { "sidt", "M" }, { "lgdt", "M" }, { "lidt", "M" },
+        { "smsw", "Ew" }, JINGLE_BAD, { "lmsw", "Ew" }, { "invlpg", "Mb" },
+    } },
+    [10] = { .mem = { { "prefetch" }, { "prefetchw" }, { "prefetchwt1" }, { "prefetch" }, { "prefetch" }, { "prefetch" }, { "prefetch" }, { "prefetch" } } },
+    [11] = {
+        .mem = { { "mov" }, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD },
+        .reg = { [7] = { "xabort", "Kb" } },
+    },
+    [12] = {
+        .mem = { { "mov" }, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD },
+        .reg = { [7] = { "xbegin", "Jz" } },
+    },
+    [13] = {
+        .mem = { { "prefetchnta" }, { "prefetcht0" }, { "prefetcht1" }, { "prefetcht2" }, { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" } },
+        .reg = { { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" }, { "nop", "Ev" } },
+    },
+    [14] = { .reg = {
+        JINGLE_BAD, JINGLE_BAD, { "psrlw|psrlw", "Nq,Kb|Hx,Ux,Kb" }, JINGLE_BAD,
+        { "psraw|psraw", "Nq,Kb|Hx,Ux,Kb" }, JINGLE_BAD, { "psllw|psllw", "Nq,Kb|Hx,Ux,Kb" }, JINGLE_BAD,
+    }, .mem = { JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD } },
+    [15] = { .reg = {
+        JINGLE_BAD, JINGLE_BAD, { "psrld|psrld", "Nq,Kb|Hx,Ux,Kb" }, JINGLE_BAD,
+        { "psrad|psrad", "Nq,Kb|Hx,Ux,Kb" }, JINGLE_BAD, { "pslld|pslld", "Nq,Kb|Hx,Ux,Kb" }, JINGLE_BAD,
+    }, .mem = { JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD } },
+    [16] = { .reg = {
+        JINGLE_BAD, JINGLE_BAD, { "psrlq|psrlq", "Nq,Kb|Hx,Ux,Kb" }, { "|psrldq", "|Hx,Ux,Kb" },
+        JINGLE_BAD, JINGLE_BAD, { "psllq|psllq", "Nq,Kb|Hx,Ux,Kb" }, { "|pslldq", "|Hx,Ux,Kb" },
+    }, .mem = { JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD } },
+    [17] = {
+        .mem = { { "fxsave", "M" }, { "fxrstor", "M" }, { "ldmxcsr", "Md", JINGLE_DIS_V }, { "stmxcsr", "Md", JINGLE_DIS_V }, { "xsave", "M" }, { "xrstor", "M" }, { "xsaveopt", "M" }, { "clflush", "Mb" } },
+        .reg = { { "||rdfsbase", "||Ey" }, { "||rdgsbase", "||Ey" }, { "||wrfsbase", "||Ey" }, { "||wrgsbase", "||Ey" }, JINGLE_BAD, { "lfence", "" }, { "mfence", "" }, { "sfence", "" } },
+    },
+    [18] = { .mem = { JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, { "bt" }, { "bts" }, { "btr" }, { "btc" } } },
+    [19] = {
+        .mem = { JINGLE_BAD, { "cmpxchg8b/cmpxchg8b/cmpxchg16b", "Mq" }, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD },
+        .reg = { JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, { "rdrand", "Ev" }, { "rdseed", "Ev" } },
+    },
+    [20] = { .mem = { JINGLE_BAD, { "blsr" }, { "blsmsk" }, { "blsi" }, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD } },
+};
+
+/// 0F 01 with mod == 3, by the whole ModRM byte
+static const struct { unsigned char modrm; const char *mnemonic; } JINGLE_0F01_REG[] = {
+    { 0xc1, "vmcall" }, { 0xc2, "vmlaunch" }, { 0xc3, "vmresume" }, { 0xc4, "vmxoff" },
+    { 0xc8, "monitor" }, { 0xc9, "mwait" }, { 0xca, "clac" }, { 0xcb, "stac" },
+    { 0xd0, "xgetbv" }, { 0xd1, "xsetbv" }, { 0xd5, "xend" }, { 0xd6, "xtest" },
+    { 0xee, "rdpkru" }, { 0xef, "wrpkru" }, { 0xf8, "swapgs" }, { 0xf9, "rdtscp" },
+    { 0xfa, "monitorx" }, { 0xfb, "mwaitx" }, { 0xfc, "clzero" },
+};
+
+/// x87, D8 to DF. Memory forms by opcode and ModRM.reg; register forms the same way, "#" meaning "look the whole
+/// ModRM byte up in JINGLE_X87_SPECIAL".
+static const Jingle_Opcode JINGLE_X87_MEM[8][8] = {
+    { { "fadd", "Md" }, { "fmul", "Md" }, { "fcom", "Md" }, { "fcomp", "Md" }, { "fsub", "Md" }, { "fsubr", "Md" }, { "fdiv", "Md" }, { "fdivr", "Md" } },
+    { { "fld", "Md" }, JINGLE_BAD, { "fst", "Md" }, { "fstp", "Md" }, { "fldenv", "M" }, { "fldcw", "Mw" }, { "fnstenv", "M" }, { "fnstcw", "Mw" } },
+    { { "fiadd", "Md" }, { "fimul", "Md" }, { "ficom", "Md" }, { "ficomp", "Md" }, { "fisub", "Md" }, { "fisubr", "Md" }, { "fidiv", "Md" }, { "fidivr", "Md" } },
+    { { "fild", "Md" }, { "fisttp", "Md" }, { "fist", "Md" }, { "fistp", "Md" }, JINGLE_BAD, { "fld", "Mt" }, JINGLE_BAD, { "fstp", "Mt" } },
+    { { "fadd", "Mq" }, { "fmul", "Mq" }, { "fcom", "Mq" }, { "fcomp", "Mq" }, { "fsub", "Mq" }, { "fsubr", "Mq" }, { "fdiv", "Mq" }, { "fdivr", "Mq" } },
+    { { "fld", "Mq" }, { "fisttp", "Mq" }, { "fst", "Mq" }, { "fstp", "Mq" }, { "frstor", "M" }, JINGLE_BAD, { "fnsave", "M" }, { "fnstsw", "Mw" } },
+    { { "fiadd", "Mw" }, { "fimul", "Mw" }, { "ficom", "Mw" }, { "ficomp", "Mw" }, { "fisub", "Mw" }, { "fisubr", "Mw" }, { "fidiv", "Mw" }, { "fidivr", "Mw" } },
+    { { "fild", "Mw" }, { "fisttp", "Mw" }, { "fist", "Mw" }, { "fistp", "Mw" }, { "fbld", "Mt" }, { "fild", "Mq" }, { "fbstp", "Mt" }, { "fistp", "Mq" } },
+};
+
+static const Jingle_Opcode JINGLE_X87_REG[8][8] = {
+    { { "fadd", "st,F" }, { "fmul", "st,F" }, { "fcom", "F" }, { "fcomp", "F" }, { "fsub", "st,F" }, { "fsubr", "st,F" }, { "fdiv", "st,F" }, { "fdivr", "st,F" } },
+    { { "fld", "F" }, { "fxch", "F" }, { "#" }, JINGLE_BAD, { "#" }, { "#" }, { "#" }, { "#" } },
+    { { "fcmovb", "st,F" }, { "fcmove", "st,F" }, { "fcmovbe", "st,F" }, { "fcmovu", "st,F" }, JINGLE_BAD, { "#" }, JINGLE_BAD, JINGLE_BAD },
+    { { "fcmovnb", "st,F" }, { "fcmovne", "st,F" }, { "fcmovnbe", "st,F" }, { "fcmovnu", "st,F" }, { "#" }, { "fucomi", "st,F" }, { "fcomi", "st,F" }, JINGLE_BAD },
+    { { "fadd", "F,st" }, { "fmul", "F,st" }, JINGLE_BAD, JINGLE_BAD, { "fsubr", "F,st" }, { "fsub", "F,st" }, { "fdivr", "F,st" }, { "fdiv", "F,st" } },
+    { { "ffree", "F" }, JINGLE_BAD, { "fst", "F" }, { "fstp", "F" }, { "fucom", "F" }, { "fucomp", "F" }, JINGLE_BAD, JINGLE_BAD },
+    { { "faddp", "F,st" }, { "fmulp", "F,st" }, JINGLE_BAD, { "#" }, { "fsubrp", "F,st" }, { "fsubp", "F,st" }, { "fdivrp", "F,st" }, { "fdivp", "F,st" } },
+    { { "ffreep", "F" }, JINGLE_BAD, JINGLE_BAD, JINGLE_BAD, { "#" }, { "fucomip", "st,F" }, { "fcomip", "st,F" }, JINGLE_BAD },
+};
+
+static const struct { unsigned char opcode, modrm; const char *mnemonic, *operands; } JINGLE_X87_SPECIAL[] = {
+    { 0xd9, 0xd0, "fnop", "" },
+    { 0xd9, 0xe0, "fchs", "" },   { 0xd9, 0xe1, "fabs", "" },    { 0xd9, 0xe4, "ftst", "" },    { 0xd9, 0xe5, "fxam", "" },
+    { 0xd9, 0xe8, "fld1", "" },   { 0xd9, 0xe9, "fldl2t", "" },  { 0xd9, 0xea, "fldl2e", "" },  { 0xd9, 0xeb, "fldpi", "" },
+    { 0xd9, 0xec, "fldlg2", "" }, { 0xd9, 0xed, "fldln2", "" },  { 0xd9, 0xee, "fldz", "" },
+    { 0xd9, 0xf0, "f2xm1", "" },  { 0xd9, 0xf1, "fyl2x", "" },   { 0xd9, 0xf2, "fptan", "" },   { 0xd9, 0xf3, "fpatan", "" },
+    { 0xd9, 0xf4, "fxtract", "" }, { 0xd9, 0xf5, "fprem1", "" }, { 0xd9, 0xf6, "fdecstp", "" }, { 0xd9, 0xf7, "fincstp", "" },
+    { 0xd9, 0xf8, "fprem", "" },  { 0xd9, 0xf9, "fyl2xp1", "" }, { 0xd9, 0xfa, "fsqrt", "" },   { 0xd9, 0xfb, "fsincos", "" },
+    { 0xd9, 0xfc, "frndint", "" }, { 0xd9, 0xfd, "fscale", "" }, { 0xd9, 0xfe, "fsin", "" },    { 0xd9, 0xff, "fcos", "" },
+    { 0xda, 0xe9, "fucompp", "" },
+    { 0xdb, 0xe2, "fnclex", "" }, { 0xdb, 0xe3, "fninit", "" },
+    { 0xde, 0xd9, "fcompp", "" },
+    { 0xdf, 0xe0, "fnstsw", "ax" },
+};
+
+static const char *const JINGLE_CMP_PREDICATES[32] = {
+    "eq", "lt", "le", "unord", "neq", "nlt", "nle", "ord",
+    "eq_uq", "nge", "ngt", "false", "neq_oq", "ge", "gt", "true",
+    "eq_os", "lt_oq", "le_oq", "unord_s", "neq_us", "nlt_uq", "nle_uq", "ord_s",
+    "eq_us", "nge_uq", "ngt_uq", "false_os", "neq_os", "ge_oq", "gt_oq", "true_us",
+};
+
+static const char *const JINGLE_GPR64[16] = { "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15" };
+static const char *const JINGLE_GPR32[16] = { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d" };
+static const char *const JINGLE_GPR16[16] = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di", "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w" };
+static const char *const JINGLE_GPR8[16]  = { "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil", "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b" };
+static const char *const JINGLE_GPR8_LEGACY[8] = { "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh" };
+static const char *const JINGLE_SEGMENTS[8] = { "es", "cs", "ss", "ds", "fs", "gs", "?", "?" };
+
+/// Decoder state for one instruction
+typedef struct {
+    const unsigned char *p;
+    size_t n, at;
+    bool overrun;
+    uint64_t address;
+
+    unsigned rex;        // the REX byte, or 0
+    unsigned opsize;     // number of 66 prefixes
+    bool adsize, lock;
+    unsigned char rep;   // 0xf2 or 0xf3, whichever came last
+    int segment;         // index into JINGLE_SEGMENTS, or -1
+    bool vex;
+    unsigned vex_l, vex_v, vex_pp;
+    unsigned map, opcode;
+    unsigned flags;
+    int osize;
+
+    bool has_modrm;
+    unsigned modrm, mod, reg, rm;
+    bool rip, no_base, has_index;
+    unsigned base, index, scale;
+    int64_t disp;
+
+    uint64_t imm[2];
+    unsigned imm_size[2];
+    unsigned imm_count;
+} Jingle_Dis;
+
+static unsigned
+jingle_dis_byte(Jingle_Dis *d)
+{
+    if (d->at >= d->n || d->at >= 15) {
+        d->overrun = true;
+        return 0;
+    }
+    return d->p[d->at++];
+}
+
+static uint64_t
+jingle_dis_le(Jingle_Dis *d, unsigned size)
+{
+    uint64_t v = 0;
+    for (unsigned i = 0; i < size; ++i) v |= (uint64_t)jingle_dis_byte(d) << (8*i);
+    return v;
+}
+
+static int64_t
+jingle_dis_sext(uint64_t v, unsigned bits)
+{
+    if (bits >= 64) return (int64_t)v;
+    uint64_t sign = 1ULL << (bits - 1);
+    v &= (sign << 1) - 1;
+    return (int64_t)((v ^ sign) - sign);
+}
+
+static void
+jingle_dis_modrm(Jingle_Dis *d)
+{
+    if (d->has_modrm) return;
+    d->has_modrm = true;
+
+    unsigned m = jingle_dis_byte(d);
+    d->modrm = m;
+    d->mod = m >> 6;
+    d->reg = ((m >> 3) & 7) | (d->rex & 4 ? 8 : 0);
+    d->rm = (m & 7) | (d->rex & 1 ? 8 : 0);
+    if (d->mod == 3) return;
+
+    d->base = d->rm;
+    if ((m & 7) == 4) {
+        unsigned sib = jingle_dis_byte(d);
+        d->scale = 1u << (sib >> 6);
+        d->index = ((sib >> 3) & 7) | (d->rex & 2 ? 8 : 0);
+        d->has_index = d->index != 4;
+        d->base = (sib & 7) | (d->rex & 1 ? 8 : 0);
+        if ((sib & 7) == 5 && d->mod == 0) {
+            d->no_base = true;
+            d->disp = jingle_dis_sext(jingle_dis_le(d, 4), 32);
+        }
+    } else if ((m & 7) == 5 && d->mod == 0) {
+        d->rip = true;
+        d->disp = jingle_dis_sext(jingle_dis_le(d, 4), 32);
+    }
+
+    if (d->mod == 1) d->disp = jingle_dis_sext(jingle_dis_le(d, 1), 8);
+    if (d->mod == 2) d->disp = jingle_dis_sext(jingle_dis_le(d, 4), 32);
+}
+
+/// Size in bits for a size letter, 0 if there is none
+static int
+jingle_dis_bits(Jingle_Dis *d, char size)
+{
+    switch (size) {
+    case 'b': return 8;
+    case 'w': return 16;
+    case 'd': return 32;
+    case 'q': return 64;
+    case 'v': return d->osize;
+    case 'z': return d->osize == 16 ? 16 : 32;
+    case 'y': return d->rex & 8 ? 64 : 32;
+    case 'o': return 128;
+    case 'x': return d->vex_l ? 256 : 128;
+    case 'h': return d->vex_l ? 128 : 64;
+    case 'u': return d->vex_l ? 64 : 32;
+    case 'e': return d->vex_l ? 32 : 16;
+    case 'B': return 8;
+    case 'W': return 16;
+    case 't': return 80;
+    case 'p': return 48;
+    default:  return 0;
+    }
+}
+
+static const char *
+jingle_dis_gpr(Jingle_Dis *d, unsigned r, int bits)
+{
+    switch (bits) {
+    case 8:  return d->rex ? JINGLE_GPR8[r] : JINGLE_GPR8_LEGACY[r & 7];
+    case 16: return JINGLE_GPR16[r];
+    case 64: return JINGLE_GPR64[r];
+    default: return JINGLE_GPR32[r];
+    }
+}
+
+static const char *
+jingle_dis_ptr(int bits)
+{
+    switch (bits) {
+    case 8:   return "BYTE PTR ";
+    case 16:  return "WORD PTR ";
+    case 32:  return "DWORD PTR ";
+    case 48:  return "FWORD PTR ";
+    case 64:  return "QWORD PTR ";
+    case 80:  return "TBYTE PTR ";
+    case 128: return "XMMWORD PTR ";
+    case 256: return "YMMWORD PTR ";
+    default:  return "";
+    }
+}
+
+static size_t
+jingle_dis_mem(Jingle_Dis *d, int bits, char *out, size_t size)
+{
+    const char *const *regs = d->adsize ? JINGLE_GPR32 : JINGLE_GPR64;
+    // fs and gs mean something in 64 bit mode; the others are printed as plain prefixes
+    const char *segment = d->segment == 4 || d->segment == 5 ? JINGLE_SEGMENTS[d->segment] : NULL;
+    size_t n = snprintf(out, size, "%s", jingle_dis_ptr(bits));
+
+    if (d->no_base && !d->has_index) {
+        uint64_t v = d->adsize ? (uint32_t)d->disp : (uint64_t)d->disp;
+        return n + snprintf(out + n, size - n, "%s:0x%lx", segment ? segment : "ds", v);
+    }
+
+    if (segment) n += snprintf(out + n, size - n, "%s:", segment);
+    n += snprintf(out + n, size - n, "[");
+    if (d->rip) {
+        n += snprintf(out + n, size - n, "%s", d->adsize ? "eip" : "rip");
+    } else {
+        if (!d->no_base) n += snprintf(out + n, size - n, "%s", regs[d->base]);
+        if (d->has_index) n += snprintf(out + n, size - n, "%s%s*%u", d->no_base ? "" : "+", regs[d->index], d->scale);
+    }
+    if (d->mod != 0 || d->rip || d->no_base) {
+        if (d->disp < 0) n += snprintf(out + n, size - n, "-0x%lx", (uint64_t)-d->disp);
+        else n += snprintf(out + n, size - n, "+0x%lx", (uint64_t)d->disp);
+    }
+    return n + snprintf(out + n, size - n, "]");
+}
+
+static bool
+jingle_dis_has_xmm(const char *operands)
+{
+    for (const char *t = operands; *t; ++t) {
+        bool start = t == operands || t[-1] == ',';
+        if (start && strchr("VWUHL", *t)) return true;
+    }
+    return false;
+}
+
+static bool
+jingle_dis_needs_modrm(const char *operands)
+{
+    for (const char *t = operands; *t; ++t) {
+        bool start = t == operands || t[-1] == ',';
+        if (start && *t != '\0' && strchr("EGMRSCDVWUPQNF", *t)) return true;
+    }
+    return false;
+}
+
+/// Immediate size in bytes for an I, K, J or O token, 0 for anything else
+static unsigned
+jingle_dis_imm_size(Jingle_Dis *d, const char *token)
+{
+    char size = token[1];
+    switch (token[0]) {
+    case 'L':
+        return 1;
+    case 'I':
+    case 'K':
+        if (size == 'v') return d->osize / 8;
+        if (size == 'z') return d->osize == 16 ? 2 : 4;
+        return jingle_dis_bits(d, size) / 8;
+    case 'J':
+        return size == 'b' ? 1 : 4;
+    case 'O':
+        return d->adsize ? 4 : 8;
+    default:
+        return 0;
+    }
+}
+
+static const char *
+jingle_dis_xmm(unsigned r, int bits, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s%u", bits == 256 ? "ymm" : "xmm", r);
+    return buf;
+}
+
+/// Formats one operand token. Returns false if the token is dropped (H without VEX).
+static bool
+jingle_dis_operand(Jingle_Dis *d, const char *token, size_t len, int first_bits, unsigned *imm, Jingle_Insn *insn, char *out, size_t size)
+{
+    char buf[16];
+    char kind = token[0];
+    int bits = len > 1 ? jingle_dis_bits(d, token[1]) : 0;
+
+    if (!(kind >= 'A' && kind <= 'Z')) {
+        snprintf(out, size, "%.*s", (int)len, token);
+        return true;
+    }
+
+    switch (kind) {
+    case 'A': snprintf(out, size, "%s", jingle_dis_gpr(d, 0, bits)); break;
+    case 'Z': snprintf(out, size, "%s", jingle_dis_gpr(d, (d->opcode & 7) | (d->rex & 1 ? 8 : 0), bits)); break;
+    case 'G': snprintf(out, size, "%s", jingle_dis_gpr(d, d->reg, bits)); break;
+    case 'S': snprintf(out, size, "%s", JINGLE_SEGMENTS[d->reg & 7]); break;
+    case 'C': snprintf(out, size, "cr%u", d->reg); break;
+    case 'D': snprintf(out, size, "dr%u", d->reg); break;
+    case 'F': snprintf(out, size, "st(%u)", d->rm & 7); break;
+    case 'P': snprintf(out, size, "mm%u", d->reg & 7); break;
+    case 'V': snprintf(out, size, "%s", jingle_dis_xmm(d->reg, bits, buf, sizeof(buf))); break;
+    case 'B': snprintf(out, size, "%s", jingle_dis_gpr(d, d->vex_v, bits)); break;
+    case 'L': {
+        unsigned i = (*imm)++;
+        snprintf(out, size, "%s", jingle_dis_xmm((d->imm[i] >> 4) & 15, bits, buf, sizeof(buf)));
+    } break;
+    case 'H':
+        if (!d->vex) return false;
+        snprintf(out, size, "%s", jingle_dis_xmm(d->vex_v, bits, buf, sizeof(buf)));
+        break;
+    case 'E':
+    case 'R':
+    case 'M':
+        if (d->mod == 3 && (token[1] == 'B' || token[1] == 'W')) bits = 32;
+        if (d->mod == 3) snprintf(out, size, "%s", jingle_dis_gpr(d, d->rm, bits));
+        else jingle_dis_mem(d, bits, out, size);
+        break;
+    case 'U':
+    case 'W':
+        if (d->mod == 3) snprintf(out, size, "%s", jingle_dis_xmm(d->rm, bits, buf, sizeof(buf)));
+        else jingle_dis_mem(d, bits, out, size);
+        break;
+    case 'N':
+    case 'Q':
+        if (d->mod == 3) snprintf(out, size, "mm%u", d->rm & 7);
+        else jingle_dis_mem(d, bits, out, size);
+        break;
+    case 'I': {
+        // Sign extended to the size of the destination, like the CPU does
+        unsigned i = (*imm)++;
+        int to = first_bits > 0 ? first_bits : d->osize;
+        uint64_t v = (uint64_t)jingle_dis_sext(d->imm[i], d->imm_size[i] * 8);
+        if (to < 64) v &= (1ULL << to) - 1;
+        snprintf(out, size, "0x%lx", v);
+    } break;
+    case 'K': {
+        unsigned i = (*imm)++;
+        snprintf(out, size, "0x%lx", d->imm[i]);
+    } break;
+    case 'J': {
+        unsigned i = (*imm)++;
+        uint64_t target = d->address + d->at + jingle_dis_sext(d->imm[i], d->imm_size[i] * 8);
+        insn->has_target = true;
+        insn->target = target;
+        snprintf(out, size, "%lx", target);
+    } break;
+    case 'O': {
+        unsigned i = (*imm)++;
+        const char *segment = d->segment == 4 || d->segment == 5 ? JINGLE_SEGMENTS[d->segment] : "ds";
+        snprintf(out, size, "%s:0x%lx", segment, d->imm[i]);
+    } break;
+    default:
+        snprintf(out, size, "?");
+        break;
+    }
+    return true;
+}
+
+/// Picks part i of a "|" separated list into buf; false if that part is missing or empty
+static bool
+jingle_dis_part(const char *list, unsigned i, char *buf, size_t size)
+{
+    const char *s = list;
+    for (unsigned k = 0; k < i; ++k) {
+        s = strchr(s, '|');
+        if (s == NULL) return false;
+        s++;
+    }
+    const char *end = strchr(s, '|');
+    size_t len = end ? (size_t)(end - s) : strlen(s);
+    if (len == 0 || len >= size) return false;
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    return true;
+}
+
+static void
+jingle_dis_bad(Jingle_Insn *insn)
+{
+    insn->length = 1;
+    insn->has_target = false;
+    snprintf(insn->text, sizeof(insn->text), "(bad)");
+}
+
+/// Decodes the instruction at code[0..n), which sits at address. Never fails: bytes that don't decode come out as
+/// a one byte "(bad)".
+void
+jingle_disasm(const unsigned char *code, size_t n, uint64_t address, Jingle_Insn *insn)
+{
+    Jingle_Dis d = { .p = code, .n = n, .address = address, .segment = -1 };
+    *insn = (Jingle_Insn){0};
+
+    // Legacy prefixes, then REX, VEX or EVEX
+    unsigned b;
+    for (;;) {
+        b = jingle_dis_byte(&d);
+        if (d.overrun) return jingle_dis_bad(insn);
+        if (b == 0x66) d.opsize++;
+        else if (b == 0x67) d.adsize = true;
+        else if (b == 0xf0) d.lock = true;
+        else if (b == 0xf2 || b == 0xf3) d.rep = b;
+        else if (b == 0x26) d.segment = 0;
+        else if (b == 0x2e) d.segment = 1;
+        else if (b == 0x36) d.segment = 2;
+        else if (b == 0x3e) d.segment = 3;
+        else if (b == 0x64) d.segment = 4;
+        else if (b == 0x65) d.segment = 5;
+        else break;
+    }
+    if (b >= 0x40 && b <= 0x4f) {
+        d.rex = b;
+        b = jingle_dis_byte(&d);
+    }
+
+    const Jingle_Opcode *table = JINGLE_MAP_1;
+    if ((b == 0xc4 || b == 0xc5) && d.rex == 0) {
+        d.vex = true;
+        unsigned b1 = jingle_dis_byte(&d);
+        unsigned b2 = b == 0xc4 ? jingle_dis_byte(&d) : b1;
+        d.rex = 0x40 | (b1 & 0x80 ? 0 : 4);
+        if (b == 0xc4) {
+            d.rex |= (b1 & 0x40 ? 0 : 2) | (b1 & 0x20 ? 0 : 1) | (b2 & 0x80 ? 8 : 0);
+            d.map = b1 & 0x1f;
+        } else {
+            d.map = 1;
+        }
+        d.vex_v = (~b2 >> 3) & 15;
+        d.vex_l = (b2 >> 2) & 1;
+        d.vex_pp = b2 & 3;
+        if (d.map < 1 || d.map > 3 || d.opsize || d.rep) return jingle_dis_bad(insn);
+        b = jingle_dis_byte(&d);
+    } else if (b == 0x62 && d.rex == 0) {
+        // EVEX: only the length is worked out
+        unsigned p0 = jingle_dis_byte(&d);
+        jingle_dis_byte(&d);
+        jingle_dis_byte(&d);
+        jingle_dis_byte(&d);
+        jingle_dis_modrm(&d);
+        if ((p0 & 3) == 3) jingle_dis_byte(&d);
+        if (d.overrun) return jingle_dis_bad(insn);
+        insn->length = d.at;
+        snprintf(insn->text, sizeof(insn->text), "(evex)");
+        return;
+    } else if (b == 0x0f) {
+        d.map = 1;
+        b = jingle_dis_byte(&d);
+        if (b == 0x38) {
+            d.map = 2;
+            b = jingle_dis_byte(&d);
+        } else if (b == 0x3a) {
+            d.map = 3;
+            b = jingle_dis_byte(&d);
+        }
+    }
+    d.opcode = b;
+    if (d.overrun) return jingle_dis_bad(insn);
+
+    switch (d.map) {
+    case 1: table = JINGLE_MAP_0F; break;
+    case 2: table = JINGLE_MAP_0F38; break;
+    case 3: table = JINGLE_MAP_0F3A; break;
+    }
+
+    Jingle_Opcode op = table[b];
+    const char *group_operands = NULL;
+
+    // Opcodes that don't fit the tables
+    if (d.map == 0 && b >= 0xd8 && b <= 0xdf) {
+        jingle_dis_modrm(&d);
+        op = d.mod == 3 ? JINGLE_X87_REG[b - 0xd8][d.reg & 7] : JINGLE_X87_MEM[b - 0xd8][d.reg & 7];
+        if (op.mnemonic && strcmp(op.mnemonic, "#") == 0) {
+            op = (Jingle_Opcode)JINGLE_BAD;
+            for (size_t i = 0; i < sizeof(JINGLE_X87_SPECIAL)/sizeof(JINGLE_X87_SPECIAL[0]); ++i) {
+                if (JINGLE_X87_SPECIAL[i].opcode == b && JINGLE_X87_SPECIAL[i].modrm == d.modrm) {
+                    op = (Jingle_Opcode){ JINGLE_X87_SPECIAL[i].mnemonic, JINGLE_X87_SPECIAL[i].operands };
+                }
+            }
+        }
+    } else if (d.map == 0 && b == 0x9b && d.at == 1 && d.at < d.n && (d.p[d.at] | 6) == 0xdf) {
+        // fwait in front of a no-wait x87 control instruction is its waiting form: fstsw for fnstsw
+        Jingle_Insn next;
+        jingle_disasm(d.p + d.at, d.n - d.at, address + d.at, &next);
+        if (strncmp(next.text, "fn", 2) == 0) {
+            snprintf(insn->text, sizeof(insn->text), "f%.*s", (int)sizeof(insn->text) - 2, next.text + 2);
+            insn->length = d.at + next.length;
+            return;
+        }
+    } else if (d.map == 0 && b == 0x90) {
+        if (d.rep == 0xf3) {
+            d.rep = 0;
+            op = (Jingle_Opcode){ "pause", "" };
+        } else if ((d.rex & 1) || d.opsize) {
+            op = (Jingle_Opcode){ "xchg", "Zv,Av" };
+        }
+    } else if (d.map == 1 && (b == 0x12 || b == 0x16) && (d.vex ? d.vex_pp == 0 : !d.opsize && !d.rep) && d.at < d.n && d.p[d.at] >= 0xc0) {
+        // The register forms of movlps and movhps
+        op = (Jingle_Opcode){ b == 0x12 ? "movhlps" : "movlhps", "Vo,Hx,Uo" };
+    } else if (d.map == 0 && b == 0xe3 && d.adsize) {
+        op = (Jingle_Opcode){ "jecxz", "Jb" };
+    } else if (d.map == 1 && b == 0x1e && d.rep == 0xf3 && d.at < d.n && (d.p[d.at] == 0xfa || d.p[d.at] == 0xfb)) {
+        op = (Jingle_Opcode){ d.p[d.at] == 0xfa ? "endbr64" : "endbr32", "" };
+        d.rep = 0;
+        jingle_dis_byte(&d);
+    } else if (d.map == 1 && b == 0x77 && d.vex) {
+        op = (Jingle_Opcode){ d.vex_l ? "vzeroall" : "vzeroupper", "", JINGLE_DIS_VEX };
+    } else if (d.map == 1 && b == 0x01) {
+        jingle_dis_modrm(&d);
+        if (d.mod == 3 && (d.reg & 7) != 4 && (d.reg & 7) != 6) {
+            op = (Jingle_Opcode)JINGLE_BAD;
+            for (size_t i = 0; i < sizeof(JINGLE_0F01_REG)/sizeof(JINGLE_0F01_REG[0]); ++i) {
+                if (JINGLE_0F01_REG[i].modrm == d.modrm) op = (Jingle_Opcode){ JINGLE_0F01_REG[i].mnemonic, "" };
+            }
+        }
+    }
+
+    if (op.mnemonic == NULL) {
+        if (d.map < 2) return jingle_dis_bad(insn);
+        // Unknown three byte opcodes still have a ModRM (and an imm8 in 0F 3A), so their length is known
+        jingle_dis_modrm(&d);
+        if (d.map == 3) jingle_dis_byte(&d);
+        if (d.overrun) return jingle_dis_bad(insn);
+        insn->length = d.at;
+        snprintf(insn->text, sizeof(insn->text), "(unknown)");
+        return;
+    }
+
+    if (op.mnemonic[0] == '#' && op.mnemonic[1] != '\0') {
+        const Jingle_Group *g = &JINGLE_GROUPS[atoi(op.mnemonic + 1)];
+        jingle_dis_modrm(&d);
+        const Jingle_Opcode *e = d.mod == 3 && g->reg[d.reg & 7].mnemonic ? &g->reg[d.reg & 7] : &g->mem[d.reg & 7];
+        group_operands = op.operands;
+        op = (Jingle_Opcode){ e->mnemonic, e->operands ? e->operands : group_operands, op.flags | e->flags };
+        if (op.mnemonic == NULL) return jingle_dis_bad(insn);
+    }
+
+    if ((op.flags & JINGLE_DIS_VEX) && !d.vex) return jingle_dis_bad(insn);
+
+    // Mandatory prefix variants
+    char mnemonic[64];
+    char operands[64];
+    unsigned variant = 0;
+    if (strchr(op.mnemonic, '|')) {
+        unsigned want = d.vex ? d.vex_pp : d.rep == 0xf3 ? 2 : d.rep == 0xf2 ? 3 : d.opsize ? 1 : 0;
+        if (want != 0 && jingle_dis_part(op.mnemonic, want, mnemonic, sizeof(mnemonic))) {
+            variant = want;
+            if (want == 1 && d.opsize) d.opsize--;
+            if (want >= 2) d.rep = 0;
+        } else if ((want != 0 && d.vex) || !jingle_dis_part(op.mnemonic, 0, mnemonic, sizeof(mnemonic))) {
+            return jingle_dis_bad(insn);
+        }
+    } else {
+        snprintf(mnemonic, sizeof(mnemonic), "%s", op.mnemonic);
+    }
+    if (strchr(op.operands, '|')) {
+        if (!jingle_dis_part(op.operands, variant, operands, sizeof(operands))) operands[0] = '\0';
+    } else {
+        snprintf(operands, sizeof(operands), "%s", op.operands);
+    }
+    // MMX forms have no VEX encoding, and VEX opcodes outside the tables still get their length worked out
+    if (d.vex && (strchr(operands, 'P') || strchr(operands, 'Q') || strchr(operands, 'N'))) return jingle_dis_bad(insn);
+    bool has_xmm = jingle_dis_has_xmm(operands) || (op.flags & JINGLE_DIS_V);
+    bool unknown = d.vex && !has_xmm && !(op.flags & JINGLE_DIS_VEX);
+
+    d.osize = d.rex & 8 ? 64 : d.opsize ? 16 : (op.flags & JINGLE_DIS_D64) ? 64 : 32;
+
+    // Everything after the opcode: ModRM and friends, then the immediates in order
+    if (jingle_dis_needs_modrm(operands)) jingle_dis_modrm(&d);
+    if (d.vex && d.map == 1 && (b == 0x10 || b == 0x11) && variant >= 2) {
+        // vmovss and vmovsd merge into the destination from a register, but not from memory
+        if (d.mod == 3) snprintf(operands, sizeof(operands), "%s", b == 0x10 ? "Vo,Hx,Uo" : "Uo,Hx,Vo");
+        else snprintf(operands, sizeof(operands), "%s", b == 0x10 ? (variant == 2 ? "Vo,Md" : "Vo,Mq") : (variant == 2 ? "Md,Vo" : "Mq,Vo"));
+    }
+    for (const char *t = operands; *t;) {
+        unsigned size = jingle_dis_imm_size(&d, t);
+        if (size > 0 && d.imm_count < 2) {
+            d.imm_size[d.imm_count] = size;
+            d.imm[d.imm_count++] = jingle_dis_le(&d, size);
+        }
+        const char *comma = strchr(t, ',');
+        t = comma ? comma + 1 : t + strlen(t);
+    }
+    if (d.overrun) return jingle_dis_bad(insn);
+    // Memory-only operands can't take a register ModRM
+    for (const char *t = operands; d.mod == 3 && *t; ++t) {
+        if (*t == 'M' && (t == operands || t[-1] == ',')) return jingle_dis_bad(insn);
+    }
+
+    // Size dependent mnemonics
+    char *slash = strchr(mnemonic, '/');
+    if (slash) {
+        char parts[3][16] = {{0}};
+        sscanf(mnemonic, "%15[^/]/%15[^/]/%15s", parts[0], parts[1], parts[2]);
+        snprintf(mnemonic, sizeof(mnemonic), "%s", parts[d.osize == 16 ? 0 : d.osize == 32 ? 1 : 2]);
+    }
+    char *star = strchr(mnemonic, '*');
+    if (star) *star = d.osize == 16 ? 'w' : d.osize == 32 ? 'd' : 'q';
+    if ((d.rex & 8) && strstr(operands, "y")) {
+        if (strcmp(mnemonic, "movd") == 0) strcpy(mnemonic, "movq");
+        else if (strcmp(mnemonic, "pextrd") == 0) strcpy(mnemonic, "pextrq");
+        else if (strcmp(mnemonic, "pinsrd") == 0) strcpy(mnemonic, "pinsrq");
+    }
+    if (unknown) {
+        insn->length = d.at;
+        snprintf(insn->text, sizeof(insn->text), "(unknown)");
+        return;
+    }
+    if (d.map == 1 && b == 0xc2 && d.imm[0] < (d.vex ? 32u : 8u)) {
+        // cmpps and friends read better with the predicate in the name
+        // Only the ps/pd/ss/sd suffix is left after "cmp", so rest never truncates
+        char rest[8];
+        snprintf(rest, sizeof(rest), "%.*s", (int)sizeof(rest) - 1, mnemonic + 3);
+        snprintf(mnemonic, sizeof(mnemonic), "cmp%s%s", JINGLE_CMP_PREDICATES[d.imm[0]], rest);
+        *strrchr(operands, ',') = '\0';
+    }
+    if (strcmp(mnemonic, "mov") == 0 && d.map == 0 && b >= 0xb8 && b <= 0xbf && d.osize == 64) strcpy(mnemonic, "movabs");
+
+    // Prefixes that show up as words in front of the mnemonic
+    size_t len = 0;
+    char *text = insn->text;
+    size_t cap = sizeof(insn->text);
+    bool string_op = d.map == 0 && ((b >= 0xa4 && b <= 0xa7) || (b >= 0xaa && b <= 0xaf) || (b >= 0x6c && b <= 0x6f));
+    bool compare_op = d.map == 0 && (b == 0xa6 || b == 0xa7 || b == 0xae || b == 0xaf);
+    bool branch = (d.map == 0 && (b == 0xc3 || b == 0xc2 || b == 0xe8 || b == 0xe9 || b == 0xeb || (b >= 0x70 && b <= 0x7f) || (b == 0xff && ((d.reg & 7) == 2 || (d.reg & 7) == 4)))) || (d.map == 1 && b >= 0x80 && b <= 0x8f);
+
+    for (unsigned i = 1; i < d.opsize; ++i) len += snprintf(text + len, cap - len, "data16 ");
+    if (d.opsize > 0 && operands[0] == '\0') len += snprintf(text + len, cap - len, "data16 ");
+    if (d.segment >= 0 && d.segment < 4) {
+        bool notrack = d.segment == 3 && d.map == 0 && b == 0xff && ((d.reg & 7) == 2 || (d.reg & 7) == 4);
+        len += snprintf(text + len, cap - len, "%s ", notrack ? "notrack" : JINGLE_SEGMENTS[d.segment]);
+    }
+    if (d.lock) len += snprintf(text + len, cap - len, "lock ");
+    if (d.rep == 0xf3) len += snprintf(text + len, cap - len, "%s ", string_op && !compare_op ? "rep" : "repz");
+    if (d.rep == 0xf2) len += snprintf(text + len, cap - len, "%s ", branch ? "bnd" : "repnz");
+
+    char head[80];
+    snprintf(head, sizeof(head), "%s%s", d.vex && has_xmm ? "v" : "", mnemonic);
+    if (operands[0] == '\0') {
+        len += snprintf(text + len, cap - len, "%s", head);
+    } else {
+        len += snprintf(text + len, cap - len, "%-6s ", head);
+    }
+
+    // The operands; the immediates were read above, so d.at is the length and J targets can be worked out
+    unsigned imm = 0;
+    int first_bits = 0;
+    bool first = true;
+    for (const char *t = operands; *t;) {
+        const char *comma = strchr(t, ',');
+        size_t tlen = comma ? (size_t)(comma - t) : strlen(t);
+        char buf[64];
+        if (jingle_dis_operand(&d, t, tlen, first_bits, &imm, insn, buf, sizeof(buf))) {
+            len += snprintf(text + len, cap - len, "%s%s", first ? "" : ",", buf);
+            if (first && t[0] >= 'A' && t[0] <= 'Z' && tlen > 1) first_bits = jingle_dis_bits(&d, t[1]);
+            first = false;
+        }
+        t = comma ? comma + 1 : t + tlen;
+    }
+    if (len >= cap) len = cap - 1;
+
+    if (d.has_modrm && d.mod != 3 && d.rip && !insn->has_target) {
+        insn->has_target = true;
+        insn->target_is_rip = true;
+        insn->target = address + d.at + d.disp;
+    }
+    insn->length = d.at;
+}
+
+#endif // JINGLE_DISASM_C_
@@ -0,0 +1,287 @@
+/// The class-specific half of the reader, compiled once per ELF class.
+///
+/// jingle_read.c includes this file twice, with JINGLE_CLASS set to 32 and then 64. ElfN(Shdr) and friends expand to
+/// that class's types, ELFN(R_SYM) to its macros, and JN(name) appends _32 or _64 to every function, so each class gets
+/// its own copy of the per-entry loops below with the entry sizes baked in. jingle_verify looks at EI_CLASS once and
+/// calls the matching copy; nothing after that branches on the class.
+///
+/// Besides checking the structure of the file, each copy builds the Elf64 views the rest of the reader works on
+/// (jf->ehdr, jf->shdrs, jf->tables). For 64 bit files in host byte order they point straight into the file. For
+/// 32 bit files the headers, symbols and relocations are widened into Elf64 arrays once, so the readers, the display
+/// code and the search modes are shared between both classes. sh_entsize keeps its on-disk value, so
+/// sh_size / sh_entsize is still the entry count.
+///
+/// Files in the other byte order have their headers and tables swapped in bulk (see jingle_swap.c) as soon as each
+/// one is known to be inside the file, and everything from the checks onwards reads the swapped copies. Every mode
+/// walks whole tables, so swapping each table once beats swapping fields on every access.
+
+#ifndef JINGLE_CLASS
+#error "Define JINGLE_CLASS as 32 or 64 before including jingle_elfclass.c"
+#endif
+
+#define JINGLE_PASTE_(a, b, c) a##b##c
+#define JINGLE_PASTE(a, b, c)  JINGLE_PASTE_(a, b, c)
+#define ElfN(type)  JINGLE_PASTE(Elf, JINGLE_CLASS, _##type)
+#define ELFN(macro) JINGLE_PASTE(ELF, JINGLE_CLASS, _##macro)
+#define JN(name)    JINGLE_PASTE(name, _, JINGLE_CLASS)
+
+/// The class's own structures in host byte order: pointers into the file, or swapped heap copies
+typedef struct {
+    ElfN(Ehdr) ehdr;
+    ElfN(Shdr) *shdrs;
+    void **tables; // per section, for SYMTAB, DYNSYM, REL and RELA sections
+    bool swapped;
+} JN(Jingle_Native);
+
+static void
+JN(jingle_native_free)(JN(Jingle_Native) *n)
+{
+    if (n->swapped) {
+        for (size_t i = 0; n->tables != NULL && i < n->ehdr.e_shnum; ++i) free(n->tables[i]);
+        free(n->shdrs);
+    }
+    free(n->tables);
+    *n = (JN(Jingle_Native)){0};
+}
+
+static void *
+JN(jingle_native_table)(Jingle_File *jf, bool swap, uint64_t offset, size_t count, size_t entsize, const unsigned char *layout)
+{
+    char *at = jf->file.data + offset;
+    if (!swap) return at;
+
+    void *copy = jingle_xcalloc(count, entsize);
+    jingle_swap_table(copy, at, count, layout);
+    return copy;
+}
+
+static bool
+JN(jingle_verify_class)(Jingle_File *jf, JN(Jingle_Native) *n)
+{
+    string_t file = jf->file;
+    if (file.count < sizeof(ElfN(Ehdr))) return jingle_verify_fail(jf, "truncated ELF header");
+
+    bool swap = (unsigned char)file.data[EI_DATA] != JINGLE_HOST_DATA;
+    n->swapped = swap;
+    if (swap) {
+        jingle_swap_table(&n->ehdr, file.data, 1, JN(JINGLE_LAYOUT_EHDR));
+    } else {
+        memcpy(&n->ehdr, file.data, sizeof(n->ehdr));
+    }
+    ElfN(Ehdr) *eh = &n->ehdr;
+
+    if (eh->e_phnum > 0) {
+        if (eh->e_phentsize != sizeof(ElfN(Phdr))) return jingle_verify_fail(jf, "unexpected program header size %u", eh->e_phentsize);
+        if (!jingle_range_ok(file, eh->e_phoff, (uint64_t)eh->e_phnum * eh->e_phentsize)) return jingle_verify_fail(jf, "program headers extend past the end of the file");
+    }
+
+    if (eh->e_shnum == 0) {
+        if (eh->e_shoff != 0) return jingle_verify_fail(jf, "extended section numbering is not supported");
+        return true;
+    }
+
+    if (eh->e_shentsize != sizeof(ElfN(Shdr))) return jingle_verify_fail(jf, "unexpected section header size %u", eh->e_shentsize);
+    if (!jingle_range_ok(file, eh->e_shoff, (uint64_t)eh->e_shnum * eh->e_shentsize)) return jingle_verify_fail(jf, "section headers extend past the end of the file");
+    if (eh->e_shstrndx == SHN_UNDEF || eh->e_shstrndx >= eh->e_shnum) return jingle_verify_fail(jf, "bad section name table index %u", eh->e_shstrndx);
+
+    ElfN(Shdr) *shdrs = n->shdrs = JN(jingle_native_table)(jf, swap, eh->e_shoff, eh->e_shnum, sizeof(ElfN(Shdr)), JN(JINGLE_LAYOUT_SHDR));
+    n->tables = jingle_xcalloc(eh->e_shnum, sizeof(void *));
+
+    // Every section, and the tables that point at other sections
+    for (size_t i = 0; i < eh->e_shnum; ++i) {
+        ElfN(Shdr) *sh = &shdrs[i];
+        if (sh->sh_type == SHT_NULL || sh->sh_type == SHT_NOBITS) continue;
+
+        if (!jingle_range_ok(file, sh->sh_offset, sh->sh_size)) return jingle_verify_fail(jf, "section %zu extends past the end of the file", i);
+        if ((sh->sh_flags & SHF_COMPRESSED) && sh->sh_size < sizeof(ElfN(Chdr))) return jingle_verify_fail(jf, "compressed section %zu is too small", i);
+
+        switch (sh->sh_type) {
+        case SHT_STRTAB:
+            if (sh->sh_size > 0 && file.data[sh->sh_offset + sh->sh_size - 1] != '\0') return jingle_verify_fail(jf, "string table %zu is not NUL terminated", i);
+            break;
+
+        case SHT_SYMTAB:
+        case SHT_DYNSYM:
+            if (!jingle_verify_table(jf, i, sh->sh_entsize, sh->sh_size, sizeof(ElfN(Sym)))) return false;
+            if (sh->sh_link >= eh->e_shnum) return jingle_verify_fail(jf, "symbol table %zu links to section %u", i, sh->sh_link);
+            if (shdrs[sh->sh_link].sh_type != SHT_STRTAB) return jingle_verify_fail(jf, "symbol table %zu doesn't link to a string table", i);
+            n->tables[i] = JN(jingle_native_table)(jf, swap, sh->sh_offset, sh->sh_size / sh->sh_entsize, sh->sh_entsize, JN(JINGLE_LAYOUT_SYM));
+            break;
+
+        case SHT_RELA:
+        case SHT_REL: {
+            if (!jingle_verify_table(jf, i, sh->sh_entsize, sh->sh_size, sh->sh_type == SHT_RELA ? sizeof(ElfN(Rela)) : sizeof(ElfN(Rel)))) return false;
+            if (sh->sh_link >= eh->e_shnum) return jingle_verify_fail(jf, "relocation section %zu links to section %u", i, sh->sh_link);
+            ElfN(Shdr) *symtab = &shdrs[sh->sh_link];
+            if (sh->sh_link != SHN_UNDEF && symtab->sh_type != SHT_SYMTAB && symtab->sh_type != SHT_DYNSYM) return jingle_verify_fail(jf, "relocation section %zu doesn't link to a symbol table", i);
+            const unsigned char *layout = sh->sh_type == SHT_RELA ? JN(JINGLE_LAYOUT_RELA) : JN(JINGLE_LAYOUT_REL);
+            n->tables[i] = JN(jingle_native_table)(jf, swap, sh->sh_offset, sh->sh_size / sh->sh_entsize, sh->sh_entsize, layout);
+        } break;
+        }
+    }
+
+    ElfN(Shdr) *shstrtab = &shdrs[eh->e_shstrndx];
+    if (shstrtab->sh_type != SHT_STRTAB || shstrtab->sh_size == 0) return jingle_verify_fail(jf, "section %u is not a string table", eh->e_shstrndx);
+
+    // The entries: names, section indices and symbol indices
+    for (size_t i = 0; i < eh->e_shnum; ++i) {
+        ElfN(Shdr) *sh = &shdrs[i];
+        if (sh->sh_name >= shstrtab->sh_size) return jingle_verify_fail(jf, "section %zu has a name outside of the name table", i);
+
+        if (sh->sh_type == SHT_SYMTAB || sh->sh_type == SHT_DYNSYM) {
+            ElfN(Sym) *syms = n->tables[i];
+            size_t count = sh->sh_size / sizeof(ElfN(Sym));
+            ElfN(Shdr) *strtab = &shdrs[sh->sh_link];
+
+            for (size_t j = 0; j < count; ++j) {
+                ElfN(Sym) *sym = &syms[j];
+                if (sym->st_name >= strtab->sh_size && sym->st_name != 0) return jingle_verify_fail(jf, "symbol %zu of section %zu has a name outside of its string table", j, i);
+                bool reserved = sym->st_shndx >= SHN_LORESERVE;
+                if (!reserved && sym->st_shndx >= eh->e_shnum) return jingle_verify_fail(jf, "symbol %zu of section %zu is in section %u, which doesn't exist", j, i, sym->st_shndx);
+                if (reserved && ELFN(ST_TYPE)(sym->st_info) == STT_SECTION) return jingle_verify_fail(jf, "section symbol %zu of section %zu has no section", j, i);
+            }
+        } else if (sh->sh_type == SHT_RELA || sh->sh_type == SHT_REL) {
+            size_t syms = sh->sh_link == SHN_UNDEF ? 0 : shdrs[sh->sh_link].sh_size / sizeof(ElfN(Sym));
+            size_t entsize = sh->sh_entsize;
+            size_t count = sh->sh_size / entsize;
+
+            for (size_t j = 0; j < count; ++j) {
+                // r_info sits at the same offset in Rel and Rela
+                ElfN(Rel) *rel = (ElfN(Rel) *)((char *)n->tables[i] + j * entsize);
+                size_t sym = ELFN(R_SYM)(rel->r_info);
+                if (sym != 0 && sym >= syms) return jingle_verify_fail(jf, "relocation %zu of section %zu refers to symbol %zu, which doesn't exist", j, i, sym);
+            }
+        }
+    }
+
+    return true;
+}
+
+/// Builds jf->ehdr, jf->shdrs and jf->tables from what JN(jingle_verify_class) left in n, taking over or freeing
+/// its tables.
+static void
+JN(jingle_build_views)(Jingle_File *jf, JN(Jingle_Native) *n)
+{
+    ElfN(Ehdr) *eh = &n->ehdr;
+
+#if JINGLE_CLASS == 64
+    // Already the right shape: hand the tables over as they are
+    if (n->swapped) {
+        jf->ehdr = jingle_xcalloc(1, sizeof(Elf64_Ehdr));
+        *jf->ehdr = *eh;
+    } else {
+        jf->ehdr = (Elf64_Ehdr *)jf->file.data;
+    }
+    jf->shdrs = n->shdrs;
+    jf->tables = n->tables;
+    jf->owns_views = n->swapped;
+    *n = (JN(Jingle_Native)){0};
+#else
+    jf->owns_views = true;
+    jf->ehdr = jingle_xcalloc(1, sizeof(Elf64_Ehdr));
+    memcpy(jf->ehdr->e_ident, eh->e_ident, EI_NIDENT);
+    jf->ehdr->e_type = eh->e_type;
+    jf->ehdr->e_machine = eh->e_machine;
+    jf->ehdr->e_version = eh->e_version;
+    jf->ehdr->e_entry = eh->e_entry;
+    jf->ehdr->e_phoff = eh->e_phoff;
+    jf->ehdr->e_shoff = eh->e_shoff;
+    jf->ehdr->e_flags = eh->e_flags;
+    jf->ehdr->e_ehsize = eh->e_ehsize;
+    jf->ehdr->e_phentsize = eh->e_phentsize;
+    jf->ehdr->e_phnum = eh->e_phnum;
+    jf->ehdr->e_shentsize = eh->e_shentsize;
+    jf->ehdr->e_shnum = eh->e_shnum;
+    jf->ehdr->e_shstrndx = eh->e_shstrndx;
+
+    size_t shnum = eh->e_shnum;
+    if (shnum == 0) return;
+    ElfN(Shdr) *shdrs = n->shdrs;
+    jf->shdrs = jingle_xcalloc(shnum, sizeof(Elf64_Shdr));
+    jf->tables = jingle_xcalloc(shnum, sizeof(void *));
+
+    for (size_t i = 0; i < shnum; ++i) {
+        ElfN(Shdr) *sh = &shdrs[i];
+        jf->shdrs[i] = (Elf64_Shdr){
+            .sh_name = sh->sh_name,
+            .sh_type = sh->sh_type,
+            .sh_flags = sh->sh_flags,
+            .sh_addr = sh->sh_addr,
+            .sh_offset = sh->sh_offset,
+            .sh_size = sh->sh_size,
+            .sh_link = sh->sh_link,
+            .sh_info = sh->sh_info,
+            .sh_addralign = sh->sh_addralign,
+            .sh_entsize = sh->sh_entsize,
+        };
+        if (n->tables[i] == NULL) continue;
+
+        size_t count = sh->sh_size / sh->sh_entsize;
+        switch (sh->sh_type) {
+        case SHT_SYMTAB:
+        case SHT_DYNSYM: {
+            ElfN(Sym) *in = n->tables[i];
+            Elf64_Sym *out = jingle_xcalloc(count, sizeof(*out));
+            for (size_t j = 0; j < count; ++j) {
+                out[j] = (Elf64_Sym){
+                    .st_name = in[j].st_name,
+                    .st_info = in[j].st_info,
+                    .st_other = in[j].st_other,
+                    .st_shndx = in[j].st_shndx,
+                    .st_value = in[j].st_value,
+                    .st_size = in[j].st_size,
+                };
+            }
+            jf->tables[i] = out;
+        } break;
+
+        case SHT_RELA: {
+            ElfN(Rela) *in = n->tables[i];
+            Elf64_Rela *out = jingle_xcalloc(count, sizeof(*out));
+            for (size_t j = 0; j < count; ++j) {
+                out[j] = (Elf64_Rela){
+                    .r_offset = in[j].r_offset,
+                    .r_info = ELF64_R_INFO(ELFN(R_SYM)(in[j].r_info), ELFN(R_TYPE)(in[j].r_info)),
+                    .r_addend = in[j].r_addend,
+                };
+            }
+            jf->tables[i] = out;
+        } break;
+
+        case SHT_REL: {
+            ElfN(Rel) *in = n->tables[i];
+            Elf64_Rel *out = jingle_xcalloc(count, sizeof(*out));
+            for (size_t j = 0; j < count; ++j) {
+                out[j] = (Elf64_Rel){
+                    .r_offset = in[j].r_offset,
+                    .r_info = ELF64_R_INFO(ELFN(R_SYM)(in[j].r_info), ELFN(R_TYPE)(in[j].r_info)),
+                };
+            }
+            jf->tables[i] = out;
+        } break;
+        }
+    }
+
+    JN(jingle_native_free)(n);
+#endif
+}
+
+/// Reads the compression header at the start of a SHF_COMPRESSED section and returns its size.
+static size_t
+JN(jingle_read_chdr)(const char *data, bool swap, Elf64_Chdr *chdr)
+{
+    ElfN(Chdr) in;
+    if (swap) {
+        jingle_swap_table(&in, data, 1, JN(JINGLE_LAYOUT_CHDR));
+    } else {
+        memcpy(&in, data, sizeof(in));
+    }
+    *chdr = (Elf64_Chdr){ .ch_type = in.ch_type, .ch_size = in.ch_size, .ch_addralign = in.ch_addralign };
+    return sizeof(in);
+}
+
+#undef JINGLE_PASTE_
+#undef JINGLE_PASTE
+#undef ElfN
+#undef ELFN
+#undef JN
@@ -0,0 +1,279 @@
+#ifndef JINGLE_HASH_C_
+#define JINGLE_HASH_C_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "stb_ds.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// A fast 128-bit content hash for section and function bodies.
+///
+/// The structure follows XXH3: eight 64-bit accumulators eat the input in 64-byte stripes, each lane adding the
+/// 32x32->64 product of the two halves of (input ^ key) to itself and the raw value to its neighbour, and the
+/// accumulators get scrambled after every 1 KiB block. The lane math maps directly onto _mm_mul_epu32, so the SSE2
+/// path does two lanes per instruction. It is not XXH3 bit for bit, and it is only meant for finding identical
+/// content, not for anything adversarial.
+
+typedef struct {
+    uint64_t lo, hi;
+} Jingle_Hash;
+
+#define JINGLE_HASH_STRIPE 64
+#define JINGLE_HASH_BLOCK  (16 * JINGLE_HASH_STRIPE)
+
+#define JINGLE_PRIME32_1 0x9E3779B1U
+#define JINGLE_PRIME64_1 0x9E3779B185EBCA87ULL
+#define JINGLE_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define JINGLE_PRIME64_3 0x165667B19E3779F9ULL
+
+// Stripe keys, one per block position; a stripe at position s within a block uses keys [s, s+8)
+static const uint64_t JINGLE_HASH_KEYS[16 + 8] = {
+    0xbe4ba423396cfeb8, 0x1cad21f72c81017c, 0xdb979083e96dd4de, 0x1f67b3b7a4a44072,
+    0x78e5c0cc4ee679cb, 0x2172ffcc7dd05a82, 0x8e2443f7744608b8, 0x4c263a81e69035e0,
+    0xcb00c391bb52283c, 0xa32e531b8b65d088, 0x4ef90da297486471, 0xd8acdea946ef1938,
+    0x3f349ce33f76faa8, 0x1d4f0bc7c7bbdcf9, 0x3159b4cd4be0518a, 0x647378d9c97e9fc8,
+    0xc3ebd33483acc5ea, 0xeb6313faffa081c5, 0x49daf0b751dd0d17, 0x9e68d429265516d3,
+    0xfca1477d58be162b, 0xce31d07ad1b8f88f, 0x280416958f3acb45, 0x7e404bbbcafbd7af,
+};
+
+static inline uint64_t
+jingle_read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void
+jingle_hash_stripe_scalar(uint64_t acc[8], const unsigned char *p, const uint64_t *key)
+{
+    for (size_t i = 0; i < 8; ++i) {
+        uint64_t data = jingle_read64(p + 8*i);
+        uint64_t v = data ^ key[i];
+        acc[i ^ 1] += data;
+        acc[i] += (v & 0xFFFFFFFF) * (v >> 32);
+    }
+}
+
+#ifdef __SSE2__
+static inline void
+jingle_hash_stripe_sse2(__m128i acc[4], const unsigned char *p, const uint64_t *key)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        __m128i data = _mm_loadu_si128((const __m128i *)(p + 16*i));
+        __m128i k = _mm_loadu_si128((const __m128i *)(key + 2*i));
+        __m128i v = _mm_xor_si128(data, k);
+        __m128i product = _mm_mul_epu32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+    }
+}
+#endif
+
+static inline void
+jingle_hash_scramble(uint64_t acc[8])
+{
+    for (size_t i = 0; i < 8; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= JINGLE_HASH_KEYS[i + 3];
+        acc[i] = a * JINGLE_PRIME32_1;
+    }
+}
+
+static inline uint64_t
+jingle_hash_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t
+jingle_hash_mix(uint64_t a, uint64_t b)
+{
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+/// Runs the accumulate loop over whole stripes and returns how many bytes were consumed.
+static size_t
+jingle_hash_stripes(uint64_t acc[8], const unsigned char *p, size_t n)
+{
+    size_t done = 0;
+
+#ifdef __SSE2__
+    __m128i vacc[4];
+    memcpy(vacc, acc, sizeof(vacc));
+#endif
+
+    while (n - done >= JINGLE_HASH_STRIPE) {
+        size_t stripe = (done % JINGLE_HASH_BLOCK) / JINGLE_HASH_STRIPE;
+#ifdef __SSE2__
+        jingle_hash_stripe_sse2(vacc, p + done, &JINGLE_HASH_KEYS[stripe]);
+#else
+        jingle_hash_stripe_scalar(acc, p + done, &JINGLE_HASH_KEYS[stripe]);
+#endif
+        done += JINGLE_HASH_STRIPE;
+
+        if (done % JINGLE_HASH_BLOCK == 0) {
+#ifdef __SSE2__
+            memcpy(acc, vacc, sizeof(vacc));
+            jingle_hash_scramble(acc);
+            memcpy(vacc, acc, sizeof(vacc));
+#else
+            jingle_hash_scramble(acc);
+#endif
+        }
+    }
+
+#ifdef __SSE2__
+    memcpy(acc, vacc, sizeof(vacc));
+#endif
+    return done;
+}
+
+Jingle_Hash
+jingle_hash128(const void *data, size_t n, uint64_t seed)
+{
+    const unsigned char *p = data;
+    uint64_t acc[8] = {
+        JINGLE_PRIME32_1, JINGLE_PRIME64_1 ^ seed, JINGLE_PRIME64_2, JINGLE_PRIME64_3 + seed,
+        JINGLE_PRIME64_1, JINGLE_PRIME64_2 ^ seed, JINGLE_PRIME64_3, JINGLE_PRIME32_1 + seed,
+    };
+
+    size_t done = jingle_hash_stripes(acc, p, n);
+
+    // The last partial stripe is zero padded; the length folded in below keeps "ab" and "ab\0" apart
+    if (done < n) {
+        unsigned char tail[JINGLE_HASH_STRIPE] = {0};
+        memcpy(tail, p + done, n - done);
+        size_t stripe = (done % JINGLE_HASH_BLOCK) / JINGLE_HASH_STRIPE;
+        jingle_hash_stripe_scalar(acc, tail, &JINGLE_HASH_KEYS[stripe]);
+    }
+
+    uint64_t lo = n * JINGLE_PRIME64_1;
+    uint64_t hi = ~n * JINGLE_PRIME64_2;
+    for (size_t i = 0; i < 8; i += 2) {
+        lo += jingle_hash_mix(acc[i] ^ JINGLE_HASH_KEYS[i + 11], acc[i+1] ^ JINGLE_HASH_KEYS[i + 12]);
+        hi += jingle_hash_mix(acc[i] ^ JINGLE_HASH_KEYS[i + 4], acc[i+1] ^ JINGLE_HASH_KEYS[i + 5]);
+    }
+
+    return (Jingle_Hash){ .lo = jingle_hash_avalanche(lo), .hi = jingle_hash_avalanche(hi ^ (lo >> 29)) };
+}
+
+/// Groups of identical content, collected from many threads at once.
+///
+/// The table is split into shards by the low bits of the hash, each with its own lock and stb_ds hash map, so
+/// workers adding different content almost never wait on each other.
+
+#define JINGLE_DUP_SHARDS 64
+
+typedef struct {
+    char *name; // owned
+    char *path; // borrowed
+} Jingle_Dup_Member;
+
+typedef struct {
+    Jingle_Hash key;
+    uint64_t size;
+    Jingle_Dup_Member *members; // stb_ds array
+} Jingle_Dup_Group;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Jingle_Dup_Group *groups; // stb_ds hash map
+} Jingle_Dup_Shard;
+
+typedef struct {
+    Jingle_Dup_Shard shards[JINGLE_DUP_SHARDS];
+} Jingle_Dup_Table;
+
+void
+jingle_dup_init(Jingle_Dup_Table *t)
+{
+    for (size_t i = 0; i < JINGLE_DUP_SHARDS; ++i) {
+        pthread_mutex_init(&t->shards[i].lock, NULL);
+        t->shards[i].groups = NULL;
+    }
+}
+
+void
+jingle_dup_add(Jingle_Dup_Table *t, Jingle_Hash h, uint64_t size, const char *name, char *path)
+{
+    Jingle_Dup_Shard *shard = &t->shards[h.lo % JINGLE_DUP_SHARDS];
+    Jingle_Dup_Member m = { .name = strdup(name), .path = path };
+
+    pthread_mutex_lock(&shard->lock);
+    Jingle_Dup_Group *g = hmgetp_null(shard->groups, h);
+    if (g == NULL) {
+        Jingle_Dup_Group fresh = { .key = h, .size = size };
+        hmputs(shard->groups, fresh);
+        g = hmgetp_null(shard->groups, h);
+    }
+    arrput(g->members, m);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+static int
+jingle_dup_compare(const void *a, const void *b)
+{
+    const Jingle_Dup_Group *x = a, *y = b;
+    uint64_t wx = x->size * (arrlen(x->members) - 1);
+    uint64_t wy = y->size * (arrlen(y->members) - 1);
+    if (wx != wy) return wx > wy ? -1 : 1;
+    if (x->key.hi != y->key.hi) return x->key.hi < y->key.hi ? -1 : 1;
+    if (x->key.lo != y->key.lo) return x->key.lo < y->key.lo ? -1 : 1;
+    return 0;
+}
+
+static int
+jingle_dup_member_compare(const void *a, const void *b)
+{
+    const Jingle_Dup_Member *x = a, *y = b;
+    int c = strcmp(x->path, y->path);
+    return c != 0 ? c : strcmp(x->name, y->name);
+}
+
+/// Returns an stb_ds array of the groups with more than one member, most wasted bytes first, with the members of
+/// each group sorted by path and name. The groups still belong to the table.
+Jingle_Dup_Group *
+jingle_dup_collect(Jingle_Dup_Table *t)
+{
+    Jingle_Dup_Group *result = NULL;
+
+    for (size_t i = 0; i < JINGLE_DUP_SHARDS; ++i) {
+        Jingle_Dup_Group *groups = t->shards[i].groups;
+        for (size_t j = 0; j < (size_t)hmlen(groups); ++j) {
+            if (arrlen(groups[j].members) < 2) continue;
+            qsort(groups[j].members, arrlen(groups[j].members), sizeof(Jingle_Dup_Member), jingle_dup_member_compare);
+            arrput(result, groups[j]);
+        }
+    }
+
+    if (arrlen(result) > 1) qsort(result, arrlen(result), sizeof(*result), jingle_dup_compare);
+    return result;
+}
+
+void
+jingle_dup_free(Jingle_Dup_Table *t)
+{
+    for (size_t i = 0; i < JINGLE_DUP_SHARDS; ++i) {
+        Jingle_Dup_Group *groups = t->shards[i].groups;
+        for (size_t j = 0; j < (size_t)hmlen(groups); ++j) {
+            for (size_t k = 0; k < (size_t)arrlen(groups[j].members); ++k) free(groups[j].members[k].name);
+            arrfree(groups[j].members);
+        }
+        hmfree(t->shards[i].groups);
+        pthread_mutex_destroy(&t->shards[i].lock);
+    }
+}
+
+#endif // JINGLE_HASH_C_
@@ -0,0 +1,569 @@
+#ifndef JINGLE_INPUT_C_
+#define JINGLE_INPUT_C_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef JINGLE_NO_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef JINGLE_ZSTD
+#define ZSTD_STATIC_LINKING_ONLY // ZSTD_decompressBound
+#include <zstd.h>
+#endif
+
+#include "string_t.c"
+#include "stb_ds.h"
+
+/// Reading input files into memory.
+///
+/// Plain files are mapped. Files compressed with gzip or zstd (objects and archives straight out of an artifact
+/// store) are recognised by their magic bytes and decompressed while they are being read, straight into the buffer
+/// the parser works on, so nothing ever touches a temp file. The output buffer is sized from the container when it
+/// says how big the data is: the gzip trailer (ISIZE) or the zstd frame header.
+
+typedef enum {
+    JINGLE_INPUT_RAW,
+    JINGLE_INPUT_GZIP,
+    JINGLE_INPUT_ZSTD,
+} Jingle_Input_Kind;
+
+#define JINGLE_INPUT_CHUNK (256 * 1024)
+// The most a size hint may promise per byte of compressed input. Headers and trailers are not checked, so a corrupt
+// one must not make us allocate gigabytes up front; data that really inflates more just grows the buffer as it goes.
+#define JINGLE_INPUT_HINT_RATIO 8
+
+Jingle_Input_Kind
+jingle_input_kind(const unsigned char *p, size_t n)
+{
+    if (n >= 2 && p[0] == 0x1f && p[1] == 0x8b) return JINGLE_INPUT_GZIP;
+    if (n >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd) return JINGLE_INPUT_ZSTD;
+    return JINGLE_INPUT_RAW;
+}
+
+bool
+jingle_input_supported(Jingle_Input_Kind kind)
+{
+    switch (kind) {
+    case JINGLE_INPUT_RAW:  return true;
+#ifndef JINGLE_NO_ZLIB
+    case JINGLE_INPUT_GZIP: return true;
+#endif
+#ifdef JINGLE_ZSTD
+    case JINGLE_INPUT_ZSTD: return true;
+#endif
+    default:                return false;
+    }
+}
+
+static void
+jingle_input_reserve(string_t *out, size_t n)
+{
+    // One spare byte so the buffer can always be NUL terminated, like readall does
+    if (out->count + n + 1 > out->capacity) out->capacity = string_grow(out, n + 1, 64 * 1024);
+}
+
+typedef struct {
+    Jingle_Input_Kind kind;
+    bool done;
+#ifndef JINGLE_NO_ZLIB
+    z_stream z;
+#endif
+#ifdef JINGLE_ZSTD
+    ZSTD_DStream *zs;
+#endif
+} Jingle_Decoder;
+
+static bool
+jingle_decoder_init(Jingle_Decoder *d, Jingle_Input_Kind kind, const char *path)
+{
+    *d = (Jingle_Decoder){ .kind = kind };
+
+    switch (kind) {
+    case JINGLE_INPUT_RAW:
+        return true;
+    case JINGLE_INPUT_GZIP:
+#ifndef JINGLE_NO_ZLIB
+        // 16 + MAX_WBITS: expect a gzip header rather than a bare zlib stream
+        return inflateInit2(&d->z, 16 + MAX_WBITS) == Z_OK;
+#else
+        fprintf(stderr, "[ERROR] '%s' is gzip compressed, but jingle was built with JINGLE_NO_ZLIB\n", path);
+        return false;
+#endif
+    case JINGLE_INPUT_ZSTD:
+#ifdef JINGLE_ZSTD
+        d->zs = ZSTD_createDStream();
+        return d->zs != NULL;
+#else
+        fprintf(stderr, "[ERROR] '%s' is zstd compressed, but jingle was built without JINGLE_ZSTD\n", path);
+        return false;
+#endif
+    }
+    return false;
+}
+
+static void
+jingle_decoder_free(Jingle_Decoder *d)
+{
+#ifndef JINGLE_NO_ZLIB
+    if (d->kind == JINGLE_INPUT_GZIP) inflateEnd(&d->z);
+#endif
+#ifdef JINGLE_ZSTD
+    if (d->kind == JINGLE_INPUT_ZSTD) ZSTD_freeDStream(d->zs);
+#endif
+}
+
+/// Feeds one chunk of input to the decoder, appending whatever comes out to *out. Stops early once *out holds at
+/// least limit bytes. Returns false on corrupt input.
+static bool
+jingle_decoder_feed(Jingle_Decoder *d, const unsigned char *in, size_t n, string_t *out, size_t limit)
+{
+    switch (d->kind) {
+    case JINGLE_INPUT_RAW:
+        jingle_input_reserve(out, n);
+        memcpy(out->data + out->count, in, n);
+        out->count += n;
+        return true;
+
+    case JINGLE_INPUT_GZIP:
+#ifndef JINGLE_NO_ZLIB
+        d->z.next_in = (Bytef *)in;
+        d->z.avail_in = n;
+        while (out->count < limit) {
+            // A finished member followed by more input is the start of the next member (as in `cat a.gz b.gz`)
+            if (d->done) {
+                if (d->z.avail_in == 0) break;
+                if (inflateReset(&d->z) != Z_OK) return false;
+                d->done = false;
+            }
+
+            jingle_input_reserve(out, JINGLE_INPUT_CHUNK);
+            size_t room = out->capacity - out->count - 1;
+            d->z.next_out = (Bytef *)out->data + out->count;
+            d->z.avail_out = room;
+
+            int ret = inflate(&d->z, Z_NO_FLUSH);
+            out->count += room - d->z.avail_out;
+
+            if (ret == Z_STREAM_END) {
+                d->done = true;
+            } else if (ret == Z_BUF_ERROR) {
+                break; // needs more input
+            } else if (ret != Z_OK) {
+                return false;
+            }
+
+            // Everything consumed and nothing held back (zlib fills the whole output buffer when it has more)
+            if (d->z.avail_in == 0 && d->z.avail_out > 0) break;
+        }
+        return true;
+#else
+        return false;
+#endif
+
+    case JINGLE_INPUT_ZSTD:
+#ifdef JINGLE_ZSTD
+    {
+        ZSTD_inBuffer input = { .src = in, .size = n };
+        while (out->count < limit) {
+            jingle_input_reserve(out, JINGLE_INPUT_CHUNK);
+            ZSTD_outBuffer output = { .dst = out->data, .size = out->capacity - 1, .pos = out->count };
+
+            size_t ret = ZSTD_decompressStream(d->zs, &output, &input);
+            if (ZSTD_isError(ret)) return false;
+            out->count = output.pos;
+            d->done = ret == 0;
+
+            // As with zlib, a full output buffer means the decoder may still be holding data back, unless the frame
+            // just ended (calling it again would only start looking for the next one)
+            if (input.pos == input.size && (output.pos < output.size || d->done)) break;
+        }
+        return true;
+    }
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+/// How big the decompressed data will be, when the container says so. 0 if unknown. Only a starting size for the
+/// buffer, see jingle_input_size_hint.
+static size_t
+jingle_input_claimed_size(int fd, Jingle_Input_Kind kind, const unsigned char *head, size_t n, struct stat *st)
+{
+    switch (kind) {
+    case JINGLE_INPUT_RAW:
+        return S_ISREG(st->st_mode) ? (size_t)st->st_size : 0;
+
+    case JINGLE_INPUT_GZIP: {
+        // The last four bytes are the size of the (last member's) data modulo 2^32
+        unsigned char trailer[4];
+        if (!S_ISREG(st->st_mode) || st->st_size < 18) return 0;
+        if (pread(fd, trailer, sizeof(trailer), st->st_size - 4) != sizeof(trailer)) return 0;
+        return (size_t)trailer[0] | (size_t)trailer[1] << 8 | (size_t)trailer[2] << 16 | (size_t)trailer[3] << 24;
+    }
+
+    case JINGLE_INPUT_ZSTD:
+#ifdef JINGLE_ZSTD
+    {
+        unsigned long long size = ZSTD_getFrameContentSize(head, n);
+        if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) return 0;
+        return size;
+    }
+#else
+        (void)head;
+        (void)n;
+        return 0;
+#endif
+    }
+    return 0;
+}
+
+/// What the container claims, capped at JINGLE_INPUT_HINT_RATIO times the size of the file
+static size_t
+jingle_input_size_hint(int fd, Jingle_Input_Kind kind, const unsigned char *head, size_t n, struct stat *st)
+{
+    size_t claimed = jingle_input_claimed_size(fd, kind, head, n, st);
+    if (kind == JINGLE_INPUT_RAW) return claimed;
+
+    size_t cap = S_ISREG(st->st_mode) && st->st_size > 0 ? (size_t)st->st_size * JINGLE_INPUT_HINT_RATIO : 0;
+    return claimed < cap ? claimed : cap;
+}
+
+/// Reads (and if needed decompresses) the file at path into *out. Plain regular files are mapped read-only and
+/// *mapped is set; anything else ends up in a heap buffer. With a nonzero limit, reading stops once at least that
+/// many bytes are available, which is how callers peek at the decompressed header of a file.
+bool
+jingle_read_input(const char *path, size_t limit, string_t *out, bool *mapped)
+{
+    *out = (string_t){0};
+    *mapped = false;
+    if (limit == 0) limit = SIZE_MAX;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[ERROR] Could not open file '%s'\n", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "[ERROR] Could not stat file '%s'\n", path);
+        close(fd);
+        return false;
+    }
+
+    unsigned char *in = malloc(JINGLE_INPUT_CHUNK);
+    if (in == NULL) {
+        fprintf(stderr, "[ERROR] Not enough memory to allocate %d bytes\n", JINGLE_INPUT_CHUNK);
+        exit(1);
+    }
+
+    ssize_t n = read(fd, in, JINGLE_INPUT_CHUNK);
+    if (n < 0) n = 0;
+    Jingle_Input_Kind kind = jingle_input_kind(in, n);
+
+    if (kind == JINGLE_INPUT_RAW && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            free(in);
+            close(fd);
+            out->data = data;
+            out->count = st.st_size;
+            *mapped = true;
+            return true;
+        }
+    }
+
+    Jingle_Decoder d;
+    if (!jingle_decoder_init(&d, kind, path)) {
+        free(in);
+        close(fd);
+        return false;
+    }
+
+    size_t hint = jingle_input_size_hint(fd, kind, in, n, &st);
+    if (hint > limit) hint = limit;
+    jingle_input_reserve(out, hint);
+
+    bool ok = true;
+    while (n > 0 && out->count < limit) {
+        if (!jingle_decoder_feed(&d, in, n, out, limit)) {
+            ok = false;
+            break;
+        }
+        n = read(fd, in, JINGLE_INPUT_CHUNK);
+    }
+
+    if (n < 0) ok = false;
+    // Running out of input halfway through a stream means the file is truncated, unless we only wanted a peek
+    if (ok && kind != JINGLE_INPUT_RAW && !d.done && out->count < limit) ok = false;
+
+    jingle_decoder_free(&d);
+    free(in);
+    close(fd);
+
+    if (!ok) {
+        fprintf(stderr, "[ERROR] Failed to read file '%s' (truncated or corrupt %s data)\n", path,
+                kind == JINGLE_INPUT_GZIP ? "gzip" : kind == JINGLE_INPUT_ZSTD ? "zstd" : "file");
+        string_free(out);
+        return false;
+    }
+
+    out->data[out->count] = '\0';
+    return true;
+}
+
+/// ar archives (static libraries), plain or compressed.
+///
+/// The members of an archive are addressed as "lib.a(member.o)", the way binutils prints them. Archives can hold
+/// several members of the same name (ar q, BSD archives); the second one is "lib.a(member.o@2)", and so on. Every archive is
+/// read once and kept until jingle_archives_free, so opening its members one after another (or from many threads)
+/// doesn't decompress it over and over.
+
+#define JINGLE_AR_MAGIC "!<arch>\n"
+#define JINGLE_AR_MAGIC_LEN 8
+
+typedef struct {
+    char *path;   // "archive(member)", owned
+    size_t offset;
+    size_t size;
+} Jingle_Archive_Member;
+
+typedef struct {
+    string_t data;
+    bool mapped;
+    bool valid;
+    Jingle_Archive_Member *members; // stb_ds array
+} Jingle_Archive;
+
+// Archives are allocated one by one and never move, so callers can keep using them after the lock is released while
+// other threads add to the map
+typedef struct {
+    char *key;    // path of the archive
+    Jingle_Archive *value;
+} Jingle_Archive_Entry;
+
+static Jingle_Archive_Entry *jingle_archives = NULL; // stb_ds string map
+static pthread_mutex_t jingle_archives_lock = PTHREAD_MUTEX_INITIALIZER;
+
+bool
+jingle_is_archive(string_t data)
+{
+    return data.count >= JINGLE_AR_MAGIC_LEN && memcmp(data.data, JINGLE_AR_MAGIC, JINGLE_AR_MAGIC_LEN) == 0;
+}
+
+static size_t
+jingle_ar_number(const char *field, size_t n, int base)
+{
+    char buf[24] = {0};
+    memcpy(buf, field, n < sizeof(buf) - 1 ? n : sizeof(buf) - 1);
+    return strtoull(buf, NULL, base);
+}
+
+/// Lists the members of an archive, skipping the symbol index and the long name table. Understands both the GNU
+/// ("name/", "/123") and the BSD ("#1/len") ways of storing names.
+static bool
+jingle_archive_parse(Jingle_Archive *ar, const char *path)
+{
+    const char *data = ar->data.data;
+    size_t n = ar->data.count;
+    const char *long_names = NULL;
+    size_t long_names_count = 0;
+
+    // How many members of each name came before, to tell copies apart
+    struct { char *key; size_t value; } *seen = NULL;
+    sh_new_arena(seen);
+    bool ok = true;
+
+    size_t at = JINGLE_AR_MAGIC_LEN;
+    while (at + 60 <= n) {
+        const char *header = data + at;
+        if (header[58] != '`' || header[59] != '\n') { ok = false; break; }
+
+        size_t size = jingle_ar_number(header + 48, 10, 10);
+        size_t offset = at + 60;
+        if (size > n - offset) { ok = false; break; }
+        at = offset + size + (size & 1);
+
+        const char *name = header;
+        size_t name_len = 16;
+        while (name_len > 0 && name[name_len-1] == ' ') name_len--;
+
+        if (name_len == 1 && name[0] == '/') continue;                     // GNU symbol index
+        if (name_len == 7 && memcmp(name, "/SYM64/", 7) == 0) continue;    // GNU 64-bit symbol index
+        if (name_len == 2 && memcmp(name, "//", 2) == 0) {                 // GNU long name table
+            long_names = data + offset;
+            long_names_count = size;
+            continue;
+        }
+
+        if (name_len > 3 && memcmp(name, "#1/", 3) == 0) {
+            // BSD: the name follows the header and counts towards the member size
+            size_t len = jingle_ar_number(name + 3, name_len - 3, 10);
+            if (len > size) { ok = false; break; }
+            name = data + offset;
+            name_len = strnlen(name, len);
+            offset += len;
+            size -= len;
+            if (name_len >= 9 && memcmp(name, "__.SYMDEF", 9) == 0) continue; // BSD symbol index
+        } else if (name_len > 1 && name[0] == '/') {
+            size_t start = jingle_ar_number(name + 1, name_len - 1, 10);
+            if (long_names == NULL || start >= long_names_count) { ok = false; break; }
+            name = long_names + start;
+            name_len = 0;
+            while (start + name_len < long_names_count && name[name_len] != '\n') name_len++;
+            if (name_len > 0 && name[name_len-1] == '/') name_len--;
+        } else if (name_len > 0 && name[name_len-1] == '/') {
+            name_len--;
+        }
+
+        char *key = strndup(name, name_len);
+        size_t copy = shget(seen, key) + 1;
+        shput(seen, key, copy);
+        free(key);
+
+        size_t path_len = strlen(path) + name_len + 3 + (copy > 1 ? 21 : 0);
+        Jingle_Archive_Member m = { .path = malloc(path_len), .offset = offset, .size = size };
+        if (copy > 1) snprintf(m.path, path_len, "%s(%.*s@%zu)", path, (int)name_len, name, copy);
+        else snprintf(m.path, path_len, "%s(%.*s)", path, (int)name_len, name);
+        arrput(ar->members, m);
+    }
+
+    shfree(seen);
+    return ok;
+}
+
+/// Returns the archive at path, reading it the first time it is asked for. NULL if it can't be read or it isn't an
+/// archive. The archive stays loaded until jingle_archives_free.
+Jingle_Archive *
+jingle_archive_load(char *path)
+{
+    pthread_mutex_lock(&jingle_archives_lock);
+    if (jingle_archives == NULL) sh_new_strdup(jingle_archives);
+
+    Jingle_Archive *ar = shget(jingle_archives, path);
+    if (ar == NULL) {
+        ar = calloc(1, sizeof(Jingle_Archive));
+        if (ar == NULL) {
+            fprintf(stderr, "[ERROR] Not enough memory to allocate %zu bytes\n", sizeof(Jingle_Archive));
+            exit(1);
+        }
+        if (jingle_read_input(path, 0, &ar->data, &ar->mapped)) {
+            ar->valid = jingle_is_archive(ar->data) && jingle_archive_parse(ar, path);
+            if (!ar->valid) {
+                fprintf(stderr, "[ERROR] '%s' is not a valid ar archive\n", path);
+            }
+        }
+        shput(jingle_archives, path, ar);
+    }
+    pthread_mutex_unlock(&jingle_archives_lock);
+
+    return ar->valid ? ar : NULL;
+}
+
+/// Looks up a path of the form "archive(member)" and copies the member into *out. The copy keeps the ELF
+/// structures aligned, which archive members only are to 2 bytes. Returns false if path doesn't name a member.
+bool
+jingle_archive_member(char *path, string_t *out)
+{
+    size_t len = strlen(path);
+    char *open_paren = strrchr(path, '(');
+    if (len == 0 || path[len-1] != ')' || open_paren == NULL || open_paren == path) return false;
+
+    char *archive_path = strndup(path, open_paren - path);
+    bool found = false;
+
+    struct stat st;
+    if (stat(archive_path, &st) == 0) {
+        Jingle_Archive *ar = jingle_archive_load(archive_path);
+        for (size_t i = 0; ar != NULL && i < (size_t)arrlen(ar->members); ++i) {
+            Jingle_Archive_Member *m = &ar->members[i];
+            if (strcmp(m->path, path) != 0) continue;
+
+            *out = (string_t){ .data = STRING_T_REALLOC(NULL, m->size + 1), .count = m->size, .capacity = m->size + 1 };
+            if (out->data == NULL) {
+                fprintf(stderr, "[ERROR] Not enough memory to allocate %zu bytes\n", m->size + 1);
+                exit(1);
+            }
+            memcpy(out->data, ar->data.data + m->offset, m->size);
+            out->data[m->size] = '\0';
+            found = true;
+            break;
+        }
+    }
+
+    free(archive_path);
+    return found;
+}
+
+/// Replaces every archive among paths with the paths of its members and returns the result as a new stb_ds array.
+/// Only the first few (decompressed) bytes of each file are looked at to tell archives apart from everything else.
+char **
+jingle_expand_archives(char **paths, size_t count)
+{
+    char **result = NULL;
+
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char magic[JINGLE_AR_MAGIC_LEN] = {0};
+        bool is_archive = false;
+
+        // Unreadable files are left for whoever opens them for real to report
+        int fd = open(paths[i], O_RDONLY);
+        if (fd < 0) {
+            arrput(result, paths[i]);
+            continue;
+        }
+        ssize_t n = pread(fd, magic, sizeof(magic), 0);
+        close(fd);
+
+        Jingle_Input_Kind kind = jingle_input_kind(magic, n > 0 ? n : 0);
+        if (kind == JINGLE_INPUT_RAW) {
+            is_archive = jingle_is_archive((string_t){ .data = (char *)magic, .count = n > 0 ? n : 0 });
+        } else if (jingle_input_supported(kind)) {
+            string_t head;
+            bool mapped;
+            if (jingle_read_input(paths[i], JINGLE_AR_MAGIC_LEN, &head, &mapped)) {
+                is_archive = jingle_is_archive(head);
+                string_free(&head);
+            }
+        }
+
+        if (!is_archive) {
+            arrput(result, paths[i]);
+            continue;
+        }
+
+        Jingle_Archive *ar = jingle_archive_load(paths[i]);
+        if (ar == NULL) continue;
+        for (size_t j = 0; j < (size_t)arrlen(ar->members); ++j) arrput(result, ar->members[j].path);
+        if (arrlen(ar->members) == 0) fprintf(stderr, "[WARN] Archive '%s' has no members\n", paths[i]);
+    }
+
+    return result;
+}
+
+void
+jingle_archives_free(void)
+{
+    for (size_t i = 0; i < (size_t)shlen(jingle_archives); ++i) {
+        Jingle_Archive *ar = jingle_archives[i].value;
+        for (size_t j = 0; j < (size_t)arrlen(ar->members); ++j) free(ar->members[j].path);
+        arrfree(ar->members);
+        if (ar->mapped) munmap(ar->data.data, ar->data.count);
+        else string_free(&ar->data);
+        free(ar);
+    }
+    shfree(jingle_archives);
+}
+
+#endif // JINGLE_INPUT_C_
@@ -0,0 +1,98 @@
+#ifndef JINGLE_PARALLEL_C_
+#define JINGLE_PARALLEL_C_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/// A tiny work-sharing loop for the multi-file modes.
+///
+/// Every worker pulls the next item index off a shared counter, so uneven items (one huge object among many small
+/// ones) still balance out. The task also gets the index of the worker running it, which lets callers keep
+/// per-worker state (heaps, result lists, ...) without any locking and merge it once the loop is done.
+
+typedef void (*Jingle_Task)(void *ctx, size_t worker, size_t item);
+
+// 0 means "one worker per online CPU"
+size_t jingle_threads = 0;
+
+size_t
+jingle_worker_count(size_t items)
+{
+    size_t n = jingle_threads;
+    if (n == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (n > items) n = items;
+    if (n == 0) n = 1;
+    return n;
+}
+
+typedef struct {
+    Jingle_Task task;
+    void *ctx;
+    size_t items;
+    atomic_size_t next;
+} Jingle_Parallel;
+
+typedef struct {
+    Jingle_Parallel *p;
+    size_t worker;
+} Jingle_Worker;
+
+static void *
+jingle_worker_main(void *arg)
+{
+    Jingle_Worker *w = arg;
+    Jingle_Parallel *p = w->p;
+
+    for (;;) {
+        size_t item = atomic_fetch_add_explicit(&p->next, 1, memory_order_relaxed);
+        if (item >= p->items) break;
+        p->task(p->ctx, w->worker, item);
+    }
+
+    return NULL;
+}
+
+/// Runs task(ctx, worker, item) for every item in [0, items) on jingle_worker_count(items) threads.
+/// The calling thread is used as worker 0, so a single worker never spawns anything.
+void
+jingle_parallel_for(size_t items, Jingle_Task task, void *ctx)
+{
+    if (items == 0) return;
+
+    Jingle_Parallel p = { .task = task, .ctx = ctx, .items = items };
+    atomic_init(&p.next, 0);
+
+    size_t workers = jingle_worker_count(items);
+    pthread_t *threads = calloc(workers, sizeof(*threads));
+    Jingle_Worker *args = calloc(workers, sizeof(*args));
+    if (threads == NULL || args == NULL) {
+        fprintf(stderr, "[ERROR] Not enough memory to start %zu workers\n", workers);
+        exit(1);
+    }
+
+    size_t started = 1;
+    for (size_t i = 1; i < workers; ++i) {
+        args[i] = (Jingle_Worker){ .p = &p, .worker = i };
+        if (pthread_create(&threads[i], NULL, jingle_worker_main, &args[i]) != 0) break;
+        started++;
+    }
+
+    args[0] = (Jingle_Worker){ .p = &p, .worker = 0 };
+    jingle_worker_main(&args[0]);
+
+    for (size_t i = 1; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    free(args);
+}
+
+#endif // JINGLE_PARALLEL_C_
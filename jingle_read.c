@@ -3,8 +3,24 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+// Older elf.h headers predate zstd compressed sections
+#ifndef ELFCOMPRESS_ZSTD
+#define ELFCOMPRESS_ZSTD 2
+#endif
 
 #include "string_t.c"
+#include "stb_ds.h"
+#include "jingle_parallel.c"
+#include "jingle_input.c"
+#include "jingle_reloc.c"
+#include "jingle_swap.c"
 
 static void
 jingle_err_warn(const char* function_name, const char* message)
@@ -39,6 +55,7 @@ bool
 jingle_is_elf(string_t file)
 {
     return (
+        file.count >= SELFMAG &&
         (unsigned char)file.data[EI_MAG0] == 0x7f &&
         (unsigned char)file.data[EI_MAG1] == 'E' &&
         (unsigned char)file.data[EI_MAG2] == 'L' &&
@@ -46,37 +63,67 @@ jingle_is_elf(string_t file)
         );
 }
 
-/// Some useful macros for accessing the various parts of an ELF file.
+static void *
+jingle_xcalloc(size_t count, size_t size)
+{
+    void *p = calloc(count, size);
+    if (p == NULL && count > 0 && size > 0) {
+        fprintf(stderr, "[ERROR] Not enough memory to allocate %zu entries of %zu bytes\n", count, size);
+        exit(1);
+    }
+    return p;
+}
 
-#define ELF64_EHDR(contents)    (Elf64_Ehdr *)(contents)
-#define ELF64_PHDR(contents, i) (Elf64_Phdr *)((contents) + (((Elf64_Ehdr *)(contents))->e_phoff + ((Elf64_Ehdr *)(contents))->e_phentsize * (i)))
-#define ELF64_SHDR(contents, i) (Elf64_Shdr *)((contents) + (((Elf64_Ehdr *)(contents))->e_shoff + ((Elf64_Ehdr *)(contents))->e_shentsize * (i)))
+/// Loading files
+
+typedef struct {
+    char *path;
+    string_t file;
+    bool mapped; // file.data is a read-only mapping rather than a heap buffer
+
+    bool verified;   // jingle_verify passed
+    char error[128]; // why it didn't
+
+    // Elf64 views of the file, set up by jingle_verify (see jingle_elfclass.c). ehdr and shdrs are the headers,
+    // tables[i] the Elf64_Sym, Elf64_Rela or Elf64_Rel entries of section i if it is one of those tables, NULL
+    // otherwise. With owns_views they are widened copies rather than pointers into file.
+    Elf64_Ehdr *ehdr;
+    Elf64_Shdr *shdrs;
+    void **tables;
+    bool owns_views;
+
+    // Decompressed contents of SHF_COMPRESSED sections, one slot per section, filled in by jingle_section_data
+    string_t *decoded;
+    pthread_mutex_t decoded_lock;
+} Jingle_File;
 
 /// Functions to read common sections
+///
+/// These trust the file: they expect it to have gone through jingle_verify first.
 
 typedef struct {
     Elf64_Sym *data;
     size_t count;
     size_t sh_name;
     char *names;
+    size_t names_count;
 } Jingle_Symtab;
 
 Jingle_Symtab
-jingle_read_symtab(string_t file)
+jingle_read_symtab(Jingle_File *jf)
 {
     Jingle_Symtab s = {0};
 
-    Elf64_Ehdr *eh = ELF64_EHDR(file.data);
-    for (size_t i = 0; i < eh->e_shnum; ++i) {
-        Elf64_Shdr *sh = ELF64_SHDR(file.data, i);
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
         if (sh->sh_type == SHT_SYMTAB) {
-            assert(sh->sh_offset < file.count);
-            s.data = (Elf64_Sym *)(file.data + sh->sh_offset);
+            s.data = jf->tables[i];
             s.count = sh->sh_size / sh->sh_entsize;
             s.sh_name = sh->sh_name;
 
-            Elf64_Shdr *strtab_sh = ELF64_SHDR(file.data, sh->sh_link);
-            s.names = file.data + strtab_sh->sh_offset;
+            Elf64_Shdr *strtab_sh = &jf->shdrs[sh->sh_link];
+            s.names = jf->file.data + strtab_sh->sh_offset;
+            s.names_count = strtab_sh->sh_size;
 
             return s;
         }
@@ -85,6 +132,30 @@ jingle_read_symtab(string_t file)
     return s;
 }
 
+/// Display names for every symbol of a table, resolved once so that printing symbols and relocations is a single
+/// indexed load per entry. Section symbols are named after their section (through shstrtab), everything else
+/// through the symbol string table. Free the result with free().
+const char **
+jingle_symbol_names(Jingle_File *jf, string_t shstrtab, Jingle_Symtab symtab)
+{
+    const char **names = malloc((symtab.count + 1) * sizeof(*names));
+    if (names == NULL) {
+        fprintf(stderr, "[ERROR] Not enough memory to allocate %zu symbol names\n", symtab.count);
+        exit(1);
+    }
+
+    for (size_t i = 0; i < symtab.count; ++i) {
+        Elf64_Sym *sym = &symtab.data[i];
+        if (ELF64_ST_TYPE(sym->st_info) == STT_SECTION) {
+            names[i] = &shstrtab.data[jf->shdrs[sym->st_shndx].sh_name];
+        } else {
+            names[i] = &symtab.names[sym->st_name];
+        }
+    }
+
+    return names;
+}
+
 typedef struct {
     Elf64_Rela *data;
     size_t count;
@@ -92,16 +163,38 @@ typedef struct {
 } Jingle_Rela;
 
 Jingle_Rela
-jingle_read_rela(string_t file)
+jingle_read_rela(Jingle_File *jf)
 {
     Jingle_Rela r = {0};
 
-    Elf64_Ehdr *eh = ELF64_EHDR(file.data);
-    for (size_t i = 0; i < eh->e_shnum; ++i) {
-        Elf64_Shdr *sh = ELF64_SHDR(file.data, i);
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
         if (sh->sh_type == SHT_RELA) {
-            assert(sh->sh_offset < file.count);
-            r.data = (Elf64_Rela *)(file.data + sh->sh_offset);
+            r.data = jf->tables[i];
+            r.count = sh->sh_size / sh->sh_entsize;
+            r.sh_name = sh->sh_name;
+        }
+    }
+
+    return r;
+}
+
+typedef struct {
+    Elf64_Rel *data;
+    size_t count;
+    size_t sh_name;
+} Jingle_Rel;
+
+/// REL counterpart of jingle_read_rela, for targets like i386 that keep addends in the relocated bytes
+Jingle_Rel
+jingle_read_rel(Jingle_File *jf)
+{
+    Jingle_Rel r = {0};
+
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
+        if (sh->sh_type == SHT_REL) {
+            r.data = jf->tables[i];
             r.count = sh->sh_size / sh->sh_entsize;
             r.sh_name = sh->sh_name;
         }
@@ -111,20 +204,508 @@ jingle_read_rela(string_t file)
 }
 
 string_t
-jingle_read_shstrtab(string_t file)
+jingle_read_shstrtab(Jingle_File *jf)
 {
-    string_t s;
+    string_t s = {0};
 
-    Elf64_Ehdr *eh = ELF64_EHDR(file.data);
-    Elf64_Shdr *sh = ELF64_SHDR(file.data, eh->e_shstrndx);
+    if (jf->ehdr->e_shnum == 0) return s;
+    Elf64_Shdr *sh = &jf->shdrs[jf->ehdr->e_shstrndx];
 
-    assert(sh->sh_offset < file.count);
-    s.data = (file.data + sh->sh_offset);
+    s.data = (jf->file.data + sh->sh_offset);
     s.count = sh->sh_size;
 
     return s;
 }
 
+/// Regular files are mapped rather than read, so the modes that only touch a few tables of each input never pull
+/// the rest of the file in. Compressed files and archive members end up in a heap buffer (see jingle_input.c).
+bool
+jingle_open(Jingle_File *jf, char *path)
+{
+    *jf = (Jingle_File){ .path = path };
+    pthread_mutex_init(&jf->decoded_lock, NULL);
+
+    // Members of static libraries, "lib.a(member.o)"
+    if (jingle_archive_member(path, &jf->file)) return true;
+
+    return jingle_read_input(path, 0, &jf->file, &jf->mapped);
+}
+
+void
+jingle_close(Jingle_File *jf)
+{
+    size_t shnum = jf->ehdr != NULL ? jf->ehdr->e_shnum : 0;
+
+    if (jf->decoded != NULL) {
+        for (size_t i = 0; i < shnum; ++i) string_free(&jf->decoded[i]);
+        free(jf->decoded);
+        jf->decoded = NULL;
+    }
+    pthread_mutex_destroy(&jf->decoded_lock);
+
+    if (jf->owns_views) {
+        for (size_t i = 0; i < shnum; ++i) free(jf->tables[i]);
+        free(jf->shdrs);
+        free(jf->ehdr);
+    }
+    free(jf->tables);
+    jf->ehdr = NULL;
+    jf->shdrs = NULL;
+    jf->tables = NULL;
+    jf->owns_views = false;
+
+    if (jf->mapped) {
+        munmap(jf->file.data, jf->file.count);
+        jf->file = (string_t){0};
+        jf->mapped = false;
+    } else {
+        string_free(&jf->file);
+    }
+}
+
+/// Structural checks, done once per file before anything else looks at it.
+///
+/// The readers and the display code index straight into the file: the header tables, string tables through
+/// sh_name and st_name, symbols through relocations and sections through st_shndx. jingle_verify checks every one
+/// of those up front, so the loops that run afterwards need no per-entry checks and still can't be sent past the end
+/// of the buffer by a truncated or hostile file.
+
+static bool
+jingle_verify_fail(Jingle_File *jf, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(jf->error, sizeof(jf->error), fmt, args);
+    va_end(args);
+    return false;
+}
+
+static bool
+jingle_range_ok(string_t file, uint64_t offset, uint64_t size)
+{
+    return offset <= file.count && size <= file.count - offset;
+}
+
+static bool
+jingle_verify_table(Jingle_File *jf, size_t i, uint64_t sh_entsize, uint64_t sh_size, size_t entsize)
+{
+    if (sh_entsize != entsize) return jingle_verify_fail(jf, "section %zu has entry size %lu, expected %zu", i, sh_entsize, entsize);
+    if (sh_size % entsize != 0) return jingle_verify_fail(jf, "section %zu is not a whole number of entries", i);
+    return true;
+}
+
+#define JINGLE_CLASS 32
+#include "jingle_elfclass.c"
+#undef JINGLE_CLASS
+
+#define JINGLE_CLASS 64
+#include "jingle_elfclass.c"
+#undef JINGLE_CLASS
+
+/// Returns true if the file is safe to hand to the rest of the reader. Otherwise jf->error says what is wrong.
+bool
+jingle_verify(Jingle_File *jf)
+{
+    if (jf->verified) return true;
+
+    string_t file = jf->file;
+    if (!jingle_is_elf(file)) return jingle_verify_fail(jf, "not an ELF file");
+    if (file.count < EI_NIDENT) return jingle_verify_fail(jf, "truncated ELF header");
+
+    unsigned char data = file.data[EI_DATA];
+    if (data != ELFDATA2LSB && data != ELFDATA2MSB) return jingle_verify_fail(jf, "unknown data encoding %u", data);
+
+    switch ((unsigned char)file.data[EI_CLASS]) {
+    case ELFCLASS32: {
+        Jingle_Native_32 n = {0};
+        if (!jingle_verify_class_32(jf, &n)) {
+            jingle_native_free_32(&n);
+            return false;
+        }
+        jingle_build_views_32(jf, &n);
+    } break;
+    case ELFCLASS64: {
+        Jingle_Native_64 n = {0};
+        if (!jingle_verify_class_64(jf, &n)) {
+            jingle_native_free_64(&n);
+            return false;
+        }
+        jingle_build_views_64(jf, &n);
+    } break;
+    default:
+        return jingle_verify_fail(jf, "unknown ELF class %u", (unsigned char)file.data[EI_CLASS]);
+    }
+
+    jf->verified = true;
+    return true;
+}
+
+/// Compressed sections (SHF_COMPRESSED, e.g. from -gz) start with an Elf32_Chdr or Elf64_Chdr giving the format
+/// and the size of the decompressed data. They are inflated the first time anything asks for their contents and
+/// kept for as long as the file stays open. zlib is always available unless built with JINGLE_NO_ZLIB; zstd needs
+/// JINGLE_ZSTD.
+
+#ifdef JINGLE_ZSTD
+typedef struct {
+    const char *src;
+    char *dst;
+    size_t *src_offsets; // frame i is src[src_offsets[i] .. src_offsets[i+1])
+    size_t *dst_offsets;
+    bool failed;
+} Jingle_Zstd_Frames;
+
+static void
+jingle_zstd_frame_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Jingle_Zstd_Frames *f = ctx;
+    size_t src_size = f->src_offsets[item + 1] - f->src_offsets[item];
+    size_t dst_size = f->dst_offsets[item + 1] - f->dst_offsets[item];
+
+    size_t n = ZSTD_decompress(f->dst + f->dst_offsets[item], dst_size, f->src + f->src_offsets[item], src_size);
+    if (ZSTD_isError(n) || n != dst_size) f->failed = true;
+}
+
+/// Data made of several frames whose sizes are all known up front is decompressed one frame per worker, since
+/// frames don't depend on each other. Anything else goes through a single ZSTD_decompress call.
+static bool
+jingle_zstd_decompress(char *dst, size_t dst_size, const char *src, size_t src_size)
+{
+    Jingle_Zstd_Frames f = { .src = src, .dst = dst };
+    size_t src_at = 0, dst_at = 0;
+    bool split = true;
+
+    arrput(f.src_offsets, 0);
+    arrput(f.dst_offsets, 0);
+    while (src_at < src_size) {
+        size_t frame = ZSTD_findFrameCompressedSize(src + src_at, src_size - src_at);
+        unsigned long long content = ZSTD_getFrameContentSize(src + src_at, src_size - src_at);
+        if (ZSTD_isError(frame) || content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR) {
+            split = false;
+            break;
+        }
+        src_at += frame;
+        dst_at += content;
+        arrput(f.src_offsets, src_at);
+        arrput(f.dst_offsets, dst_at);
+    }
+
+    bool ok;
+    if (split && dst_at == dst_size && arrlen(f.src_offsets) > 2) {
+        jingle_parallel_for(arrlen(f.src_offsets) - 1, jingle_zstd_frame_task, &f);
+        ok = !f.failed;
+    } else {
+        size_t n = ZSTD_decompress(dst, dst_size, src, src_size);
+        ok = !ZSTD_isError(n) && n == dst_size;
+    }
+
+    arrfree(f.src_offsets);
+    arrfree(f.dst_offsets);
+    return ok;
+}
+#endif // JINGLE_ZSTD
+
+static bool
+jingle_decompress(Elf64_Word type, char *dst, size_t dst_size, const char *src, size_t src_size)
+{
+    switch (type) {
+#ifndef JINGLE_NO_ZLIB
+    case ELFCOMPRESS_ZLIB: {
+        uLongf n = dst_size;
+        return uncompress((Bytef *)dst, &n, (const Bytef *)src, src_size) == Z_OK && n == dst_size;
+    }
+#endif
+#ifdef JINGLE_ZSTD
+    case ELFCOMPRESS_ZSTD:
+        return jingle_zstd_decompress(dst, dst_size, src, src_size);
+#endif
+    default:
+        return false;
+    }
+}
+
+/// The most the compressed data can expand to, or 0 if it can't be decompressed at all. Keeps a corrupt ch_size
+/// from turning into a huge allocation.
+static uint64_t
+jingle_decompress_bound(Elf64_Word type, const char *src, size_t src_size)
+{
+    switch (type) {
+#ifndef JINGLE_NO_ZLIB
+    case ELFCOMPRESS_ZLIB:
+        // deflate can't do better than 1032:1
+        return (uint64_t)src_size * 1032 + 1024;
+#endif
+#ifdef JINGLE_ZSTD
+    case ELFCOMPRESS_ZSTD: {
+        unsigned long long bound = ZSTD_decompressBound(src, src_size);
+        return bound == ZSTD_CONTENTSIZE_ERROR ? 0 : bound;
+    }
+#endif
+    default:
+        (void)src;
+        (void)src_size;
+        return 0;
+    }
+}
+
+/// The contents of a section, decompressed if needed. NOBITS sections have no contents. If a compressed section
+/// cannot be decompressed (unknown format, or support not built in) its raw bytes are returned with a warning.
+string_t
+jingle_section_data(Jingle_File *jf, size_t shndx)
+{
+    Elf64_Shdr *sh = &jf->shdrs[shndx];
+    // jingle_verify doesn't range-check these, they have no contents whatever their offset and size say
+    if (sh->sh_type == SHT_NOBITS || sh->sh_type == SHT_NULL) return (string_t){0};
+
+    string_t raw = { .data = jf->file.data + sh->sh_offset, .count = sh->sh_size };
+    // jingle_verify made sure compressed sections are at least a compression header long
+    if (!(sh->sh_flags & SHF_COMPRESSED)) return raw;
+
+    pthread_mutex_lock(&jf->decoded_lock);
+    if (jf->decoded == NULL) jf->decoded = jingle_xcalloc(jf->ehdr->e_shnum, sizeof(string_t));
+    string_t cached = jf->decoded[shndx];
+    pthread_mutex_unlock(&jf->decoded_lock);
+
+    if (cached.data != NULL) return cached;
+
+    Elf64_Chdr chdr;
+    bool swap = jf->ehdr->e_ident[EI_DATA] != JINGLE_HOST_DATA;
+    size_t header = jf->ehdr->e_ident[EI_CLASS] == ELFCLASS32 ? jingle_read_chdr_32(raw.data, swap, &chdr) : jingle_read_chdr_64(raw.data, swap, &chdr);
+
+    string_t decoded = {0};
+    if (chdr.ch_size <= jingle_decompress_bound(chdr.ch_type, raw.data + header, raw.count - header)) {
+        decoded = string_alloc(chdr.ch_size + 1);
+    }
+    if (decoded.data == NULL || !jingle_decompress(chdr.ch_type, decoded.data, chdr.ch_size, raw.data + header, raw.count - header)) {
+        fprintf(stderr, "[WARN] %s: could not decompress section %zu (compression type %u)\n", jf->path, shndx, chdr.ch_type);
+        string_free(&decoded);
+        return raw;
+    }
+    decoded.count = chdr.ch_size;
+
+    pthread_mutex_lock(&jf->decoded_lock);
+    if (jf->decoded[shndx].data == NULL) {
+        jf->decoded[shndx] = decoded;
+    } else {
+        // Someone else got there first
+        string_free(&decoded);
+    }
+    cached = jf->decoded[shndx];
+    pthread_mutex_unlock(&jf->decoded_lock);
+
+    return cached;
+}
+
+/// Symbol labels for one section, sorted by their offset into it. Used to say which function or object a given
+/// section offset falls into.
+
+typedef struct {
+    uint64_t offset; // relative to the start of the section
+    uint64_t size;
+    const char *name;
+} Jingle_Label;
+
+static int
+jingle_label_compare(const void *a, const void *b)
+{
+    const Jingle_Label *x = a, *y = b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    // Prefer sized symbols (functions, objects) over plain labels at the same address
+    if (x->size != y->size) return x->size > y->size ? -1 : 1;
+    return 0;
+}
+
+Jingle_Label *
+jingle_section_labels(Jingle_File *jf, Jingle_Symtab symtab, size_t shndx)
+{
+    Jingle_Label *labels = NULL;
+    Elf64_Shdr *sh = &jf->shdrs[shndx];
+
+    for (size_t i = 1; i < symtab.count; ++i) {
+        Elf64_Sym *sym = &symtab.data[i];
+        if (sym->st_shndx != shndx || sym->st_name == 0) continue;
+        unsigned char type = ELF64_ST_TYPE(sym->st_info);
+        if (type == STT_SECTION || type == STT_FILE) continue;
+
+        Jingle_Label l = { .offset = sym->st_value - sh->sh_addr, .size = sym->st_size, .name = &symtab.names[sym->st_name] };
+        arrput(labels, l);
+    }
+
+    if (arrlen(labels) > 1) qsort(labels, arrlen(labels), sizeof(*labels), jingle_label_compare);
+    return labels;
+}
+
+/// The label containing offset, or failing that the closest one before it. NULL if there is none.
+Jingle_Label *
+jingle_nearest_label(Jingle_Label *labels, uint64_t offset)
+{
+    size_t lo = 0, hi = arrlen(labels);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (labels[mid].offset <= offset) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return NULL;
+
+    // Nested or overlapping symbols are rare, so only look a few labels back for one that actually contains offset
+    for (size_t i = lo; i > 0 && lo - i < 16; --i) {
+        Jingle_Label *l = &labels[i - 1];
+        if (offset < l->offset + l->size) return l;
+    }
+    return &labels[lo - 1];
+}
+
+/// Top-N selection
+///
+/// A bounded min-heap keyed on size: the smallest of the current N largest entries sits at heap[0], so most
+/// candidates are rejected with a single compare and names are only copied for entries that actually get in.
+/// Ties are broken on name and then path so the result does not depend on the order the inputs were visited in.
+
+typedef struct {
+    uint64_t size;
+    char *name; // owned
+    char *path; // borrowed from the caller
+} Jingle_Top_Entry;
+
+typedef struct {
+    Jingle_Top_Entry *heap; // stb_ds array, never longer than limit
+    size_t limit;
+} Jingle_Top;
+
+static bool
+jingle_top_below(uint64_t a_size, const char *a_name, const char *a_path, Jingle_Top_Entry *b)
+{
+    if (a_size != b->size) return a_size < b->size;
+    int c = strcmp(a_name, b->name);
+    if (c != 0) return c > 0;
+    return strcmp(a_path, b->path) > 0;
+}
+
+static void
+jingle_top_sift_down(Jingle_Top_Entry *heap, size_t n, size_t i)
+{
+    for (;;) {
+        size_t min = i;
+        size_t l = 2*i + 1;
+        size_t r = 2*i + 2;
+        if (l < n && jingle_top_below(heap[l].size, heap[l].name, heap[l].path, &heap[min])) min = l;
+        if (r < n && jingle_top_below(heap[r].size, heap[r].name, heap[r].path, &heap[min])) min = r;
+        if (min == i) return;
+
+        Jingle_Top_Entry tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
+    }
+}
+
+static void
+jingle_top_insert(Jingle_Top *top, Jingle_Top_Entry e)
+{
+    size_t n = arrlen(top->heap);
+
+    if (n == top->limit) {
+        free(top->heap[0].name);
+        top->heap[0] = e;
+        jingle_top_sift_down(top->heap, n, 0);
+        return;
+    }
+
+    arrput(top->heap, e);
+    for (size_t i = n; i > 0;) {
+        size_t parent = (i - 1) / 2;
+        if (!jingle_top_below(top->heap[i].size, top->heap[i].name, top->heap[i].path, &top->heap[parent])) break;
+        Jingle_Top_Entry tmp = top->heap[i];
+        top->heap[i] = top->heap[parent];
+        top->heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+void
+jingle_top_push(Jingle_Top *top, uint64_t size, const char *name, char *path)
+{
+    if (top->limit == 0) return;
+
+    if ((size_t)arrlen(top->heap) == top->limit && !jingle_top_below(top->heap[0].size, top->heap[0].name, top->heap[0].path, &(Jingle_Top_Entry){ .size = size, .name = (char *)name, .path = path })) {
+        return;
+    }
+
+    Jingle_Top_Entry e = { .size = size, .name = strdup(name), .path = path };
+    jingle_top_insert(top, e);
+}
+
+/// Moves every entry of src into dst, leaving src empty.
+void
+jingle_top_merge(Jingle_Top *dst, Jingle_Top *src)
+{
+    for (size_t i = 0; i < (size_t)arrlen(src->heap); ++i) {
+        Jingle_Top_Entry *e = &src->heap[i];
+        if ((size_t)arrlen(dst->heap) == dst->limit && !jingle_top_below(dst->heap[0].size, dst->heap[0].name, dst->heap[0].path, e)) {
+            free(e->name);
+            continue;
+        }
+        jingle_top_insert(dst, *e);
+    }
+    arrsetlen(src->heap, 0);
+}
+
+/// Heapsorts the entries in place, largest first. The heap property is gone afterwards.
+void
+jingle_top_sort(Jingle_Top *top)
+{
+    for (size_t n = arrlen(top->heap); n > 1; --n) {
+        Jingle_Top_Entry tmp = top->heap[0];
+        top->heap[0] = top->heap[n-1];
+        top->heap[n-1] = tmp;
+        jingle_top_sift_down(top->heap, n-1, 0);
+    }
+}
+
+void
+jingle_top_free(Jingle_Top *top)
+{
+    for (size_t i = 0; i < (size_t)arrlen(top->heap); ++i) {
+        free(top->heap[i].name);
+    }
+    arrfree(top->heap);
+}
+
+void
+jingle_top_symbols(Jingle_Top *top, Jingle_File *jf)
+{
+    Jingle_Symtab symtab = jingle_read_symtab(jf);
+    for (size_t i = 0; i < symtab.count; ++i) {
+        Elf64_Sym *sym = &symtab.data[i];
+        if (sym->st_size == 0) continue;
+        jingle_top_push(top, sym->st_size, &symtab.names[sym->st_name], jf->path);
+    }
+}
+
+void
+jingle_top_sections(Jingle_Top *top, Jingle_File *jf)
+{
+    string_t shstrtab = jingle_read_shstrtab(jf);
+
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
+        if (sh->sh_size == 0 || sh->sh_type == SHT_NULL) continue;
+        jingle_top_push(top, sh->sh_size, &shstrtab.data[sh->sh_name], jf->path);
+    }
+}
+
+/// Looks a value up in one of the name tables below. Values past the end of a table or without a name of their own
+/// (OS or processor specific ones, or plain garbage) are formatted as a number into buf instead.
+static const char *
+jingle_table_name(const char *const *names, size_t count, size_t value, char *buf, size_t size)
+{
+    if (value < count && names[value] != NULL) return names[value];
+    snprintf(buf, size, "<0x%zx>", value);
+    return buf;
+}
+
+#define JINGLE_NAME(table, value, buf) jingle_table_name((table), sizeof(table)/sizeof((table)[0]), (value), (buf), sizeof(buf))
+
 static const char *ET_NAMES[ET_NUM] = {
     [ET_NONE] = "NONE",
     [ET_REL]  = "REL (Relocatable file)",
@@ -153,15 +734,17 @@ static const char *EI_OSABI_NAMES[256] = {
 void
 jingle_print_elf_header(Elf64_Ehdr *eh, string_t file, FILE *stream)
 {
+    char buf[24];
+
     fprintf(stream, "ELF Header:\n");
     fprintf(stream, "  Magic: ");
     fprintb(stream, file.data, 0, 16);
-    fprintf(stream, "  Class: %s\n", EI_CLASS_NAMES[eh->e_ident[EI_CLASS]]);
-    fprintf(stream, "  Data: %s\n", EI_DATA_NAMES[eh->e_ident[EI_DATA]]);
+    fprintf(stream, "  Class: %s\n", JINGLE_NAME(EI_CLASS_NAMES, eh->e_ident[EI_CLASS], buf));
+    fprintf(stream, "  Data: %s\n", JINGLE_NAME(EI_DATA_NAMES, eh->e_ident[EI_DATA], buf));
     fprintf(stream, "  Version: %d\n", eh->e_version);
-    fprintf(stream, "  OS/ABI: %s\n", EI_OSABI_NAMES[eh->e_ident[EI_OSABI]]);
+    fprintf(stream, "  OS/ABI: %s\n", JINGLE_NAME(EI_OSABI_NAMES, eh->e_ident[EI_OSABI], buf));
     fprintf(stream, "  ABI Version: %d\n", eh->e_ident[EI_ABIVERSION]);
-    fprintf(stream, "  Type: %s\n", ET_NAMES[eh->e_type]);
+    fprintf(stream, "  Type: %s\n", JINGLE_NAME(ET_NAMES, eh->e_type, buf));
     fprintf(stream, "  Machine: %d\n", eh->e_machine);
     fprintf(stream, "  Entry: %zu\n", eh->e_entry);
     fprintf(stream, "  Start of program headers: %zu (bytes into file)\n", eh->e_phoff);
@@ -196,11 +779,76 @@ static const char *SHT_NAMES[SHT_NUM] = {
     [SHT_RELR] = "RELR",
 };
 
+/// Section type names, including the GNU ones that live far outside SHT_NAMES.
+const char *
+jingle_section_type_name(Elf64_Word type, char *buf, size_t size)
+{
+    switch (type) {
+    case SHT_GNU_ATTRIBUTES: return "GNU_ATTRIBUTES";
+    case SHT_GNU_HASH:       return "GNU_HASH";
+    case SHT_GNU_LIBLIST:    return "GNU_LIBLIST";
+    case SHT_GNU_verdef:     return "VERDEF";
+    case SHT_GNU_verneed:    return "VERNEED";
+    case SHT_GNU_versym:     return "VERSYM";
+    case SHT_X86_64_UNWIND:  return "X86_64_UNWIND";
+    default:                 return jingle_table_name(SHT_NAMES, SHT_NUM, type, buf, size);
+    }
+}
+
+/// Restricts a mode to some sections, e.g. `-section-type PROGBITS -section-flags AX`.
+typedef struct {
+    bool any_type;
+    Elf64_Word type;
+    uint64_t flags; // every one of these must be set
+} Jingle_Section_Filter;
+
+/// type is a name from SHT_NAMES or a number, flags is any combination of W, A and X. Either may be NULL.
+bool
+jingle_section_filter_parse(Jingle_Section_Filter *filter, const char *type, const char *flags)
+{
+    *filter = (Jingle_Section_Filter){ .any_type = true };
+
+    if (type != NULL) {
+        filter->any_type = false;
+        char *end;
+        unsigned long n = strtoul(type, &end, 0);
+        if (*type != '\0' && *end == '\0') {
+            filter->type = n;
+        } else {
+            size_t i = 0;
+            for (; i < SHT_NUM; ++i) {
+                if (SHT_NAMES[i] && strcmp(SHT_NAMES[i], type) == 0) break;
+            }
+            if (i == SHT_NUM) return false;
+            filter->type = i;
+        }
+    }
+
+    for (const char *f = flags; f && *f; ++f) {
+        switch (*f) {
+        case 'W': filter->flags |= SHF_WRITE; break;
+        case 'A': filter->flags |= SHF_ALLOC; break;
+        case 'X': filter->flags |= SHF_EXECINSTR; break;
+        default: return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+jingle_section_filter_match(Jingle_Section_Filter *filter, Elf64_Shdr *sh)
+{
+    if (!filter->any_type && sh->sh_type != filter->type) return false;
+    return (sh->sh_flags & filter->flags) == filter->flags;
+}
+
 void
 jingle_print_section_header(Elf64_Shdr *sh, string_t strtab, FILE *stream)
 {
+    char buf[24];
     fprintf(stream, "%-8s %s%s%s   %-8lu %-8lu ",
-            SHT_NAMES[sh->sh_type],
+            jingle_section_type_name(sh->sh_type, buf, sizeof(buf)),
             (sh->sh_flags & SHF_WRITE      ? "W" : "."),
             (sh->sh_flags & SHF_ALLOC      ? "A" : "."),
             (sh->sh_flags & SHF_EXECINSTR  ? "X" : "."),
@@ -265,120 +913,41 @@ jingle_print_symbol(Elf64_Sym *sym, FILE *stream)
     char str[16]; // For sprintf
     SHNDX_NAMES(str, sym->st_shndx);
 
-    fprintf(stream, "%8lu %4lu %7s %6s %9s %6s ", sym->st_value, sym->st_size, STT_NAMES[ELF64_ST_TYPE(sym->st_info)], STB_NAMES[ELF64_ST_BIND(sym->st_info)], STV_NAMES[sym->st_other], str);
-}
-
-/*static const char *R_68K_NAMES[R_68K_NUM] = {
-
-  };*/
-
-static const char *R_386_NAMES[R_386_NUM] = {
-    [R_386_NONE]          = "NONE",
-    [R_386_32]            = "32",
-    [R_386_PC32]          = "PC32",
-    [R_386_GOT32]         = "GOT32",
-    [R_386_PLT32]         = "PLT32",
-    [R_386_COPY]          = "COPY",
-    [R_386_GLOB_DAT]      = "GLOB_DAT",
-    [R_386_JMP_SLOT]      = "JMP_SLOT",
-    [R_386_RELATIVE]      = "RELATIVE",
-    [R_386_GOTOFF]        = "GOTOFF",
-    [R_386_GOTPC]         = "GOTPC",
-    [R_386_32PLT]         = "32PLT",
-    [R_386_TLS_TPOFF]     = "TLS_TPOFF",
-    [R_386_TLS_IE]        = "TLS_IE",
-    [R_386_TLS_GOTIE]     = "TLS_GOTIE",
-    [R_386_TLS_LE]        = "TLS_LE",
-    [R_386_TLS_GD]        = "TLS_GD",
-    [R_386_TLS_LDM]       = "TLS_LDM",
-    [R_386_16]            = "16",
-    [R_386_PC16]          = "PC16",
-    [R_386_8]             = "8",
-    [R_386_PC8]           = "PC8",
-    [R_386_TLS_GD_32]     = "TLS_GD_32",
-    [R_386_TLS_GD_PUSH]   = "TLS_GD_PUSH",
-    [R_386_TLS_GD_CALL]   = "TLS_GD_CALL",
-    [R_386_TLS_GD_POP]    = "TLS_GD_POP",
-    [R_386_TLS_LDM_32]    = "TLS_LDM_32",
-    [R_386_TLS_LDM_CALL]  = "TLS_LDM_CALL",
-    [R_386_TLS_LDM_POP]   = "TLS_LDM_POP",
-    [R_386_TLS_LDO_32]    = "TLS_LDO_32",
-    [R_386_TLS_IE_32]     = "TLS_IE_32",
-    [R_386_TLS_LE_32]     = "TLS_LE_32",
-    [R_386_TLS_DTPMOD32]  = "TLS_DTPMOD32",
-    [R_386_TLS_DTPOFF32]  = "TLS_DTPOFF32",
-    [R_386_TLS_TPOFF32]   = "TLS_TPOFF32",
-    [R_386_SIZE32]        = "SIZE32",
-    [R_386_TLS_GOTDESC]   = "TLS_GOTDESC",
-    [R_386_TLS_DESC_CALL] = "TLS_DESC_CALL",
-    [R_386_TLS_DESC]      = "TLS_DESC",
-    [R_386_IRELATIVE]     = "IRELATIVE",
-    [R_386_GOT32X]        = "GOT32X",
-};
-
-static const char *R_X86_64_NAMES[R_X86_64_NUM] = {
-    [R_X86_64_NONE]            = "NONE",
-    [R_X86_64_64]              = "64",
-    [R_X86_64_PC32]            = "PC32",
-    [R_X86_64_GOT32]           = "GOT32",
-    [R_X86_64_PLT32]           = "PLT32",
-    [R_X86_64_COPY]            = "COPY",
-    [R_X86_64_GLOB_DAT]        = "GLOB_DAT",
-    [R_X86_64_JUMP_SLOT]       = "JUMP_SLOT",
-    [R_X86_64_RELATIVE]        = "RELATIVE",
-    [R_X86_64_GOTPCREL]        = "GOTPCREL",
-    [R_X86_64_32]              = "32",
-    [R_X86_64_32S]             = "32S",
-    [R_X86_64_16]              = "16",
-    [R_X86_64_PC16]            = "PC16",
-    [R_X86_64_8]               = "8",
-    [R_X86_64_PC8]             = "PC8",
-    [R_X86_64_DTPMOD64]        = "DTPMOD64",
-    [R_X86_64_DTPOFF64]        = "DTPOFF64",
-    [R_X86_64_TPOFF64]         = "TPOFF64",
-    [R_X86_64_TLSGD]           = "TLSGD",
-    [R_X86_64_TLSLD]           = "TLSLD",
-    [R_X86_64_DTPOFF32]        = "DTPOFF32",
-    [R_X86_64_GOTTPOFF]        = "GOTTPOFF",
-    [R_X86_64_PC64]            = "PC64",
-    [R_X86_64_GOTOFF64]        = "GOTOFF64",
-    [R_X86_64_GOTPC32]         = "GOTPC32",
-    [R_X86_64_GOT64]           = "GOT64",
-    [R_X86_64_GOTPCREL64]      = "GOTPCREL64",
-    [R_X86_64_GOTPC64]         = "GOTPC64",
-    [R_X86_64_GOTPLT64]        = "GOTPLT64",
-    [R_X86_64_PLTOFF64]        = "PLTOFF64",
-    [R_X86_64_SIZE32]          = "SIZE32",
-    [R_X86_64_SIZE64]          = "SIZE64",
-    [R_X86_64_GOTPC32_TLSDESC] = "GOTPC32_TLSDESC",
-    [R_X86_64_TLSDESC_CALL]    = "TLSDESC_CALL",
-    [R_X86_64_TLSDESC]         = "TLSDESC",
-    [R_X86_64_IRELATIVE]       = "IRELATIVE",
-    [R_X86_64_RELATIVE64]      = "RELATIVE64",
-    [R_X86_64_GOTPCRELX]       = "GOTPCRELX",
-    [R_X86_64_REX_GOTPCRELX]   = "REX_GOTPCRELX",
-};
+    char type[16], bind[16];
+    fprintf(stream, "%8lu %4lu %7s %6s %9s %6s ", sym->st_value, sym->st_size,
+            JINGLE_NAME(STT_NAMES, ELF64_ST_TYPE(sym->st_info), type),
+            JINGLE_NAME(STB_NAMES, ELF64_ST_BIND(sym->st_info), bind),
+            STV_NAMES[ELF64_ST_VISIBILITY(sym->st_other)], str);
+}
 
 void
-jingle_print_rel(Elf64_Rel *rel, FILE *stream)
+jingle_print_rel(Elf64_Rel *rel, const Jingle_Reloc_Arch *arch, const char **names, size_t count, FILE *stream)
 {
-    fprintf(stream, "  Rel:\n");
-    fprintf(stream, "    Offset: %lu\n", rel->r_offset);
-    fprintf(stream, "    Type: %s\n", R_386_NAMES[ELF64_R_TYPE(rel->r_info)]); // TODO: Different R_X_ based on arch
-    fprintf(stream, "    Sym: %lu\n", ELF64_R_SYM(rel->r_info));
+    /// Same as jingle_print_rela, minus the addend: REL addends live in the bytes being relocated.
+    char buf[24];
+    const char *type = jingle_reloc_name(arch, ELF64_R_TYPE(rel->r_info), buf, sizeof(buf));
+
+    size_t index = ELF64_R_SYM(rel->r_info);
+    const char *name = index < count ? names[index] : "";
+
+    fprintf(stream, "%016lu %-15s %s\n", rel->r_offset, type, name);
 }
 
 void
-jingle_print_rela(Elf64_Rela *rela, string_t file, string_t shstrtab, Jingle_Symtab symtab, FILE *stream)
+jingle_print_rela(Elf64_Rela *rela, const Jingle_Reloc_Arch *arch, const char **names, size_t count, FILE *stream)
 {
     /// r_offset = This member gives the location at which to apply the relocation action. For a relocatable file, the value is the byte offset from the beginning of the section to the storage unit affected by the relocation. For an executable file or a shared object, the value is the virtual address of the storage unit affected by the relocation.
     /// R_SYM(r_info) = The symbol table index with respect to which the relocation must be made.
     /// R_TYPE(r_info) = The type of relocation to apply.
+    /// arch comes from jingle_reloc_arch(e_machine), names and count from jingle_symbol_names.
 
-    Elf64_Sym sym = symtab.data[ELF64_R_SYM(rela->r_info)];
-    assert(ELF64_ST_TYPE(sym.st_info) == STT_SECTION);
+    char buf[24];
+    const char *type = jingle_reloc_name(arch, ELF64_R_TYPE(rela->r_info), buf, sizeof(buf));
 
-    Elf64_Shdr *sh = ELF64_SHDR(file.data, sym.st_shndx);
+    // The table may belong to .dynsym rather than the symbol table the names came from, in which case the index
+    // means nothing here
+    size_t index = ELF64_R_SYM(rela->r_info);
+    const char *name = index < count ? names[index] : "";
 
-    fprintf(stream, "%016lu %-15s %s + %lx\n", rela->r_offset, R_X86_64_NAMES[ELF64_R_TYPE(rela->r_info)], &shstrtab.data[sh->sh_name], rela->r_addend);
+    fprintf(stream, "%016lu %-15s %s + %lx\n", rela->r_offset, type, name, rela->r_addend);
 }
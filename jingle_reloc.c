@@ -0,0 +1,289 @@
+#ifndef JINGLE_RELOC_C_
+#define JINGLE_RELOC_C_
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Relocation descriptors, one table per architecture, picked once per file from e_machine.
+///
+/// Every table is generated from an X-macro list below, one line per relocation type:
+///
+///   X(type, name)
+///
+/// The tables are indexed by type directly, so naming a relocation is one compare and one load whatever the
+/// architecture.
+
+typedef struct {
+    const char *name; // NULL for types the architecture doesn't define
+} Jingle_Reloc_Desc;
+
+typedef struct {
+    uint16_t machine;
+    const char *name;
+    const char *prefix; // of the full type names in elf.h, which the descriptor names leave out
+    const Jingle_Reloc_Desc *descs;
+    size_t count;
+} Jingle_Reloc_Arch;
+
+#define JINGLE_RELOCS_X86_64(X) \
+    X(R_X86_64_NONE,            "NONE")             \
+    X(R_X86_64_64,              "64")               \
+    X(R_X86_64_PC32,            "PC32")             \
+    X(R_X86_64_GOT32,           "GOT32")            \
+    X(R_X86_64_PLT32,           "PLT32")            \
+    X(R_X86_64_COPY,            "COPY")             \
+    X(R_X86_64_GLOB_DAT,        "GLOB_DAT")         \
+    X(R_X86_64_JUMP_SLOT,       "JUMP_SLOT")        \
+    X(R_X86_64_RELATIVE,        "RELATIVE")         \
+    X(R_X86_64_GOTPCREL,        "GOTPCREL")         \
+    X(R_X86_64_32,              "32")               \
+    X(R_X86_64_32S,             "32S")              \
+    X(R_X86_64_16,              "16")               \
+    X(R_X86_64_PC16,            "PC16")             \
+    X(R_X86_64_8,               "8")                \
+    X(R_X86_64_PC8,             "PC8")              \
+    X(R_X86_64_DTPMOD64,        "DTPMOD64")         \
+    X(R_X86_64_DTPOFF64,        "DTPOFF64")         \
+    X(R_X86_64_TPOFF64,         "TPOFF64")          \
+    X(R_X86_64_TLSGD,           "TLSGD")            \
+    X(R_X86_64_TLSLD,           "TLSLD")            \
+    X(R_X86_64_DTPOFF32,        "DTPOFF32")         \
+    X(R_X86_64_GOTTPOFF,        "GOTTPOFF")         \
+    X(R_X86_64_TPOFF32,         "TPOFF32")          \
+    X(R_X86_64_PC64,            "PC64")             \
+    X(R_X86_64_GOTOFF64,        "GOTOFF64")         \
+    X(R_X86_64_GOTPC32,         "GOTPC32")          \
+    X(R_X86_64_GOT64,           "GOT64")            \
+    X(R_X86_64_GOTPCREL64,      "GOTPCREL64")       \
+    X(R_X86_64_GOTPC64,         "GOTPC64")          \
+    X(R_X86_64_GOTPLT64,        "GOTPLT64")         \
+    X(R_X86_64_PLTOFF64,        "PLTOFF64")         \
+    X(R_X86_64_SIZE32,          "SIZE32")           \
+    X(R_X86_64_SIZE64,          "SIZE64")           \
+    X(R_X86_64_GOTPC32_TLSDESC, "GOTPC32_TLSDESC")  \
+    X(R_X86_64_TLSDESC_CALL,    "TLSDESC_CALL")     \
+    X(R_X86_64_TLSDESC,         "TLSDESC")          \
+    X(R_X86_64_IRELATIVE,       "IRELATIVE")        \
+    X(R_X86_64_RELATIVE64,      "RELATIVE64")       \
+    X(R_X86_64_GOTPCRELX,       "GOTPCRELX")        \
+    X(R_X86_64_REX_GOTPCRELX,   "REX_GOTPCRELX")
+
+#define JINGLE_RELOCS_386(X) \
+    X(R_386_NONE,          "NONE")           \
+    X(R_386_32,            "32")             \
+    X(R_386_PC32,          "PC32")           \
+    X(R_386_GOT32,         "GOT32")          \
+    X(R_386_PLT32,         "PLT32")          \
+    X(R_386_COPY,          "COPY")           \
+    X(R_386_GLOB_DAT,      "GLOB_DAT")       \
+    X(R_386_JMP_SLOT,      "JMP_SLOT")       \
+    X(R_386_RELATIVE,      "RELATIVE")       \
+    X(R_386_GOTOFF,        "GOTOFF")         \
+    X(R_386_GOTPC,         "GOTPC")          \
+    X(R_386_32PLT,         "32PLT")          \
+    X(R_386_TLS_TPOFF,     "TLS_TPOFF")      \
+    X(R_386_TLS_IE,        "TLS_IE")         \
+    X(R_386_TLS_GOTIE,     "TLS_GOTIE")      \
+    X(R_386_TLS_LE,        "TLS_LE")         \
+    X(R_386_TLS_GD,        "TLS_GD")         \
+    X(R_386_TLS_LDM,       "TLS_LDM")        \
+    X(R_386_16,            "16")             \
+    X(R_386_PC16,          "PC16")           \
+    X(R_386_8,             "8")              \
+    X(R_386_PC8,           "PC8")            \
+    X(R_386_TLS_GD_32,     "TLS_GD_32")      \
+    X(R_386_TLS_GD_PUSH,   "TLS_GD_PUSH")    \
+    X(R_386_TLS_GD_CALL,   "TLS_GD_CALL")    \
+    X(R_386_TLS_GD_POP,    "TLS_GD_POP")     \
+    X(R_386_TLS_LDM_32,    "TLS_LDM_32")     \
+    X(R_386_TLS_LDM_PUSH,  "TLS_LDM_PUSH")   \
+    X(R_386_TLS_LDM_CALL,  "TLS_LDM_CALL")   \
+    X(R_386_TLS_LDM_POP,   "TLS_LDM_POP")    \
+    X(R_386_TLS_LDO_32,    "TLS_LDO_32")     \
+    X(R_386_TLS_IE_32,     "TLS_IE_32")      \
+    X(R_386_TLS_LE_32,     "TLS_LE_32")      \
+    X(R_386_TLS_DTPMOD32,  "TLS_DTPMOD32")   \
+    X(R_386_TLS_DTPOFF32,  "TLS_DTPOFF32")   \
+    X(R_386_TLS_TPOFF32,   "TLS_TPOFF32")    \
+    X(R_386_SIZE32,        "SIZE32")         \
+    X(R_386_TLS_GOTDESC,   "TLS_GOTDESC")    \
+    X(R_386_TLS_DESC_CALL, "TLS_DESC_CALL")  \
+    X(R_386_TLS_DESC,      "TLS_DESC")       \
+    X(R_386_IRELATIVE,     "IRELATIVE")      \
+    X(R_386_GOT32X,        "GOT32X")
+
+#define JINGLE_RELOCS_AARCH64(X) \
+    X(R_AARCH64_NONE,                         "NONE")                          \
+    X(R_AARCH64_ABS64,                        "ABS64")                         \
+    X(R_AARCH64_ABS32,                        "ABS32")                         \
+    X(R_AARCH64_ABS16,                        "ABS16")                         \
+    X(R_AARCH64_PREL64,                       "PREL64")                        \
+    X(R_AARCH64_PREL32,                       "PREL32")                        \
+    X(R_AARCH64_PREL16,                       "PREL16")                        \
+    X(R_AARCH64_MOVW_UABS_G0,                 "MOVW_UABS_G0")                  \
+    X(R_AARCH64_MOVW_UABS_G0_NC,              "MOVW_UABS_G0_NC")               \
+    X(R_AARCH64_MOVW_UABS_G1,                 "MOVW_UABS_G1")                  \
+    X(R_AARCH64_MOVW_UABS_G1_NC,              "MOVW_UABS_G1_NC")               \
+    X(R_AARCH64_MOVW_UABS_G2,                 "MOVW_UABS_G2")                  \
+    X(R_AARCH64_MOVW_UABS_G2_NC,              "MOVW_UABS_G2_NC")               \
+    X(R_AARCH64_MOVW_UABS_G3,                 "MOVW_UABS_G3")                  \
+    X(R_AARCH64_MOVW_SABS_G0,                 "MOVW_SABS_G0")                  \
+    X(R_AARCH64_MOVW_SABS_G1,                 "MOVW_SABS_G1")                  \
+    X(R_AARCH64_MOVW_SABS_G2,                 "MOVW_SABS_G2")                  \
+    X(R_AARCH64_LD_PREL_LO19,                 "LD_PREL_LO19")                  \
+    X(R_AARCH64_ADR_PREL_LO21,                "ADR_PREL_LO21")                 \
+    X(R_AARCH64_ADR_PREL_PG_HI21,             "ADR_PREL_PG_HI21")              \
+    X(R_AARCH64_ADR_PREL_PG_HI21_NC,          "ADR_PREL_PG_HI21_NC")           \
+    X(R_AARCH64_ADD_ABS_LO12_NC,              "ADD_ABS_LO12_NC")               \
+    X(R_AARCH64_LDST8_ABS_LO12_NC,            "LDST8_ABS_LO12_NC")             \
+    X(R_AARCH64_TSTBR14,                      "TSTBR14")                       \
+    X(R_AARCH64_CONDBR19,                     "CONDBR19")                      \
+    X(R_AARCH64_JUMP26,                       "JUMP26")                        \
+    X(R_AARCH64_CALL26,                       "CALL26")                        \
+    X(R_AARCH64_LDST16_ABS_LO12_NC,           "LDST16_ABS_LO12_NC")            \
+    X(R_AARCH64_LDST32_ABS_LO12_NC,           "LDST32_ABS_LO12_NC")            \
+    X(R_AARCH64_LDST64_ABS_LO12_NC,           "LDST64_ABS_LO12_NC")            \
+    X(R_AARCH64_MOVW_PREL_G0,                 "MOVW_PREL_G0")                  \
+    X(R_AARCH64_MOVW_PREL_G0_NC,              "MOVW_PREL_G0_NC")               \
+    X(R_AARCH64_MOVW_PREL_G1,                 "MOVW_PREL_G1")                  \
+    X(R_AARCH64_MOVW_PREL_G1_NC,              "MOVW_PREL_G1_NC")               \
+    X(R_AARCH64_MOVW_PREL_G2,                 "MOVW_PREL_G2")                  \
+    X(R_AARCH64_MOVW_PREL_G2_NC,              "MOVW_PREL_G2_NC")               \
+    X(R_AARCH64_MOVW_PREL_G3,                 "MOVW_PREL_G3")                  \
+    X(R_AARCH64_LDST128_ABS_LO12_NC,          "LDST128_ABS_LO12_NC")           \
+    X(R_AARCH64_MOVW_GOTOFF_G0,               "MOVW_GOTOFF_G0")                \
+    X(R_AARCH64_MOVW_GOTOFF_G0_NC,            "MOVW_GOTOFF_G0_NC")             \
+    X(R_AARCH64_MOVW_GOTOFF_G1,               "MOVW_GOTOFF_G1")                \
+    X(R_AARCH64_MOVW_GOTOFF_G1_NC,            "MOVW_GOTOFF_G1_NC")             \
+    X(R_AARCH64_MOVW_GOTOFF_G2,               "MOVW_GOTOFF_G2")                \
+    X(R_AARCH64_MOVW_GOTOFF_G2_NC,            "MOVW_GOTOFF_G2_NC")             \
+    X(R_AARCH64_MOVW_GOTOFF_G3,               "MOVW_GOTOFF_G3")                \
+    X(R_AARCH64_GOTREL64,                     "GOTREL64")                      \
+    X(R_AARCH64_GOTREL32,                     "GOTREL32")                      \
+    X(R_AARCH64_GOT_LD_PREL19,                "GOT_LD_PREL19")                 \
+    X(R_AARCH64_LD64_GOTOFF_LO15,             "LD64_GOTOFF_LO15")              \
+    X(R_AARCH64_ADR_GOT_PAGE,                 "ADR_GOT_PAGE")                  \
+    X(R_AARCH64_LD64_GOT_LO12_NC,             "LD64_GOT_LO12_NC")              \
+    X(R_AARCH64_LD64_GOTPAGE_LO15,            "LD64_GOTPAGE_LO15")             \
+    X(R_AARCH64_TLSGD_ADR_PREL21,             "TLSGD_ADR_PREL21")              \
+    X(R_AARCH64_TLSGD_ADR_PAGE21,             "TLSGD_ADR_PAGE21")              \
+    X(R_AARCH64_TLSGD_ADD_LO12_NC,            "TLSGD_ADD_LO12_NC")             \
+    X(R_AARCH64_TLSGD_MOVW_G1,                "TLSGD_MOVW_G1")                 \
+    X(R_AARCH64_TLSGD_MOVW_G0_NC,             "TLSGD_MOVW_G0_NC")              \
+    X(R_AARCH64_TLSLD_ADR_PREL21,             "TLSLD_ADR_PREL21")              \
+    X(R_AARCH64_TLSLD_ADR_PAGE21,             "TLSLD_ADR_PAGE21")              \
+    X(R_AARCH64_TLSLD_ADD_LO12_NC,            "TLSLD_ADD_LO12_NC")             \
+    X(R_AARCH64_TLSLD_MOVW_G1,                "TLSLD_MOVW_G1")                 \
+    X(R_AARCH64_TLSLD_MOVW_G0_NC,             "TLSLD_MOVW_G0_NC")              \
+    X(R_AARCH64_TLSLD_LD_PREL19,              "TLSLD_LD_PREL19")               \
+    X(R_AARCH64_TLSLD_MOVW_DTPREL_G2,         "TLSLD_MOVW_DTPREL_G2")          \
+    X(R_AARCH64_TLSLD_MOVW_DTPREL_G1,         "TLSLD_MOVW_DTPREL_G1")          \
+    X(R_AARCH64_TLSLD_MOVW_DTPREL_G1_NC,      "TLSLD_MOVW_DTPREL_G1_NC")       \
+    X(R_AARCH64_TLSLD_MOVW_DTPREL_G0,         "TLSLD_MOVW_DTPREL_G0")          \
+    X(R_AARCH64_TLSLD_MOVW_DTPREL_G0_NC,      "TLSLD_MOVW_DTPREL_G0_NC")       \
+    X(R_AARCH64_TLSLD_ADD_DTPREL_HI12,        "TLSLD_ADD_DTPREL_HI12")         \
+    X(R_AARCH64_TLSLD_ADD_DTPREL_LO12,        "TLSLD_ADD_DTPREL_LO12")         \
+    X(R_AARCH64_TLSLD_ADD_DTPREL_LO12_NC,     "TLSLD_ADD_DTPREL_LO12_NC")      \
+    X(R_AARCH64_TLSLD_LDST8_DTPREL_LO12,      "TLSLD_LDST8_DTPREL_LO12")       \
+    X(R_AARCH64_TLSLD_LDST8_DTPREL_LO12_NC,   "TLSLD_LDST8_DTPREL_LO12_NC")    \
+    X(R_AARCH64_TLSLD_LDST16_DTPREL_LO12,     "TLSLD_LDST16_DTPREL_LO12")      \
+    X(R_AARCH64_TLSLD_LDST16_DTPREL_LO12_NC,  "TLSLD_LDST16_DTPREL_LO12_NC")   \
+    X(R_AARCH64_TLSLD_LDST32_DTPREL_LO12,     "TLSLD_LDST32_DTPREL_LO12")      \
+    X(R_AARCH64_TLSLD_LDST32_DTPREL_LO12_NC,  "TLSLD_LDST32_DTPREL_LO12_NC")   \
+    X(R_AARCH64_TLSLD_LDST64_DTPREL_LO12,     "TLSLD_LDST64_DTPREL_LO12")      \
+    X(R_AARCH64_TLSLD_LDST64_DTPREL_LO12_NC,  "TLSLD_LDST64_DTPREL_LO12_NC")   \
+    X(R_AARCH64_TLSIE_MOVW_GOTTPREL_G1,       "TLSIE_MOVW_GOTTPREL_G1")        \
+    X(R_AARCH64_TLSIE_MOVW_GOTTPREL_G0_NC,    "TLSIE_MOVW_GOTTPREL_G0_NC")     \
+    X(R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21,    "TLSIE_ADR_GOTTPREL_PAGE21")     \
+    X(R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC,  "TLSIE_LD64_GOTTPREL_LO12_NC")   \
+    X(R_AARCH64_TLSIE_LD_GOTTPREL_PREL19,     "TLSIE_LD_GOTTPREL_PREL19")      \
+    X(R_AARCH64_TLSLE_MOVW_TPREL_G2,          "TLSLE_MOVW_TPREL_G2")           \
+    X(R_AARCH64_TLSLE_MOVW_TPREL_G1,          "TLSLE_MOVW_TPREL_G1")           \
+    X(R_AARCH64_TLSLE_MOVW_TPREL_G1_NC,       "TLSLE_MOVW_TPREL_G1_NC")        \
+    X(R_AARCH64_TLSLE_MOVW_TPREL_G0,          "TLSLE_MOVW_TPREL_G0")           \
+    X(R_AARCH64_TLSLE_MOVW_TPREL_G0_NC,       "TLSLE_MOVW_TPREL_G0_NC")        \
+    X(R_AARCH64_TLSLE_ADD_TPREL_HI12,         "TLSLE_ADD_TPREL_HI12")          \
+    X(R_AARCH64_TLSLE_ADD_TPREL_LO12,         "TLSLE_ADD_TPREL_LO12")          \
+    X(R_AARCH64_TLSLE_ADD_TPREL_LO12_NC,      "TLSLE_ADD_TPREL_LO12_NC")       \
+    X(R_AARCH64_TLSLE_LDST8_TPREL_LO12,       "TLSLE_LDST8_TPREL_LO12")        \
+    X(R_AARCH64_TLSLE_LDST8_TPREL_LO12_NC,    "TLSLE_LDST8_TPREL_LO12_NC")     \
+    X(R_AARCH64_TLSLE_LDST16_TPREL_LO12,      "TLSLE_LDST16_TPREL_LO12")       \
+    X(R_AARCH64_TLSLE_LDST16_TPREL_LO12_NC,   "TLSLE_LDST16_TPREL_LO12_NC")    \
+    X(R_AARCH64_TLSLE_LDST32_TPREL_LO12,      "TLSLE_LDST32_TPREL_LO12")       \
+    X(R_AARCH64_TLSLE_LDST32_TPREL_LO12_NC,   "TLSLE_LDST32_TPREL_LO12_NC")    \
+    X(R_AARCH64_TLSLE_LDST64_TPREL_LO12,      "TLSLE_LDST64_TPREL_LO12")       \
+    X(R_AARCH64_TLSLE_LDST64_TPREL_LO12_NC,   "TLSLE_LDST64_TPREL_LO12_NC")    \
+    X(R_AARCH64_TLSDESC_LD_PREL19,            "TLSDESC_LD_PREL19")             \
+    X(R_AARCH64_TLSDESC_ADR_PREL21,           "TLSDESC_ADR_PREL21")            \
+    X(R_AARCH64_TLSDESC_ADR_PAGE21,           "TLSDESC_ADR_PAGE21")            \
+    X(R_AARCH64_TLSDESC_LD64_LO12,            "TLSDESC_LD64_LO12")             \
+    X(R_AARCH64_TLSDESC_ADD_LO12,             "TLSDESC_ADD_LO12")              \
+    X(R_AARCH64_TLSDESC_OFF_G1,               "TLSDESC_OFF_G1")                \
+    X(R_AARCH64_TLSDESC_OFF_G0_NC,            "TLSDESC_OFF_G0_NC")             \
+    X(R_AARCH64_TLSDESC_LDR,                  "TLSDESC_LDR")                   \
+    X(R_AARCH64_TLSDESC_ADD,                  "TLSDESC_ADD")                   \
+    X(R_AARCH64_TLSDESC_CALL,                 "TLSDESC_CALL")                  \
+    X(R_AARCH64_TLSLE_LDST128_TPREL_LO12,     "TLSLE_LDST128_TPREL_LO12")      \
+    X(R_AARCH64_TLSLE_LDST128_TPREL_LO12_NC,  "TLSLE_LDST128_TPREL_LO12_NC")   \
+    X(R_AARCH64_TLSLD_LDST128_DTPREL_LO12,    "TLSLD_LDST128_DTPREL_LO12")     \
+    X(R_AARCH64_TLSLD_LDST128_DTPREL_LO12_NC, "TLSLD_LDST128_DTPREL_LO12_NC")  \
+    X(R_AARCH64_COPY,                         "COPY")                          \
+    X(R_AARCH64_GLOB_DAT,                     "GLOB_DAT")                      \
+    X(R_AARCH64_JUMP_SLOT,                    "JUMP_SLOT")                     \
+    X(R_AARCH64_RELATIVE,                     "RELATIVE")                      \
+    X(R_AARCH64_TLS_DTPMOD,                   "TLS_DTPMOD")                    \
+    X(R_AARCH64_TLS_DTPREL,                   "TLS_DTPREL")                    \
+    X(R_AARCH64_TLS_TPREL,                    "TLS_TPREL")                     \
+    X(R_AARCH64_TLSDESC,                      "TLSDESC")                       \
+    X(R_AARCH64_IRELATIVE,                    "IRELATIVE")
+
+#define JINGLE_RELOC_DESC(type, name) \
+    [type] = { name },
+
+static const Jingle_Reloc_Desc JINGLE_RELOCS_X86_64_TABLE[]  = { JINGLE_RELOCS_X86_64(JINGLE_RELOC_DESC) };
+static const Jingle_Reloc_Desc JINGLE_RELOCS_386_TABLE[]     = { JINGLE_RELOCS_386(JINGLE_RELOC_DESC) };
+static const Jingle_Reloc_Desc JINGLE_RELOCS_AARCH64_TABLE[] = { JINGLE_RELOCS_AARCH64(JINGLE_RELOC_DESC) };
+
+#define JINGLE_RELOC_ARCH(machine, name, prefix, table) { machine, name, prefix, table, sizeof(table)/sizeof((table)[0]) }
+
+static const Jingle_Reloc_Arch JINGLE_RELOC_ARCHES[] = {
+    JINGLE_RELOC_ARCH(EM_X86_64,  "x86-64",  "R_X86_64_",  JINGLE_RELOCS_X86_64_TABLE),
+    JINGLE_RELOC_ARCH(EM_386,     "i386",    "R_386_",     JINGLE_RELOCS_386_TABLE),
+    JINGLE_RELOC_ARCH(EM_AARCH64, "AArch64", "R_AARCH64_", JINGLE_RELOCS_AARCH64_TABLE),
+};
+
+// For machines we have no table for: every type comes out as unknown
+static const Jingle_Reloc_Arch JINGLE_RELOC_ARCH_UNKNOWN = { EM_NONE, "unknown", "", NULL, 0 };
+static const Jingle_Reloc_Desc JINGLE_RELOC_DESC_UNKNOWN = { NULL };
+
+/// The descriptor table for e_machine. Look it up once per file, not once per relocation.
+const Jingle_Reloc_Arch *
+jingle_reloc_arch(uint16_t machine)
+{
+    for (size_t i = 0; i < sizeof(JINGLE_RELOC_ARCHES)/sizeof(JINGLE_RELOC_ARCHES[0]); ++i) {
+        if (JINGLE_RELOC_ARCHES[i].machine == machine) return &JINGLE_RELOC_ARCHES[i];
+    }
+    return &JINGLE_RELOC_ARCH_UNKNOWN;
+}
+
+/// Never NULL; types the architecture doesn't define get a descriptor with a NULL name.
+static inline const Jingle_Reloc_Desc *
+jingle_reloc_desc(const Jingle_Reloc_Arch *arch, uint32_t type)
+{
+    return type < arch->count ? &arch->descs[type] : &JINGLE_RELOC_DESC_UNKNOWN;
+}
+
+/// The name of a relocation type, or its number formatted into buf if the architecture doesn't define it.
+static inline const char *
+jingle_reloc_name(const Jingle_Reloc_Arch *arch, uint32_t type, char *buf, size_t size)
+{
+    const char *name = jingle_reloc_desc(arch, type)->name;
+    if (name != NULL) return name;
+    snprintf(buf, size, "<0x%x>", type);
+    return buf;
+}
+
+#endif // JINGLE_RELOC_C_
@@ -0,0 +1,373 @@
+#ifndef JINGLE_SCAN_C_
+#define JINGLE_SCAN_C_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <elf.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+#include "stb_ds.h"
+#include "jingle_parallel.c"
+
+/// Recursive ELF discovery.
+///
+/// Walking a build tree yields mostly sources, scripts and other non-ELF files, so instead of loading each file we
+/// only read its first 64 bytes (enough for a whole Elf64_Ehdr) and classify it from that. On Linux the
+/// open/read/close of a whole batch of files is pushed through io_uring, one io_uring_enter per step for the whole
+/// batch; everywhere else, or when io_uring is unavailable, the thread pool does plain open/pread/close.
+
+#define JINGLE_SNIFF_SIZE 64
+
+typedef struct {
+    char *path; // owned
+    bool is_elf;
+    unsigned char ei_class;
+    unsigned char ei_data;
+    uint16_t e_type;
+    uint16_t e_machine;
+} Jingle_Sniff;
+
+static uint16_t
+jingle_sniff_u16(const unsigned char *p, unsigned char ei_data)
+{
+    if (ei_data == ELFDATA2MSB) return (uint16_t)(p[0] << 8 | p[1]);
+    return (uint16_t)(p[1] << 8 | p[0]);
+}
+
+/// Classifies a file from its leading bytes. e_type and e_machine sit at the same offsets for both classes.
+void
+jingle_sniff_header(Jingle_Sniff *s, const unsigned char *buf, size_t n)
+{
+    s->is_elf = false;
+    if (n < EI_NIDENT + 4) return;
+    if (memcmp(buf, ELFMAG, SELFMAG) != 0) return;
+
+    s->ei_class = buf[EI_CLASS];
+    s->ei_data = buf[EI_DATA];
+    if (s->ei_class != ELFCLASS32 && s->ei_class != ELFCLASS64) return;
+    if (s->ei_data != ELFDATA2LSB && s->ei_data != ELFDATA2MSB) return;
+
+    s->e_type = jingle_sniff_u16(buf + offsetof(Elf64_Ehdr, e_type), s->ei_data);
+    s->e_machine = jingle_sniff_u16(buf + offsetof(Elf64_Ehdr, e_machine), s->ei_data);
+    s->is_elf = true;
+}
+
+/// Appends every regular file below dir to *paths (an stb_ds array of owned strings). Symlinks are not followed.
+void
+jingle_walk(const char *dir, char ***paths)
+{
+    char **stack = NULL;
+    arrput(stack, strdup(dir));
+
+    while (arrlen(stack) > 0) {
+        char *current = arrpop(stack);
+
+        DIR *d = opendir(current);
+        if (d == NULL) {
+            fprintf(stderr, "[WARN] Could not open directory '%s': %s\n", current, strerror(errno));
+            free(current);
+            continue;
+        }
+
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+
+            size_t len = strlen(current) + 1 + strlen(e->d_name) + 1;
+            char *path = malloc(len);
+            snprintf(path, len, "%s/%s", current, e->d_name);
+
+            unsigned char type = e->d_type;
+            if (type == DT_UNKNOWN) {
+                struct stat st;
+                if (lstat(path, &st) == 0) {
+                    if (S_ISDIR(st.st_mode)) type = DT_DIR;
+                    else if (S_ISREG(st.st_mode)) type = DT_REG;
+                }
+            }
+
+            if (type == DT_DIR) arrput(stack, path);
+            else if (type == DT_REG) arrput(*paths, path);
+            else free(path);
+        }
+
+        closedir(d);
+        free(current);
+    }
+
+    arrfree(stack);
+}
+
+/// Thread pool fallback
+
+static void
+jingle_sniff_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Jingle_Sniff *s = &((Jingle_Sniff *)ctx)[item];
+
+    int fd = open(s->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    unsigned char buf[JINGLE_SNIFF_SIZE];
+    ssize_t n = pread(fd, buf, sizeof(buf), 0);
+    close(fd);
+
+    if (n > 0) jingle_sniff_header(s, buf, n);
+}
+
+/// io_uring, driven through the raw system calls so there is no liburing dependency
+
+// The opcodes are an enum, so check for a feature bit from the same kernel release (5.6) as IORING_OP_OPENAT instead
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(IORING_FEAT_CUR_PERSONALITY)
+
+#define JINGLE_URING_ENTRIES 256
+
+typedef struct {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+} Jingle_Uring;
+
+static bool
+jingle_uring_init(Jingle_Uring *u, unsigned entries)
+{
+    struct io_uring_params p = {0};
+    *u = (Jingle_Uring){ .fd = -1 };
+
+    u->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (u->fd < 0) return false;
+
+    u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sq_ring == MAP_FAILED || u->cq_ring == MAP_FAILED || u->sqes == MAP_FAILED) {
+        if (u->sq_ring != MAP_FAILED) munmap(u->sq_ring, u->sq_ring_size);
+        if (u->cq_ring != MAP_FAILED) munmap(u->cq_ring, u->cq_ring_size);
+        if (u->sqes != MAP_FAILED) munmap(u->sqes, u->sqes_size);
+        close(u->fd);
+        u->fd = -1;
+        return false;
+    }
+
+    u->sq_tail  = (unsigned *)((char *)u->sq_ring + p.sq_off.tail);
+    u->sq_mask  = (unsigned *)((char *)u->sq_ring + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)((char *)u->sq_ring + p.sq_off.array);
+    u->cq_head  = (unsigned *)((char *)u->cq_ring + p.cq_off.head);
+    u->cq_tail  = (unsigned *)((char *)u->cq_ring + p.cq_off.tail);
+    u->cq_mask  = (unsigned *)((char *)u->cq_ring + p.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe *)((char *)u->cq_ring + p.cq_off.cqes);
+
+    return true;
+}
+
+static void
+jingle_uring_free(Jingle_Uring *u)
+{
+    munmap(u->sq_ring, u->sq_ring_size);
+    munmap(u->cq_ring, u->cq_ring_size);
+    munmap(u->sqes, u->sqes_size);
+    close(u->fd);
+}
+
+static struct io_uring_sqe *
+jingle_uring_sqe(Jingle_Uring *u, unsigned i)
+{
+    unsigned tail = *u->sq_tail + i;
+    unsigned index = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[index] = index;
+    return sqe;
+}
+
+/// Submits the n entries prepared with jingle_uring_sqe and waits for all of them. res[user_data] gets each result.
+/// The kernel may take fewer entries than it is given, so submitting goes on until all of them are in. If it stops
+/// taking any, whatever it did take is still waited for, so nothing is left writing into the caller's buffers, and
+/// false is returned; the entries it never took leave their res alone.
+static bool
+jingle_uring_run(Jingle_Uring *u, unsigned n, int *res)
+{
+    if (n == 0) return true;
+
+    __atomic_store_n(u->sq_tail, *u->sq_tail + n, __ATOMIC_RELEASE);
+
+    unsigned submitted = 0, done = 0;
+    bool stuck = false, busy = false;
+    for (;;) {
+        unsigned target = stuck ? submitted : n;
+        if (done == target) break;
+
+        // Submit what is left without waiting, since waiting for entries the kernel didn't take would never end. A
+        // busy kernel gets one completion's time first, if anything is in flight.
+        if (busy && submitted == done) busy = false;
+        unsigned pending = stuck || busy ? 0 : n - submitted;
+        unsigned wait = pending > 0 ? 0 : busy ? 1 : target - done;
+        busy = false;
+
+        int ret = syscall(__NR_io_uring_enter, u->fd, pending, wait, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                // nothing lost, go again
+            } else if ((errno == EAGAIN || errno == EBUSY) && submitted > done) {
+                busy = true;
+            } else if (submitted == done) {
+                return false;
+            } else {
+                stuck = true;
+            }
+        } else if (pending > 0) {
+            submitted += ret;
+            if (ret == 0) stuck = true;
+        }
+
+        unsigned head = *u->cq_head;
+        unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+            res[cqe->user_data] = cqe->res;
+            done++;
+        }
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return !stuck;
+}
+
+/// Sniffs every file with three batched steps per JINGLE_URING_ENTRIES files: open all, read all, close all.
+/// Returns false if io_uring is not usable here, in which case nothing was classified.
+static bool
+jingle_sniff_uring(Jingle_Sniff *files, size_t count)
+{
+    Jingle_Uring u;
+    if (!jingle_uring_init(&u, JINGLE_URING_ENTRIES)) return false;
+
+    unsigned char (*bufs)[JINGLE_SNIFF_SIZE] = malloc(JINGLE_URING_ENTRIES * JINGLE_SNIFF_SIZE);
+    int fds[JINGLE_URING_ENTRIES];
+    int res[JINGLE_URING_ENTRIES];
+
+    for (size_t base = 0; base < count; base += JINGLE_URING_ENTRIES) {
+        unsigned batch = count - base < JINGLE_URING_ENTRIES ? count - base : JINGLE_URING_ENTRIES;
+
+        for (unsigned i = 0; i < batch; ++i) {
+            fds[i] = -1;
+            struct io_uring_sqe *sqe = jingle_uring_sqe(&u, i);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uintptr_t)files[base + i].path;
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = i;
+        }
+        if (!jingle_uring_run(&u, batch, fds)) {
+            for (unsigned i = 0; i < batch; ++i) {
+                if (fds[i] >= 0) close(fds[i]);
+            }
+            goto fail;
+        }
+
+        // Kernels older than 5.6 don't know IORING_OP_OPENAT
+        if (base == 0 && fds[0] == -EINVAL) goto fail;
+
+        unsigned n = 0;
+        for (unsigned i = 0; i < batch; ++i) {
+            res[i] = 0;
+            if (fds[i] < 0) continue;
+            struct io_uring_sqe *sqe = jingle_uring_sqe(&u, n++);
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fds[i];
+            sqe->addr = (uintptr_t)bufs[i];
+            sqe->len = JINGLE_SNIFF_SIZE;
+            sqe->off = 0;
+            sqe->user_data = i;
+        }
+        if (!jingle_uring_run(&u, n, res)) {
+            for (unsigned i = 0; i < batch; ++i) {
+                if (fds[i] >= 0) close(fds[i]);
+            }
+            goto fail;
+        }
+
+        n = 0;
+        for (unsigned i = 0; i < batch; ++i) {
+            if (fds[i] < 0) continue;
+            if (res[i] > 0) jingle_sniff_header(&files[base + i], bufs[i], res[i]);
+
+            struct io_uring_sqe *sqe = jingle_uring_sqe(&u, n++);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = fds[i];
+            sqe->user_data = i;
+        }
+        if (!jingle_uring_run(&u, n, res)) goto fail;
+    }
+
+    free(bufs);
+    jingle_uring_free(&u);
+    return true;
+
+fail:
+    free(bufs);
+    jingle_uring_free(&u);
+    return false;
+}
+
+#else
+
+static bool
+jingle_sniff_uring(Jingle_Sniff *files, size_t count)
+{
+    (void)files;
+    (void)count;
+    return false;
+}
+
+#endif
+
+/// Walks dir and classifies every regular file below it. Returns an stb_ds array; free it with jingle_sniff_free.
+Jingle_Sniff *
+jingle_scan(const char *dir)
+{
+    char **paths = NULL;
+    jingle_walk(dir, &paths);
+
+    Jingle_Sniff *files = NULL;
+    arrsetlen(files, arrlen(paths));
+    for (size_t i = 0; i < (size_t)arrlen(paths); ++i) {
+        files[i] = (Jingle_Sniff){ .path = paths[i] };
+    }
+    arrfree(paths);
+
+    if (!jingle_sniff_uring(files, arrlen(files))) {
+        jingle_parallel_for(arrlen(files), jingle_sniff_task, files);
+    }
+
+    return files;
+}
+
+void
+jingle_sniff_free(Jingle_Sniff *files)
+{
+    for (size_t i = 0; i < (size_t)arrlen(files); ++i) free(files[i].path);
+    arrfree(files);
+}
+
+#endif // JINGLE_SCAN_C_
@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <elf.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JINGLE_HAS_AVX2_PATH
+#endif
+
+#include "string_t.c"
+#include "stb_ds.h"
+
+/// Fast substring search over raw blobs (string tables, section contents).
+///
+/// The SSE2 path compares the first and the last byte of the needle against 16 candidate positions at once and
+/// only runs a memcmp on positions where both agree, which for symbol names rejects nearly everything up front.
+
+static inline unsigned
+jingle_ctz(unsigned x)
+{
+    return __builtin_ctz(x);
+}
+
+const char *
+jingle_memmem(const char *hay, size_t n, const char *needle, size_t m)
+{
+    if (m == 0) return hay;
+    if (m > n) return NULL;
+    if (m == 1) return memchr(hay, needle[0], n);
+
+    size_t i = 0;
+    size_t last = n - m; // last valid start position
+
+#ifdef __SSE2__
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i final = _mm_set1_epi8(needle[m-1]);
+
+    for (; i + 16 <= last + 1; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + m - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, final)));
+        while (mask != 0) {
+            unsigned bit = jingle_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0) return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i <= last; ++i) {
+        const char *p = memchr(hay + i, needle[0], last - i + 1);
+        if (p == NULL) return NULL;
+        i = p - hay;
+        if (hay[i + m - 1] == needle[m-1] && memcmp(hay + i + 1, needle + 1, m - 2) == 0) return p;
+    }
+
+    return NULL;
+}
+
+/// Symbol name patterns
+///
+///   ^foo      anchored prefix
+///   *foo?bar  glob over the whole name (`*` and `?`)
+///   foo       plain substring
+
+typedef enum {
+    JINGLE_MATCH_SUBSTRING,
+    JINGLE_MATCH_PREFIX,
+    JINGLE_MATCH_GLOB,
+} Jingle_Match_Kind;
+
+typedef struct {
+    Jingle_Match_Kind kind;
+    const char *pattern;
+    const char *needle; // longest literal run of the pattern, used as the prefilter
+    size_t needle_len;
+} Jingle_Pattern;
+
+Jingle_Pattern
+jingle_pattern_compile(const char *pattern)
+{
+    Jingle_Pattern p = { .pattern = pattern };
+
+    if (pattern[0] == '^') {
+        p.kind = JINGLE_MATCH_PREFIX;
+        p.needle = pattern + 1;
+        p.needle_len = strlen(p.needle);
+    } else if (strpbrk(pattern, "*?") != NULL) {
+        p.kind = JINGLE_MATCH_GLOB;
+        for (const char *s = pattern; *s;) {
+            size_t n = strcspn(s, "*?");
+            if (n > p.needle_len) {
+                p.needle = s;
+                p.needle_len = n;
+            }
+            s += n;
+            if (*s) s++;
+        }
+    } else {
+        p.kind = JINGLE_MATCH_SUBSTRING;
+        p.needle = pattern;
+        p.needle_len = strlen(pattern);
+    }
+
+    return p;
+}
+
+bool
+jingle_glob_match(const char *glob, const char *name)
+{
+    const char *star = NULL;
+    const char *resume = NULL;
+
+    while (*name) {
+        if (*glob == '?' || (*glob != '*' && *glob == *name)) {
+            glob++;
+            name++;
+        } else if (*glob == '*') {
+            star = glob++;
+            resume = name;
+        } else if (star) {
+            glob = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+
+    while (*glob == '*') glob++;
+    return *glob == '\0';
+}
+
+/// Returns an stb_ds array with the indices of every symbol whose name matches.
+///
+/// The string table is scanned once for the literal part of the pattern. Every hit marks the string table offsets
+/// a matching name could start at (just the hit for prefixes, the hit and everything before it up to the previous
+/// NUL otherwise, since tail-merged names can start in the middle of another string). The symbol table is then
+/// walked with one byte load per entry, and only globs need to look at the candidate names.
+size_t *
+jingle_find_symbols(Jingle_Pattern *pat, Jingle_Symtab symtab)
+{
+    size_t *result = NULL;
+    if (symtab.count == 0 || symtab.names_count == 0) return result;
+
+    const char *names = symtab.names;
+    size_t n = symtab.names_count;
+    unsigned char *mark = NULL;
+
+    if (pat->needle_len > 0) {
+        mark = calloc(n, 1);
+        if (mark == NULL) {
+            fprintf(stderr, "[ERROR] Not enough memory to allocate %zu bytes\n", n);
+            exit(1);
+        }
+
+        size_t marked = 0; // everything below this is already marked
+        const char *hit = names;
+        while ((hit = jingle_memmem(hit, n - (hit - names), pat->needle, pat->needle_len)) != NULL) {
+            size_t at = hit - names;
+
+            if (pat->kind == JINGLE_MATCH_PREFIX) {
+                mark[at] = 1;
+            } else {
+                size_t start = at;
+                while (start > marked && names[start-1] != '\0') start--;
+                if (start < marked) start = marked;
+                memset(mark + start, 1, at - start + 1);
+                marked = at + 1;
+            }
+
+            hit++;
+        }
+    }
+
+    for (size_t i = 1; i < symtab.count; ++i) {
+        Elf64_Word st_name = symtab.data[i].st_name;
+        if (st_name == 0 || st_name >= n) continue;
+        if (mark != NULL && !mark[st_name]) continue;
+        if (pat->kind == JINGLE_MATCH_GLOB && !jingle_glob_match(pat->pattern, names + st_name)) continue;
+        arrput(result, i);
+    }
+
+    free(mark);
+    return result;
+}
+
+/// Byte patterns with wildcards, e.g. "0f 05" or "48 c7 c0 ?? ?? 00 00".
+///
+/// Searching picks two concrete bytes of the pattern (the first and the last one) and tests 32 positions at a time
+/// for both with AVX2, verifying the whole pattern only where both agree. CPUs without AVX2 fall back to a memchr
+/// driven scalar loop.
+
+typedef struct {
+    unsigned char *bytes; // wildcard positions are 0
+    unsigned char *mask;  // 0xff for concrete bytes, 0 for wildcards
+    size_t count;
+    size_t a, b;          // the two prefilter positions, a <= b
+} Jingle_Bytes_Pattern;
+
+static int
+jingle_hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/// Hex byte pairs, optionally separated by spaces, with ?? as a wildcard. At least one byte must be concrete.
+bool
+jingle_bytes_pattern_parse(Jingle_Bytes_Pattern *pat, const char *src)
+{
+    *pat = (Jingle_Bytes_Pattern){0};
+    bool found = false;
+
+    while (*src) {
+        if (*src == ' ') {
+            src++;
+            continue;
+        }
+        if (src[1] == '\0') goto fail;
+
+        unsigned char byte = 0, mask = 0;
+        if (src[0] == '?' && src[1] == '?') {
+            // wildcard
+        } else {
+            int hi = jingle_hex_digit(src[0]);
+            int lo = jingle_hex_digit(src[1]);
+            if (hi < 0 || lo < 0) goto fail;
+            byte = hi << 4 | lo;
+            mask = 0xff;
+
+            if (!found) pat->a = arrlen(pat->bytes);
+            pat->b = arrlen(pat->bytes);
+            found = true;
+        }
+
+        arrput(pat->bytes, byte);
+        arrput(pat->mask, mask);
+        src += 2;
+    }
+
+    if (!found) goto fail;
+    pat->count = arrlen(pat->bytes);
+    return true;
+
+fail:
+    arrfree(pat->bytes);
+    arrfree(pat->mask);
+    pat->count = 0;
+    return false;
+}
+
+void
+jingle_bytes_pattern_free(Jingle_Bytes_Pattern *pat)
+{
+    arrfree(pat->bytes);
+    arrfree(pat->mask);
+}
+
+static inline bool
+jingle_bytes_verify(Jingle_Bytes_Pattern *pat, const unsigned char *p)
+{
+    for (size_t j = 0; j < pat->count; ++j) {
+        if ((p[j] & pat->mask[j]) != pat->bytes[j]) return false;
+    }
+    return true;
+}
+
+/// Scalar search over start positions [i, last], appending hits to *hits.
+static void
+jingle_find_bytes_scalar(Jingle_Bytes_Pattern *pat, const unsigned char *data, size_t i, size_t last, size_t **hits)
+{
+    unsigned char first = pat->bytes[pat->a];
+
+    while (i <= last) {
+        const unsigned char *p = memchr(data + i + pat->a, first, last - i + 1);
+        if (p == NULL) return;
+        i = (p - data) - pat->a;
+        if (jingle_bytes_verify(pat, data + i)) arrput(*hits, i);
+        i++;
+    }
+}
+
+#ifdef JINGLE_HAS_AVX2_PATH
+__attribute__((target("avx2")))
+static size_t
+jingle_find_bytes_avx2(Jingle_Bytes_Pattern *pat, const unsigned char *data, size_t last, size_t **hits)
+{
+    __m256i va = _mm256_set1_epi8(pat->bytes[pat->a]);
+    __m256i vb = _mm256_set1_epi8(pat->bytes[pat->b]);
+
+    size_t i = 0;
+    for (; i + 32 <= last + 1; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(data + i + pat->a));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(data + i + pat->b));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(y, vb)));
+        while (mask != 0) {
+            size_t at = i + jingle_ctz(mask);
+            if (jingle_bytes_verify(pat, data + at)) arrput(*hits, at);
+            mask &= mask - 1;
+        }
+    }
+
+    return i;
+}
+#endif
+
+/// Returns an stb_ds array with the offset of every (possibly overlapping) match in data[0..n).
+size_t *
+jingle_find_bytes(Jingle_Bytes_Pattern *pat, const unsigned char *data, size_t n)
+{
+    size_t *hits = NULL;
+    if (pat->count == 0 || pat->count > n) return hits;
+
+    size_t last = n - pat->count;
+    size_t i = 0;
+
+#ifdef JINGLE_HAS_AVX2_PATH
+    if (__builtin_cpu_supports("avx2")) {
+        i = jingle_find_bytes_avx2(pat, data, last, &hits);
+    }
+#endif
+
+    jingle_find_bytes_scalar(pat, data, i, last, &hits);
+    return hits;
+}
@@ -0,0 +1,136 @@
+#ifndef JINGLE_SWAP_C_
+#define JINGLE_SWAP_C_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <elf.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JINGLE_HAS_SSSE3_PATH
+#endif
+
+/// Byte swapping whole ELF tables, for files whose byte order isn't the host's.
+///
+/// A table is an array of fixed-layout structs, described by the widths of their fields in order. The layout turns
+/// into a byte permutation that repeats every lcm(struct size, 16) bytes. With SSSE3 that is a handful of pshufb
+/// masks, and every 16 bytes of the table take one load, one shuffle and one store whatever the mix of field widths.
+/// Without SSSE3 the same permutation is applied a byte at a time.
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define JINGLE_HOST_DATA ELFDATA2LSB
+#else
+#define JINGLE_HOST_DATA ELFDATA2MSB
+#endif
+
+// Field widths in bytes, 0 terminated. The _32 and _64 suffixes let jingle_elfclass.c pick them with JN().
+static const unsigned char JINGLE_LAYOUT_EHDR_32[] = { 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 2,2,4,4,4,4,4,2,2,2,2,2,2, 0 };
+static const unsigned char JINGLE_LAYOUT_EHDR_64[] = { 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 2,2,4,8,8,8,4,2,2,2,2,2,2, 0 };
+static const unsigned char JINGLE_LAYOUT_SHDR_32[] = { 4,4,4,4,4,4,4,4,4,4, 0 };
+static const unsigned char JINGLE_LAYOUT_SHDR_64[] = { 4,4,8,8,8,8,4,4,8,8, 0 };
+static const unsigned char JINGLE_LAYOUT_SYM_32[]  = { 4,4,4,1,1,2, 0 };
+static const unsigned char JINGLE_LAYOUT_SYM_64[]  = { 4,1,1,2,8,8, 0 };
+static const unsigned char JINGLE_LAYOUT_REL_32[]  = { 4,4, 0 };
+static const unsigned char JINGLE_LAYOUT_REL_64[]  = { 8,8, 0 };
+static const unsigned char JINGLE_LAYOUT_RELA_32[] = { 4,4,4, 0 };
+static const unsigned char JINGLE_LAYOUT_RELA_64[] = { 8,8,8, 0 };
+static const unsigned char JINGLE_LAYOUT_CHDR_32[] = { 4,4,4, 0 };
+static const unsigned char JINGLE_LAYOUT_CHDR_64[] = { 4,4,8,8, 0 };
+
+#define JINGLE_SWAP_PERIOD_MAX 128
+
+typedef struct {
+    size_t size;   // of one struct
+    size_t period; // lcm(size, 16)
+    unsigned char perm[JINGLE_SWAP_PERIOD_MAX]; // byte k of the output comes from byte perm[k] of the input
+    bool simd;     // period is whole 16 byte chunks and no field crosses one, so each chunk is one pshufb
+} Jingle_Swap_Plan;
+
+static void
+jingle_swap_plan(Jingle_Swap_Plan *plan, const unsigned char *layout)
+{
+    plan->size = 0;
+    for (const unsigned char *w = layout; *w; ++w) plan->size += *w;
+
+    plan->period = plan->size;
+    while (plan->period % 16 != 0) plan->period += plan->size;
+    plan->simd = true;
+
+    // Only the odd-sized headers get here (Elf32_Ehdr repeats every 208 bytes), and there is only ever one of those
+    if (plan->period > JINGLE_SWAP_PERIOD_MAX) {
+        plan->period = plan->size;
+        plan->simd = false;
+    }
+    assert(plan->period <= JINGLE_SWAP_PERIOD_MAX);
+
+    for (size_t at = 0; at < plan->period;) {
+        for (const unsigned char *w = layout; *w; at += *w++) {
+            for (size_t j = 0; j < *w; ++j) plan->perm[at + j] = at + *w - 1 - j;
+            if (at / 16 != (at + *w - 1) / 16) plan->simd = false;
+        }
+    }
+}
+
+static void
+jingle_swap_scalar(unsigned char *dst, const unsigned char *src, size_t n, const Jingle_Swap_Plan *plan)
+{
+    // n is a whole number of structs, so a short last period still only reads inside it
+    for (size_t base = 0; base < n; base += plan->period) {
+        size_t m = n - base < plan->period ? n - base : plan->period;
+        for (size_t k = 0; k < m; ++k) dst[base + k] = src[base + plan->perm[k]];
+    }
+}
+
+#ifdef JINGLE_HAS_SSSE3_PATH
+/// Swaps whole periods and returns how many bytes were done.
+__attribute__((target("ssse3")))
+static size_t
+jingle_swap_ssse3(unsigned char *dst, const unsigned char *src, size_t n, const Jingle_Swap_Plan *plan)
+{
+    __m128i masks[JINGLE_SWAP_PERIOD_MAX / 16];
+    size_t chunks = plan->period / 16;
+    for (size_t c = 0; c < chunks; ++c) {
+        unsigned char m[16];
+        for (size_t k = 0; k < 16; ++k) m[k] = plan->perm[16*c + k] - 16*c;
+        masks[c] = _mm_loadu_si128((const __m128i *)m);
+    }
+
+    size_t done = 0;
+    while (n - done >= plan->period) {
+        for (size_t c = 0; c < chunks; ++c) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + done + 16*c));
+            _mm_storeu_si128((__m128i *)(dst + done + 16*c), _mm_shuffle_epi8(v, masks[c]));
+        }
+        done += plan->period;
+    }
+
+    return done;
+}
+#endif
+
+/// Copies count structs with the given layout from src to dst, reversing the bytes of every field. dst and src
+/// must not overlap.
+void
+jingle_swap_table(void *dst, const void *src, size_t count, const unsigned char *layout)
+{
+    Jingle_Swap_Plan plan;
+    jingle_swap_plan(&plan, layout);
+
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    size_t n = count * plan.size;
+    size_t done = 0;
+
+#ifdef JINGLE_HAS_SSSE3_PATH
+    if (plan.simd && __builtin_cpu_supports("ssse3")) {
+        done = jingle_swap_ssse3(d, s, n, &plan);
+    }
+#endif
+
+    jingle_swap_scalar(d + done, s + done, n - done, &plan);
+}
+
+#endif // JINGLE_SWAP_C_
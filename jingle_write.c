@@ -1,7 +1,15 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <elf.h>
 
 #include "string_t.c"
@@ -11,19 +19,35 @@ enum Jingle_Flags {
     JINGLE_HAS_GLOBAL = 1 << 0,
     JINGLE_HAS_SYMBOLS = 1 << 1,
     JINGLE_FINISHED = 1 << 2,
+    JINGLE_MERGE_STRINGS = 1 << 3, // set before jingle_fini to store names that end other names inside them
+    JINGLE_UNORDERED = 1 << 4,     // a local symbol came after a global one, jingle_fini has to reorder them
+    JINGLE_STREAMING = 1 << 5,     // section contents go straight to stream_fd, see jingle_stream
 };
 
 typedef Elf64_Section Jingle_Section;
 typedef Elf64_Word Jingle_Symbol;
 
+/// Where each distinct name already is in a string table, keyed by a hash of the name
+typedef struct {
+    uint64_t key;
+    Elf64_Word value;
+} Jingle_String_Index;
+
 typedef struct {
     Elf64_Ehdr header;
     Elf64_Shdr *sections;
     string_t section_names;
+    Jingle_String_Index *section_name_index;
     Elf64_Sym *symbols;
     string_t symbol_names;
-    Elf64_Rela *reloc_entries;
+    Jingle_String_Index *symbol_name_index;
+    Elf64_Rela *reloc_entries;   // the emitted relocation table, filled by jingle_fini
+    Elf64_Rela **section_relocs; // pending relocations, indexed by the section they apply to
+    Jingle_Section rela_target;  // where jingle_add_rela puts relocations
     string_t code;
+    int stream_fd;               // when JINGLE_STREAMING
+    int stream_errno;            // first write to stream_fd that failed, 0 if none did
+    size_t code_streamed;        // bytes of section contents already written to stream_fd
     uint16_t flags;
     Jingle_Symbol global_ndx;
 } Jingle;
@@ -35,7 +59,7 @@ typedef struct {
 
 #define JINGLE_EHDR 0
 #define JINGLE_CODE(j)     ((j)->header.e_ehsize)
-#define JINGLE_SYMTAB(j)   (JINGLE_CODE(j) + (j)->code.count)
+#define JINGLE_SYMTAB(j)   (JINGLE_CODE(j) + (j)->code_streamed + (j)->code.count)
 #define JINGLE_STRTAB(j)   (JINGLE_SYMTAB(j) + sizeof(Elf64_Sym) * arrlen((j)->symbols))
 #define JINGLE_RELATAB(j)  (JINGLE_STRTAB(j) + (j)->symbol_names.count)
 #define JINGLE_SHSTRTAB(j) (JINGLE_RELATAB(j) + sizeof(Elf64_Rela) * arrlen((j)->reloc_entries))
@@ -43,14 +67,35 @@ typedef struct {
 #define JINGLE_SHDRS(j)    (JINGLE_PHDRS(j) + (j)->header.e_phentsize * (j)->header.e_phnum)
 #define JINGLE_END(j)      (JINGLE_SHDRS(j) + (j)->header.e_shentsize * (j)->header.e_shnum)
 
+/// The offset of name in table, which only grows if the name isn't in it yet. Both tables start with the empty string.
+static Elf64_Word
+jingle_intern(string_t *table, Jingle_String_Index **index, const char *name, size_t length)
+{
+    if (length == 0) return 0;
+
+    uint64_t hash = stbds_hash_bytes((void *)name, length, 0);
+    ptrdiff_t found = hmgeti(*index, hash);
+    if (found >= 0) {
+        Elf64_Word at = (*index)[found].value;
+        if (at + length < table->count && table->data[at + length] == '\0' && memcmp(&table->data[at], name, length) == 0) {
+            return at;
+        }
+        // Two names with the same hash: the first one keeps the slot, this one is stored unshared
+    }
+
+    Elf64_Word at = appendn(table, (char *)name, length);
+    appendc(table, '\0');
+    if (found < 0) hmput(*index, hash, at);
+    return at;
+}
+
 Jingle_Section
 jingle_copy_section(Jingle *jingle, char *name, Elf64_Shdr s)
 {
     Jingle_Section result = arrlen(jingle->sections);
 
     if (name != NULL) {
-        s.sh_name = append(&jingle->section_names, name);
-        appendc(&jingle->section_names, '\0');
+        s.sh_name = jingle_intern(&jingle->section_names, &jingle->section_name_index, name, strlen(name));
     }
 
     arrput(jingle->sections, s);
@@ -65,43 +110,93 @@ jingle_add_section(Jingle *jingle, char *name, size_t type, uint64_t flags)
     return jingle_copy_section(jingle, name, s);
 }
 
+/// jingle_add_section for a name of known length, which needn't be NUL terminated
 Jingle_Section
-jingle_add_rela_section(Jingle *jingle, Jingle_Section section)
+jingle_add_section_n(Jingle *jingle, const char *name, size_t length, size_t type, uint64_t flags)
 {
-    // TODO: Make this array not add directly to the list of sections, but rather a temporary list which we resolve at the end.
+    Elf64_Shdr s = { .sh_type = type, .sh_flags = flags };
+    s.sh_name = jingle_intern(&jingle->section_names, &jingle->section_name_index, name, length);
 
+    Jingle_Section result = arrlen(jingle->sections);
+    arrput(jingle->sections, s);
+    return result;
+}
+
+/// Adds the .rela section for section. Optional: jingle_fini adds one for every section that has relocations but no
+/// .rela section yet. Also makes section the target of jingle_add_rela.
+Jingle_Section
+jingle_add_rela_section(Jingle *jingle, Jingle_Section section)
+{
     assert(jingle->flags & JINGLE_HAS_SYMBOLS);
 
     assert(section != 0);
 
+    jingle->rela_target = section;
+
+    // Offset, size and link are filled in by jingle_fini
     Elf64_Shdr s = {
         .sh_type = SHT_RELA,
         .sh_entsize = sizeof(Elf64_Rela),
         .sh_info = section,
-        .sh_offset = sizeof(Elf64_Rela) * arrlen(jingle->reloc_entries), // This gets patched during jingle_fini
     };
-    s.sh_name = append(&jingle->section_names, ".rela");
-    append(&jingle->section_names, &jingle->section_names.data[jingle->sections[section].sh_name]);
-    appendc(&jingle->section_names, '\0');
+    // Built outside section_names, which interning may move
+    const char *target = &jingle->section_names.data[jingle->sections[section].sh_name];
+    size_t length = strlen(target);
+    char *name = malloc(sizeof(".rela") + length);
+    memcpy(name, ".rela", sizeof(".rela") - 1);
+    memcpy(name + sizeof(".rela") - 1, target, length + 1);
+    s.sh_name = jingle_intern(&jingle->section_names, &jingle->section_name_index, name, sizeof(".rela") - 1 + length);
+    free(name);
 
     Jingle_Section result = arrlen(jingle->sections);
     arrput(jingle->sections, s);
     return result;
 }
 
+/// Writes all of data at offset, going on after a short write or EINTR. Returns false with errno set if it fails.
+static bool
+jingle_pwrite(int fd, const void *data, size_t size, off_t offset)
+{
+    const char *at = data;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, at, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) {
+            errno = EIO;
+            return false;
+        }
+        at += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
 void
 jingle_set_code(Jingle *jingle, Jingle_Section section, string_t code)
 {
+    if (jingle->flags & JINGLE_STREAMING) {
+        size_t offset = jingle->code_streamed;
+        if (jingle->stream_errno == 0 && !jingle_pwrite(jingle->stream_fd, code.data, code.count, JINGLE_CODE(jingle) + offset)) {
+            jingle->stream_errno = errno;
+        }
+        jingle->code_streamed += code.count;
+        jingle->sections[section].sh_offset = JINGLE_CODE(jingle) + offset;
+        jingle->sections[section].sh_size = code.count;
+        return;
+    }
+
     size_t offset = appendn(&jingle->code, code.data, code.count);
     jingle->sections[section].sh_offset = JINGLE_CODE(jingle) + offset;
     jingle->sections[section].sh_size = code.count;
 }
 
-Jingle_Symbol
-jingle_add_symbol(Jingle *jingle, Jingle_Section section, char *name, unsigned char info)
+static void
+jingle_start_symbols(Jingle *jingle)
 {
-    assert(!(jingle->flags & JINGLE_HAS_GLOBAL) && "Cannot add a local symbol after a global symbol has already been added");
-
     if (!(jingle->flags & JINGLE_HAS_SYMBOLS)) {
         jingle->flags |= JINGLE_HAS_SYMBOLS;
 
@@ -110,20 +205,70 @@ jingle_add_symbol(Jingle *jingle, Jingle_Section section, char *name, unsigned c
         arrput(jingle->symbols, symbol);
         appendc(&jingle->symbol_names, '\0');
     }
+}
+
+/// Keeps track of whether the symbols still have every local before the globals, as the symbol table needs
+static void
+jingle_note_binding(Jingle *jingle, unsigned char info)
+{
+    if (ELF64_ST_BIND(info) != STB_LOCAL) jingle->flags |= JINGLE_HAS_GLOBAL;
+    else if (jingle->flags & JINGLE_HAS_GLOBAL) jingle->flags |= JINGLE_UNORDERED;
+}
+
+/// jingle_add_symbol for a name of known length, which needn't be NUL terminated
+Jingle_Symbol
+jingle_add_symbol_n(Jingle *jingle, Jingle_Section section, const char *name, size_t length, unsigned char info)
+{
+    jingle_start_symbols(jingle);
+    jingle_note_binding(jingle, info);
 
     Jingle_Symbol result = arrlen(jingle->symbols);
 
     Elf64_Sym s = { .st_info = info, .st_other = STV_DEFAULT, .st_shndx = section };
-    if (name != NULL) {
-        s.st_name = append(&jingle->symbol_names, name);
-        appendc(&jingle->symbol_names, '\0');
-    }
+    s.st_name = jingle_intern(&jingle->symbol_names, &jingle->symbol_name_index, name, length);
 
     arrput(jingle->symbols, s);
 
     return result;
 }
 
+Jingle_Symbol
+jingle_add_symbol(Jingle *jingle, Jingle_Section section, char *name, unsigned char info)
+{
+    return jingle_add_symbol_n(jingle, section, name, name != NULL ? strlen(name) : 0, info);
+}
+
+typedef struct {
+    const char *name; // needn't be NUL terminated, NULL for none
+    size_t length;
+    unsigned char info;
+    Jingle_Section section;
+} Jingle_Symbol_Entry;
+
+/// Adds count symbols at once and returns the index of the first.
+Jingle_Symbol
+jingle_add_symbols(Jingle *jingle, const Jingle_Symbol_Entry *entries, size_t count)
+{
+    jingle_start_symbols(jingle);
+
+    Jingle_Symbol first = arrlen(jingle->symbols);
+    Elf64_Sym *out = arraddnptr(jingle->symbols, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        const Jingle_Symbol_Entry *e = &entries[i];
+        jingle_note_binding(jingle, e->info);
+
+        out[i] = (Elf64_Sym){
+            .st_name = jingle_intern(&jingle->symbol_names, &jingle->symbol_name_index, e->name, e->length),
+            .st_info = e->info,
+            .st_other = STV_DEFAULT,
+            .st_shndx = e->section,
+        };
+    }
+
+    return first;
+}
+
 Jingle_Symbol
 jingle_add_section_symbol(Jingle *jingle, Jingle_Section section)
 {
@@ -133,22 +278,228 @@ jingle_add_section_symbol(Jingle *jingle, Jingle_Section section)
 Jingle_Symbol
 jingle_add_global(Jingle *jingle, Jingle_Section section, char *name)
 {
-    Jingle_Symbol result = jingle_add_symbol(jingle, section, name, ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE));
+    return jingle_add_symbol(jingle, section, name, ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE));
+}
 
-    assert(jingle->flags & JINGLE_HAS_SYMBOLS);
+static Elf64_Rela **
+jingle_section_relocs(Jingle *jingle, Jingle_Section section)
+{
+    assert(!(jingle->flags & JINGLE_FINISHED));
+    assert(section != 0);
 
-    if (!(jingle->flags & JINGLE_HAS_GLOBAL)) {
-        jingle->flags |= JINGLE_HAS_GLOBAL;
-        jingle->global_ndx = result;
+    if (section >= arrlen(jingle->section_relocs)) {
+        size_t old = arrlen(jingle->section_relocs);
+        arrsetlen(jingle->section_relocs, section + 1);
+        memset(&jingle->section_relocs[old], 0, (section + 1 - old) * sizeof(jingle->section_relocs[0]));
     }
+    return &jingle->section_relocs[section];
+}
 
-    return result;
+/// Adds a relocation applying to section. Relocations can come in any order, for any mix of sections; jingle_fini
+/// groups them by section and sorts each group by r_offset.
+void
+jingle_add_rela_to(Jingle *jingle, Jingle_Section section, Elf64_Rela rela)
+{
+    arrput(*jingle_section_relocs(jingle, section), rela);
 }
 
+/// Adds count relocations applying to section, growing its buffer once.
+void
+jingle_add_relas_to(Jingle *jingle, Jingle_Section section, const Elf64_Rela *relas, size_t count)
+{
+    Elf64_Rela **relocs = jingle_section_relocs(jingle, section);
+    if (count > 0) memcpy(arraddnptr(*relocs, count), relas, count * sizeof(Elf64_Rela));
+}
+
+/// Adds a relocation applying to the section of the last jingle_add_rela_section.
 void
 jingle_add_rela(Jingle *jingle, Elf64_Rela rela)
 {
-    arrput(jingle->reloc_entries, rela);
+    assert(jingle->rela_target != 0 && "jingle_add_rela needs a jingle_add_rela_section first");
+    jingle_add_rela_to(jingle, jingle->rela_target, rela);
+}
+
+/// Stable LSD radix sort of n relocations by r_offset into dst, one byte per pass, skipping the bytes all the offsets
+/// share. src is used as scratch space along with tmp, both n entries.
+static void
+jingle_sort_relas(Elf64_Rela *dst, Elf64_Rela *src, Elf64_Rela *tmp, size_t n)
+{
+    uint64_t max = 0;
+    for (size_t i = 0; i < n; ++i) max |= src[i].r_offset;
+
+    size_t passes = 0;
+    while (passes < 8 && (max >> (8 * passes)) != 0) passes++;
+
+    Elf64_Rela *in = src;
+    for (size_t pass = 0; pass < passes && n > 1; ++pass) {
+        size_t shift = 8 * pass;
+        size_t count[256] = {0};
+        for (size_t i = 0; i < n; ++i) count[(in[i].r_offset >> shift) & 0xff]++;
+        if (count[(in[0].r_offset >> shift) & 0xff] == n) continue;
+
+        size_t at = 0;
+        for (size_t b = 0; b < 256; ++b) {
+            size_t c = count[b];
+            count[b] = at;
+            at += c;
+        }
+
+        Elf64_Rela *out = pass == passes - 1 ? dst : in == src ? tmp : src;
+        for (size_t i = 0; i < n; ++i) out[count[(in[i].r_offset >> shift) & 0xff]++] = in[i];
+        in = out;
+    }
+
+    if (in != dst && n > 0) memcpy(dst, in, n * sizeof(Elf64_Rela));
+}
+
+/// Symbols can be added in any order, but the symbol table needs every local before the first global. If they came
+/// mixed, a stable partition puts them in that order and the pending relocations get renumbered to match; any other
+/// Jingle_Symbol the caller kept from before jingle_fini still has the old numbering.
+static void
+jingle_fini_symbols(Jingle *jingle)
+{
+    size_t count = arrlen(jingle->symbols);
+    size_t locals = 0;
+    for (size_t i = 0; i < count; ++i) locals += ELF64_ST_BIND(jingle->symbols[i].st_info) == STB_LOCAL;
+
+    // sh_info of the symbol table: one past the last local
+    jingle->global_ndx = locals;
+
+    if (!(jingle->flags & JINGLE_UNORDERED)) return;
+
+    Elf64_Sym *sorted = malloc(count * sizeof(Elf64_Sym));
+    Elf64_Word *moved = malloc(count * sizeof(Elf64_Word));
+    size_t next_local = 0, next_global = locals;
+    for (size_t i = 0; i < count; ++i) {
+        moved[i] = ELF64_ST_BIND(jingle->symbols[i].st_info) == STB_LOCAL ? next_local++ : next_global++;
+        sorted[moved[i]] = jingle->symbols[i];
+    }
+    memcpy(jingle->symbols, sorted, count * sizeof(Elf64_Sym));
+
+    for (size_t t = 0; t < arrlen(jingle->section_relocs); ++t) {
+        Elf64_Rela *relocs = jingle->section_relocs[t];
+        for (size_t i = 0; i < arrlen(relocs); ++i) {
+            size_t sym = ELF64_R_SYM(relocs[i].r_info);
+            if (sym < count) relocs[i].r_info = ELF64_R_INFO(moved[sym], ELF64_R_TYPE(relocs[i].r_info));
+        }
+    }
+
+    jingle->flags &= ~JINGLE_UNORDERED;
+    free(sorted);
+    free(moved);
+}
+
+/// Lays out the relocation table: one .rela section per relocated section, in section order, each sorted by r_offset.
+/// The pending per-section buffers are consumed.
+static void
+jingle_fini_relocs(Jingle *jingle)
+{
+    size_t targets = arrlen(jingle->section_relocs);
+    bool *has_rela = calloc(targets + 1, sizeof(bool));
+
+    for (size_t i = 0; i < arrlen(jingle->sections); ++i) {
+        Elf64_Shdr *section = &jingle->sections[i];
+        if (section->sh_type == SHT_RELA && section->sh_info < targets) has_rela[section->sh_info] = true;
+    }
+    for (size_t t = 1; t < targets; ++t) {
+        if (arrlen(jingle->section_relocs[t]) > 0 && !has_rela[t]) jingle_add_rela_section(jingle, t);
+    }
+
+    size_t total = 0, most = 0;
+    for (size_t t = 0; t < targets; ++t) {
+        size_t n = arrlen(jingle->section_relocs[t]);
+        total += n;
+        if (n > most) most = n;
+    }
+
+    arrsetlen(jingle->reloc_entries, total);
+    Elf64_Rela *tmp = malloc(most * sizeof(Elf64_Rela) + 1);
+
+    // The symbol table comes right after the sections added so far
+    size_t symtab = arrlen(jingle->sections);
+    size_t at = 0;
+    for (size_t i = 0; i < arrlen(jingle->sections); ++i) {
+        Elf64_Shdr *section = &jingle->sections[i];
+        if (section->sh_type != SHT_RELA) continue;
+
+        Elf64_Rela *relocs = section->sh_info < targets ? jingle->section_relocs[section->sh_info] : NULL;
+        size_t n = arrlen(relocs);
+        jingle_sort_relas(&jingle->reloc_entries[at], relocs, tmp, n);
+
+        section->sh_link = symtab;
+        section->sh_offset = JINGLE_RELATAB(jingle) + at * sizeof(Elf64_Rela);
+        section->sh_size = n * sizeof(Elf64_Rela);
+        at += n;
+
+        // A second .rela section for the same target stays empty. The buffer keeps its memory for jingle_reset.
+        if (section->sh_info < targets) arrsetlen(jingle->section_relocs[section->sh_info], 0);
+    }
+
+    free(tmp);
+    free(has_rela);
+}
+
+typedef struct {
+    const char *name;
+    Elf64_Word length;
+    Elf64_Word offset;
+} Jingle_Tail;
+
+/// Orders names by their reversed text, so a name comes right after the longer names it ends
+static int
+jingle_tail_compare(const void *a, const void *b)
+{
+    const Jingle_Tail *x = a, *y = b;
+    size_t i = x->length, j = y->length;
+    while (i > 0 && j > 0) {
+        unsigned char c = x->name[--i], d = y->name[--j];
+        if (c != d) return c < d ? 1 : -1;
+    }
+    return (i == 0) - (j == 0);
+}
+
+/// Rebuilds table storing every name that ends another one inside it, ".text" as the tail of ".rela.text". Returns
+/// where each name moved, indexed by its old offset; the caller renames with it and frees it.
+static Elf64_Word *
+jingle_merge_tails(string_t *table)
+{
+    Jingle_Tail *names = NULL;
+    for (size_t at = 1; at < table->count;) {
+        size_t length = strlen(&table->data[at]);
+        if (length > 0) {
+            Jingle_Tail t = { &table->data[at], length, at };
+            arrput(names, t);
+        }
+        at += length + 1;
+    }
+
+    if (arrlen(names) > 1) qsort(names, arrlen(names), sizeof(names[0]), jingle_tail_compare);
+
+    Elf64_Word *moved = calloc(table->count + 1, sizeof(Elf64_Word));
+    string_t merged = {0};
+    appendc(&merged, '\0');
+
+    const Jingle_Tail *previous = NULL;
+    Elf64_Word previous_at = 0;
+    for (size_t i = 0; i < (size_t)arrlen(names); ++i) {
+        const Jingle_Tail *t = &names[i];
+        Elf64_Word at;
+        if (previous != NULL && previous->length >= t->length &&
+            memcmp(previous->name + previous->length - t->length, t->name, t->length) == 0) {
+            at = previous_at + previous->length - t->length;
+        } else {
+            at = appendn(&merged, (char *)t->name, t->length);
+            appendc(&merged, '\0');
+        }
+        moved[t->offset] = at;
+        previous = t;
+        previous_at = at;
+    }
+
+    arrfree(names);
+    string_free(table);
+    *table = merged;
+    return moved;
 }
 
 void
@@ -187,7 +538,359 @@ jingle_init(Jingle *jingle, uint16_t e_machine, unsigned char ei_osabi)
     // Add section header name table
     //jingle->SHSTRTAB = jingle_add_section(jingle, ".shstrtab", SHT_STRTAB, 0);
 
-    jingle->section_names.count++; // Add some padding so 0 is a null string
+    appendc(&jingle->section_names, '\0'); // So 0 is a null string
+}
+
+typedef struct {
+    size_t sections;              // not counting the ones jingle_fini adds
+    size_t section_names;         // bytes of section names, terminators not counted
+    size_t symbols;
+    size_t symbol_names;          // bytes of symbol names, terminators not counted
+    size_t relocs;
+    const size_t *section_relocs; // relocations applying to each section, indexed by section (sections + 1 of them),
+                                  // adding up to relocs. Optional.
+    size_t code;                  // bytes of section contents
+} Jingle_Sizes;
+
+/// Presizes the tables for an object of the given size, so adding its sections, symbols, relocations and contents
+/// doesn't reallocate. Counts are totals for the object, not additions to what is there. Without section_relocs the
+/// relocations still grow section by section, and the name indexes always grow as they go.
+void
+jingle_reserve(Jingle *jingle, Jingle_Sizes sizes)
+{
+    // Room for the null section, a .rela per section, .symtab, .strtab and .shstrtab
+    arrsetcap(jingle->sections, 2 * sizes.sections + 4);
+    arrsetcap(jingle->symbols, sizes.symbols + 1);
+    arrsetcap(jingle->reloc_entries, sizes.relocs);
+
+    if (sizes.section_relocs != NULL) {
+        for (size_t i = 1; i <= sizes.sections; ++i) {
+            if (sizes.section_relocs[i] > 0) arrsetcap(*jingle_section_relocs(jingle, i), sizes.section_relocs[i]);
+        }
+    }
+
+    // The string_t appends grow when they would fill the buffer, so one byte more than what goes in
+    size_t names = sizes.symbol_names + sizes.symbols + 2;
+    if (names > jingle->symbol_names.count) {
+        jingle->symbol_names.capacity = string_grow(&jingle->symbol_names, names - jingle->symbol_names.count, 0);
+    }
+
+    // Every name once for the section and once more after ".rela", then ".symtab", ".strtab" and ".shstrtab"
+    size_t section_names = 2 * sizes.section_names + (1 + 6) * sizes.sections + sizeof(".symtab.strtab.shstrtab") + 3;
+    if (section_names > jingle->section_names.count) {
+        jingle->section_names.capacity = string_grow(&jingle->section_names, section_names - jingle->section_names.count, 0);
+    }
+
+    if (sizes.code + 1 > jingle->code.count) {
+        jingle->code.capacity = string_grow(&jingle->code, sizes.code + 1 - jingle->code.count, 0);
+    }
+}
+
+/// Merging builders. Each thread can fill a builder of its own without any locking, and one jingle_merge at the end
+/// folds them all into one object, in a single pass over the output:
+///
+/// - Sections are matched by name, type and flags. A matched section gets the other builders' contents appended,
+///   each part aligned to its sh_addralign; the rest are added as new sections.
+/// - Symbols follow their sections, with values moved by where their part landed. Section symbols map to the section
+///   symbol of the merged section. Non-local symbols with the same name become one symbol, resolved the way the
+///   linker would: a definition replaces an undefined reference and a strong definition a weak one. Of two strong
+///   definitions the first is kept, and the second is reported.
+/// - Relocations are moved and renumbered the same way, and the names end up interned in into's string tables.
+/// - sh_link, and sh_info of SHF_INFO_LINK sections, are renumbered to the merged sections. Section groups can't be
+///   merged.
+
+typedef struct {
+    uint32_t from;          // which builder, 0 being into itself
+    Jingle_Section section; // in that builder
+    uint64_t base;          // where its contents start in the merged section
+} Jingle_Merge_Part;
+
+typedef struct {
+    char *key;
+    Jingle_Symbol value;
+} Jingle_Name_Map;
+
+/// The contents of a section, NULL if it has none in the file
+static const char *
+jingle_section_contents(Jingle *jingle, Jingle_Section section)
+{
+    Elf64_Shdr *sh = &jingle->sections[section];
+    if (sh->sh_type == SHT_NOBITS || sh->sh_size == 0 || sh->sh_offset < JINGLE_CODE(jingle)) return NULL;
+    return &jingle->code.data[sh->sh_offset - JINGLE_CODE(jingle)];
+}
+
+/// Merges count unfinished builders into into, which must not be finished either. They are left as they were. Call it
+/// once their contents are set: later jingle_set_code calls replace a section's merged contents.
+void
+jingle_merge(Jingle *into, Jingle *from, size_t count)
+{
+    assert(!(into->flags & (JINGLE_FINISHED | JINGLE_STREAMING)));
+
+    size_t sources = count + 1;
+    Jingle_Section **section_map = calloc(sources, sizeof(Jingle_Section *)); // [builder][section] -> into's section
+    uint64_t **section_base = calloc(sources, sizeof(uint64_t *));           // [builder][section] -> its offset there
+    Jingle_Merge_Part **parts = NULL;                                        // [into's section] -> what goes in it
+    uint64_t *sizes = NULL;                                                  // [into's section] -> merged size
+
+    Jingle_Name_Map *sections_by_name = NULL;
+    sh_new_arena(sections_by_name);
+
+    #define JINGLE_SOURCE(i) ((i) == 0 ? into : &from[(i) - 1])
+
+    // Sections: match, place and size every part
+    for (size_t i = 0; i < sources; ++i) {
+        Jingle *j = JINGLE_SOURCE(i);
+        assert(!(j->flags & (JINGLE_FINISHED | JINGLE_STREAMING)));
+
+        size_t n = arrlen(j->sections);
+        section_map[i] = calloc(n, sizeof(Jingle_Section));
+        section_base[i] = calloc(n, sizeof(uint64_t));
+
+        for (size_t k = 1; k < n; ++k) {
+            Elf64_Shdr *sh = &j->sections[k];
+            if (sh->sh_type == SHT_RELA) continue; // jingle_fini makes these from the relocations
+            assert(sh->sh_type != SHT_GROUP);       // their contents are section indices, which merging changes
+
+            const char *name = &j->section_names.data[sh->sh_name];
+            Jingle_Section target;
+            if (i == 0) {
+                target = k;
+            } else {
+                ptrdiff_t found = shgeti(sections_by_name, name);
+                if (found >= 0 && into->sections[sections_by_name[found].value].sh_type == sh->sh_type &&
+                    into->sections[sections_by_name[found].value].sh_flags == sh->sh_flags) {
+                    target = sections_by_name[found].value;
+                } else {
+                    target = jingle_add_section_n(into, name, strlen(name), sh->sh_type, sh->sh_flags);
+                    into->sections[target].sh_entsize = sh->sh_entsize;
+                }
+            }
+            if (shgeti(sections_by_name, name) < 0) shput(sections_by_name, name, target);
+
+            while ((size_t)arrlen(parts) <= target) {
+                arrput(parts, NULL);
+                arrput(sizes, 0);
+            }
+
+            uint64_t align = sh->sh_addralign > 1 ? sh->sh_addralign : 1;
+            uint64_t base = (sizes[target] + align - 1) / align * align;
+            if (align > into->sections[target].sh_addralign) into->sections[target].sh_addralign = align;
+            sizes[target] = base + sh->sh_size;
+
+            section_map[i][k] = target;
+            section_base[i][k] = base;
+            Jingle_Merge_Part part = { i, k, base };
+            arrput(parts[target], part);
+        }
+    }
+
+    // Links of the sections the others brought in, now that every section has its place. Matched sections keep the
+    // links they had in into.
+    for (size_t i = 1; i < sources; ++i) {
+        Jingle *j = JINGLE_SOURCE(i);
+        for (size_t k = 1; k < (size_t)arrlen(j->sections); ++k) {
+            Elf64_Shdr *sh = &j->sections[k];
+            Jingle_Section target = section_map[i][k];
+            if (target == 0 || arrlen(parts[target]) == 0 || parts[target][0].from != i || parts[target][0].section != k) continue;
+
+            if (sh->sh_link != 0 && sh->sh_link < arrlen(j->sections)) into->sections[target].sh_link = section_map[i][sh->sh_link];
+            if ((sh->sh_flags & SHF_INFO_LINK) && sh->sh_info != 0 && sh->sh_info < arrlen(j->sections)) {
+                into->sections[target].sh_info = section_map[i][sh->sh_info];
+            }
+        }
+    }
+
+    // Contents: one new buffer with every merged section in order, the gaps zero filled
+    uint64_t total = 0;
+    for (size_t t = 0; t < (size_t)arrlen(parts); ++t) {
+        if (into->sections[t].sh_type != SHT_NOBITS) total += sizes[t] + into->sections[t].sh_addralign;
+    }
+
+    string_t code = {0};
+    code.capacity = string_grow(&code, total + 1, 0);
+    for (size_t t = 1; t < (size_t)arrlen(parts); ++t) {
+        Elf64_Shdr *sh = &into->sections[t];
+        if (arrlen(parts[t]) == 0) continue;
+        if (sh->sh_type == SHT_NOBITS) {
+            sh->sh_size = sizes[t];
+            continue;
+        }
+
+        // Keep the section aligned within the file as well
+        uint64_t align = sh->sh_addralign > 1 ? sh->sh_addralign : 1;
+        while ((JINGLE_CODE(into) + code.count) % align != 0) code.data[code.count++] = 0;
+
+        size_t start = code.count;
+        for (size_t p = 0; p < (size_t)arrlen(parts[t]); ++p) {
+            Jingle_Merge_Part *part = &parts[t][p];
+            Jingle *j = JINGLE_SOURCE(part->from);
+            memset(&code.data[code.count], 0, start + part->base - code.count);
+            code.count = start + part->base;
+
+            const char *contents = jingle_section_contents(j, part->section);
+            size_t size = j->sections[part->section].sh_size;
+            if (contents != NULL) memcpy(&code.data[code.count], contents, size);
+            else memset(&code.data[code.count], 0, size);
+            code.count += size;
+        }
+
+        sh->sh_offset = JINGLE_CODE(into) + start;
+        sh->sh_size = sizes[t];
+    }
+    string_free(&into->code);
+    into->code = code;
+
+    // Symbols: into's own stay as they are, the others are added or resolved against them
+    Jingle_Section *section_symbols = calloc(arrlen(into->sections), sizeof(Jingle_Section)); // [section] -> its symbol
+    Jingle_Name_Map *globals = NULL;
+    sh_new_arena(globals);
+    for (size_t k = 1; k < (size_t)arrlen(into->symbols); ++k) {
+        Elf64_Sym *sym = &into->symbols[k];
+        if (ELF64_ST_TYPE(sym->st_info) == STT_SECTION && sym->st_shndx < arrlen(into->sections)) section_symbols[sym->st_shndx] = k;
+        else if (ELF64_ST_BIND(sym->st_info) != STB_LOCAL) shput(globals, &into->symbol_names.data[sym->st_name], k);
+    }
+
+    for (size_t i = 1; i < sources; ++i) {
+        Jingle *j = JINGLE_SOURCE(i);
+        size_t n = arrlen(j->symbols);
+        // One more than the symbols, so that symbol 0 has an entry even in a builder that has none
+        Jingle_Symbol *symbol_map = calloc(n + 1, sizeof(Jingle_Symbol));
+        int64_t *addend_shift = calloc(n + 1, sizeof(int64_t)); // for section symbols, where the part starts
+
+        for (size_t k = 1; k < n; ++k) {
+            Elf64_Sym sym = j->symbols[k];
+            const char *name = &j->symbol_names.data[sym.st_name];
+            bool in_section = sym.st_shndx != SHN_UNDEF && sym.st_shndx < SHN_LORESERVE && sym.st_shndx < arrlen(j->sections);
+
+            uint64_t base = 0;
+            if (in_section) {
+                base = section_base[i][sym.st_shndx];
+                sym.st_shndx = section_map[i][sym.st_shndx];
+            }
+
+            if (ELF64_ST_TYPE(sym.st_info) == STT_SECTION && in_section) {
+                if (section_symbols[sym.st_shndx] == 0) section_symbols[sym.st_shndx] = jingle_add_section_symbol(into, sym.st_shndx);
+                symbol_map[k] = section_symbols[sym.st_shndx];
+                addend_shift[k] = base;
+                continue;
+            }
+            if (in_section) sym.st_value += base;
+
+            if (ELF64_ST_BIND(sym.st_info) != STB_LOCAL && *name != '\0') {
+                ptrdiff_t found = shgeti(globals, name);
+                if (found >= 0) {
+                    Jingle_Symbol existing = globals[found].value;
+                    Elf64_Sym *have = &into->symbols[existing];
+                    bool have_defined = have->st_shndx != SHN_UNDEF, defined = sym.st_shndx != SHN_UNDEF;
+                    bool have_weak = ELF64_ST_BIND(have->st_info) == STB_WEAK, weak = ELF64_ST_BIND(sym.st_info) == STB_WEAK;
+
+                    // Like the linker: a definition beats a reference and a strong symbol beats a weak one
+                    if ((!have_defined && defined) || (have_defined == defined && have_weak && !weak)) {
+                        sym.st_name = have->st_name;
+                        *have = sym;
+                    } else if (have_defined && defined && !have_weak && !weak) {
+#ifndef JINGLE_NO_WARN
+                        printf("%s: '%s' is defined more than once, keeping the first definition\n", __FUNCTION__, name);
+#endif // JINGLE_NO_WARN
+                    }
+                    symbol_map[k] = existing;
+                    continue;
+                }
+            }
+
+            Jingle_Symbol added = jingle_add_symbol_n(into, sym.st_shndx, name, strlen(name), sym.st_info);
+            into->symbols[added].st_other = sym.st_other;
+            into->symbols[added].st_value = sym.st_value;
+            into->symbols[added].st_size = sym.st_size;
+            if (ELF64_ST_BIND(sym.st_info) != STB_LOCAL && *name != '\0') shput(globals, name, added);
+            symbol_map[k] = added;
+        }
+
+        // Relocations
+        for (size_t t = 1; t < (size_t)arrlen(j->section_relocs); ++t) {
+            size_t m = arrlen(j->section_relocs[t]);
+            if (m == 0) continue;
+            assert(t < arrlen(j->sections) && j->sections[t].sh_type != SHT_RELA);
+
+            Elf64_Rela *out = arraddnptr(*jingle_section_relocs(into, section_map[i][t]), m);
+            for (size_t r = 0; r < m; ++r) {
+                Elf64_Rela rela = j->section_relocs[t][r];
+                size_t sym = ELF64_R_SYM(rela.r_info);
+                assert(sym < n || sym == 0);
+                out[r] = (Elf64_Rela){
+                    .r_offset = rela.r_offset + section_base[i][t],
+                    .r_info = ELF64_R_INFO(symbol_map[sym], ELF64_R_TYPE(rela.r_info)),
+                    .r_addend = rela.r_addend + addend_shift[sym],
+                };
+            }
+        }
+
+        free(symbol_map);
+        free(addend_shift);
+    }
+
+    #undef JINGLE_SOURCE
+
+    for (size_t i = 0; i < sources; ++i) {
+        free(section_map[i]);
+        free(section_base[i]);
+    }
+    for (size_t t = 0; t < (size_t)arrlen(parts); ++t) arrfree(parts[t]);
+    arrfree(parts);
+    arrfree(sizes);
+    free(section_map);
+    free(section_base);
+    free(section_symbols);
+    shfree(sections_by_name);
+    shfree(globals);
+}
+
+/// Frees everything the builder owns and leaves it zeroed.
+void
+jingle_free(Jingle *jingle)
+{
+    arrfree(jingle->sections);
+    string_free(&jingle->section_names);
+    hmfree(jingle->section_name_index);
+    arrfree(jingle->symbols);
+    string_free(&jingle->symbol_names);
+    hmfree(jingle->symbol_name_index);
+    arrfree(jingle->reloc_entries);
+    for (size_t i = 0; i < arrlen(jingle->section_relocs); ++i) arrfree(jingle->section_relocs[i]);
+    arrfree(jingle->section_relocs);
+    string_free(&jingle->code);
+
+    *jingle = (Jingle){0};
+}
+
+/// Empties the builder for another object with the same machine and OS/ABI, finished or not, and ends streaming.
+/// Tables and buffers keep their memory, so a builder reused for objects of similar size stops allocating after the
+/// first few. Only the name indexes start over, stb_ds hash maps can't be emptied in place.
+void
+jingle_reset(Jingle *jingle)
+{
+    uint16_t machine = jingle->header.e_machine;
+    unsigned char osabi = jingle->header.e_ident[EI_OSABI];
+
+    arrsetlen(jingle->sections, 0);
+    jingle->section_names.count = 0;
+    hmfree(jingle->section_name_index);
+    arrsetlen(jingle->symbols, 0);
+    jingle->symbol_names.count = 0;
+    hmfree(jingle->symbol_name_index);
+    arrsetlen(jingle->reloc_entries, 0);
+    for (size_t i = 0; i < arrlen(jingle->section_relocs); ++i) arrsetlen(jingle->section_relocs[i], 0);
+    jingle->code.count = 0;
+
+    jingle->header = (Elf64_Ehdr){0};
+    jingle->flags = 0;
+    jingle->stream_fd = 0;
+    jingle->stream_errno = 0;
+    jingle->code_streamed = 0;
+    jingle->global_ndx = 0;
+    jingle->rela_target = 0;
+
+    jingle_init(jingle, machine, osabi);
 }
 
 void
@@ -211,33 +914,15 @@ jingle_fini(Jingle *jingle)
     }
 #endif // JINGLE_NO_WARN
 
-    Elf64_Shdr **rela_sections = NULL;
+    jingle_fini_symbols(jingle);
 
-    for (size_t i = 0; i < arrlen(jingle->sections); ++i) {
-        Elf64_Shdr *section = &jingle->sections[i];
-        if (section->sh_type == SHT_RELA) {
-            arrput(rela_sections, section);
-        }
+    if (jingle->flags & JINGLE_MERGE_STRINGS) {
+        Elf64_Word *moved = jingle_merge_tails(&jingle->symbol_names);
+        for (size_t i = 0; i < arrlen(jingle->symbols); ++i) jingle->symbols[i].st_name = moved[jingle->symbols[i].st_name];
+        free(moved);
     }
 
-    // We know the sections will be added in the correct order, because their offsets are incrementing, so we can just visit them linearly.
-    size_t last_offset = 0;
-    for (size_t i = 0; i < arrlen(rela_sections); ++i) {
-        Elf64_Shdr *section = rela_sections[i];
-
-        section->sh_link = arrlen(jingle->sections); // A reference to the associated symbol table
-
-        if (i > 0) {
-            jingle->sections[i-1].sh_size = section->sh_offset - last_offset;
-            last_offset = section->sh_offset;
-        }
-
-        section->sh_offset += JINGLE_RELATAB(jingle);
-
-        if (i == arrlen(rela_sections)-1) {
-            section->sh_size = JINGLE_SHSTRTAB(jingle) - section->sh_offset;
-        }
-    }
+    jingle_fini_relocs(jingle);
 
     // Add the symbol table
     if (jingle->flags & JINGLE_HAS_SYMBOLS) {
@@ -259,6 +944,11 @@ jingle_fini(Jingle *jingle)
 
     // Add the section names string table
     Jingle_Section shstrtab = jingle_add_section(jingle, ".shstrtab", SHT_STRTAB, 0);
+    if (jingle->flags & JINGLE_MERGE_STRINGS) {
+        Elf64_Word *moved = jingle_merge_tails(&jingle->section_names);
+        for (size_t i = 0; i < arrlen(jingle->sections); ++i) jingle->sections[i].sh_name = moved[jingle->sections[i].sh_name];
+        free(moved);
+    }
     jingle->sections[shstrtab].sh_offset = JINGLE_SHSTRTAB(jingle);
     jingle->sections[shstrtab].sh_size = jingle->section_names.count;
     jingle->header.e_shstrndx = shstrtab;
@@ -269,23 +959,277 @@ jingle_fini(Jingle *jingle)
     jingle->flags |= JINGLE_FINISHED;
 }
 
-void
+/// The most pieces a finished file is made of, see jingle_pieces
+#define JINGLE_PIECES_MAX 7
+
+/// Fills pieces with the parts of the finished file in order, pointing straight into the builder's arrays, and
+/// returns how many there are. Empty parts are left out. Their lengths add up to JINGLE_END.
+size_t
+jingle_pieces(Jingle *jingle, struct iovec pieces[JINGLE_PIECES_MAX])
+{
+    assert(jingle->flags & JINGLE_FINISHED);
+    assert(!(jingle->flags & JINGLE_STREAMING)); // the contents aren't in memory, jingle_stream_end writes the rest
+
+    struct iovec all[JINGLE_PIECES_MAX] = {
+        { &jingle->header, jingle->header.e_ehsize },
+        { jingle->code.data, jingle->code.count },
+        { jingle->symbols, sizeof(Elf64_Sym) * arrlen(jingle->symbols) },
+        { jingle->symbol_names.data, jingle->symbol_names.count },
+        { jingle->reloc_entries, sizeof(Elf64_Rela) * arrlen(jingle->reloc_entries) },
+        { jingle->section_names.data, jingle->section_names.count },
+        { jingle->sections, (size_t)jingle->header.e_shentsize * arrlen(jingle->sections) },
+    };
+
+    size_t count = 0, n = 0;
+    for (size_t i = 0; i < JINGLE_PIECES_MAX; ++i) {
+        if (all[i].iov_len == 0) continue;
+        pieces[count++] = all[i];
+        n += all[i].iov_len;
+    }
+
+    assert(n == JINGLE_END(jingle));
+    return count;
+}
+
+/// Receives the file one piece at a time, in order. Returning false stops the write.
+typedef bool (*Jingle_Sink)(void *ctx, const void *data, size_t size);
+
+/// Hands every piece of the file to sink. Returns false if the sink stopped it.
+bool
+jingle_write_sink(Jingle *jingle, Jingle_Sink sink, void *ctx)
+{
+    struct iovec pieces[JINGLE_PIECES_MAX];
+    size_t count = jingle_pieces(jingle, pieces);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!sink(ctx, pieces[i].iov_base, pieces[i].iov_len)) return false;
+    }
+    return true;
+}
+
+/// Copies the file into buffer, which must hold at least JINGLE_END bytes. Returns the number of bytes written, or
+/// 0 if the buffer is too small.
+size_t
+jingle_write_buffer(Jingle *jingle, void *buffer, size_t size)
+{
+    struct iovec pieces[JINGLE_PIECES_MAX];
+    size_t count = jingle_pieces(jingle, pieces);
+
+    size_t end = JINGLE_END(jingle);
+    if (size < end) return 0;
+
+    char *at = buffer;
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(at, pieces[i].iov_base, pieces[i].iov_len);
+        at += pieces[i].iov_len;
+    }
+    return end;
+}
+
+/// Appends the file to out, growing it once to fit. Returns the offset in out where the file starts.
+size_t
+jingle_write_string(Jingle *jingle, string_t *out)
+{
+    size_t start = out->count;
+    out->capacity = string_grow(out, JINGLE_END(jingle), 0);
+    out->count += jingle_write_buffer(jingle, out->data + start, out->capacity - start);
+    return start;
+}
+
+static bool
+jingle_stdio_sink(void *ctx, const void *data, size_t size)
+{
+    return fwrite(data, 1, size, ctx) == size;
+}
+
+/// Writes the file to stream. Returns false if fwrite came up short; errors stdio only notices when it flushes are
+/// for the caller's fflush or fclose to report.
+bool
 jingle_write(FILE *stream, Jingle *jingle)
 {
-    size_t n = 0;
+    return jingle_write_sink(jingle, jingle_stdio_sink, stream);
+}
 
-    n += fwrite(&jingle->header, jingle->header.e_ehsize, 1, stream) * jingle->header.e_ehsize;
-    n += fwrite(jingle->code.data, 1, jingle->code.count, stream);
+/// Writes the whole file with a single writev, bypassing stdio; only a short write or EINTR takes more calls.
+/// Returns false with errno set if the write fails.
+bool
+jingle_write_fd(int fd, Jingle *jingle)
+{
+    struct iovec pieces[JINGLE_PIECES_MAX];
+    size_t count = jingle_pieces(jingle, pieces);
+    struct iovec *at = pieces;
 
-    if (jingle->flags & JINGLE_HAS_SYMBOLS) {
-        n += fwrite(jingle->symbols, sizeof(Elf64_Sym), arrlen(jingle->symbols), stream) * sizeof(Elf64_Sym);
-        n += fwrite(jingle->symbol_names.data, 1, jingle->symbol_names.count, stream);
+    while (count > 0) {
+        ssize_t n = writev(fd, at, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) {
+            // Nothing went out and there is no error to say why: trying again would spin forever
+            errno = EIO;
+            return false;
+        }
+
+        // Skip over what made it out, part of a piece included
+        while (count > 0 && (size_t)n >= at->iov_len) {
+            n -= at->iov_len;
+            at++;
+            count--;
+        }
+        if (count > 0) {
+            at->iov_base = (char *)at->iov_base + n;
+            at->iov_len -= n;
+        }
     }
 
-    n += fwrite(jingle->reloc_entries, sizeof(Elf64_Rela), arrlen(jingle->reloc_entries), stream) * sizeof(Elf64_Rela);
+    return true;
+}
 
-    n += fwrite(jingle->section_names.data, 1, jingle->section_names.count, stream);
-    n += fwrite(jingle->sections, jingle->header.e_shentsize, arrlen(jingle->sections), stream) * jingle->header.e_shentsize;
+/// Creates or truncates path and writes the file to it: open, writev, close.
+bool
+jingle_write_file(const char *path, Jingle *jingle)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return false;
 
-    assert(n == JINGLE_END(jingle));
+    bool ok = jingle_write_fd(fd, jingle);
+    int saved = errno;
+    if (close(fd) != 0 && ok) return false;
+    errno = saved;
+    return ok;
+}
+
+/// Whether the file at path already holds exactly the finished object: same size, then the same bytes, compared
+/// against a read-only mapping piece by piece without serializing anything. Any error reading it counts as different.
+static bool
+jingle_file_matches(const char *path, Jingle *jingle)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    size_t end = JINGLE_END(jingle);
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size != end) {
+        close(fd);
+        return false;
+    }
+
+    void *mapped = mmap(NULL, end, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    struct iovec pieces[JINGLE_PIECES_MAX];
+    size_t count = jingle_pieces(jingle, pieces);
+
+    bool same = true;
+    const char *at = mapped;
+    for (size_t i = 0; i < count && same; ++i) {
+        same = memcmp(at, pieces[i].iov_base, pieces[i].iov_len) == 0;
+        at += pieces[i].iov_len;
+    }
+
+    munmap(mapped, end);
+    return same;
+}
+
+/// Like jingle_write_file, but leaves path alone, mtime included, when it already holds the same bytes, so whatever
+/// depends on it doesn't rebuild. Otherwise the file is written to a fresh mkstemp file next to it and renamed over
+/// it, so readers see the old file or the new one and never half of either, and concurrent writers of the same path
+/// never share a temporary. The new file keeps the old one's permissions, or gets 0666 less the umask if there was
+/// none. written, if not NULL, says which it was. Returns false with errno set if writing or renaming fails.
+bool
+jingle_write_file_if_changed(const char *path, Jingle *jingle, bool *written)
+{
+    if (written != NULL) *written = false;
+    if (jingle_file_matches(path, jingle)) return true;
+
+    struct stat st;
+    mode_t mode;
+    if (stat(path, &st) == 0) {
+        mode = st.st_mode & 07777;
+    } else {
+        // mkstemp makes the file 0600, and the umask can only be read by setting it
+        mode_t mask = umask(0);
+        umask(mask);
+        mode = 0666 & ~mask;
+    }
+
+    size_t length = strlen(path);
+    char *temporary = malloc(length + sizeof(".XXXXXX"));
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".XXXXXX", sizeof(".XXXXXX"));
+
+    int fd = mkstemp(temporary);
+    if (fd < 0) {
+        free(temporary);
+        return false;
+    }
+
+    bool ok = fchmod(fd, mode) == 0 && jingle_write_fd(fd, jingle);
+    int saved = errno;
+    if (close(fd) != 0 && ok) {
+        ok = false;
+        saved = errno;
+    }
+    if (ok && rename(temporary, path) != 0) {
+        ok = false;
+        saved = errno;
+    }
+    if (!ok) unlink(temporary);
+    free(temporary);
+    errno = saved;
+
+    if (ok && written != NULL) *written = true;
+    return ok;
+}
+
+/// Streaming. For objects too big to keep in memory: from here on jingle_set_code writes section contents to fd at
+/// their final offsets as soon as it gets them, and only the tables stay in the builder. Call it right after
+/// jingle_init, before any contents are set. fd must be open for writing and seekable; it stays the caller's.
+///
+/// After jingle_fini, jingle_stream_end writes the header and the tables that follow the contents. The other write
+/// functions don't work on a streaming builder, and neither does jingle_merge.
+void
+jingle_stream(Jingle *jingle, int fd)
+{
+    assert(!(jingle->flags & JINGLE_FINISHED));
+    assert(jingle->code.count == 0 && jingle->code_streamed == 0);
+
+    jingle->flags |= JINGLE_STREAMING;
+    jingle->stream_fd = fd;
+    jingle->stream_errno = 0;
+}
+
+/// Finishes a streamed file: writes the tables after the contents, then the header, and cuts the file to JINGLE_END
+/// in case it was longer. Returns false with errno set if this or any earlier write to the file failed.
+bool
+jingle_stream_end(Jingle *jingle)
+{
+    assert(jingle->flags & JINGLE_FINISHED);
+    assert(jingle->flags & JINGLE_STREAMING);
+
+    if (jingle->stream_errno != 0) {
+        errno = jingle->stream_errno;
+        return false;
+    }
+
+    struct iovec tables[] = {
+        { jingle->symbols, sizeof(Elf64_Sym) * arrlen(jingle->symbols) },
+        { jingle->symbol_names.data, jingle->symbol_names.count },
+        { jingle->reloc_entries, sizeof(Elf64_Rela) * arrlen(jingle->reloc_entries) },
+        { jingle->section_names.data, jingle->section_names.count },
+        { jingle->sections, (size_t)jingle->header.e_shentsize * arrlen(jingle->sections) },
+    };
+
+    off_t at = JINGLE_SYMTAB(jingle);
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); ++i) {
+        if (!jingle_pwrite(jingle->stream_fd, tables[i].iov_base, tables[i].iov_len, at)) return false;
+        at += tables[i].iov_len;
+    }
+    assert((size_t)at == JINGLE_END(jingle));
+
+    // The header goes last, so a file cut short by a failure before here isn't mistaken for a whole one
+    if (!jingle_pwrite(jingle->stream_fd, &jingle->header, jingle->header.e_ehsize, JINGLE_EHDR)) return false;
+    return ftruncate(jingle->stream_fd, at) == 0;
 }
@@ -1,5 +1,12 @@
 #include "jingle_read.c"
 #include "jingle_write.c"
+#include "jingle_parallel.c"
+#include "jingle_search.c"
+#include "jingle_scan.c"
+#include "jingle_hash.c"
+#include "jingle_buildid.c"
+#include "jingle_disasm.c"
+#include "jingle_binutils.c"
 
 #define STRING_T_IMPLEMENTATION
 #include "string_t.c"
@@ -72,25 +79,15 @@ test_jingle_write()
         .r_info = ELF64_R_INFO(data_section_symbol, R_X86_64_32S),
         .r_addend = 0,
     };
-    jingle_add_rela(&jingle, rela);
+    jingle_add_rela_to(&jingle, TEXT, rela);
 
     jingle_fini(&jingle);
 
-    FILE *f = fopen(OUTPUT_FILE, "w");
-    if (f == NULL) {
+    if (!jingle_write_file_if_changed(OUTPUT_FILE, &jingle, NULL)) {
         jingle_err_exit(__FUNCTION__, "Failed to write file `"OUTPUT_FILE"`");
     }
 
-    jingle_write(f, &jingle);
-    fclose(f);
-
-    string_free(&jingle.code);
-    string_free(&jingle.symbol_names);
-    string_free(&jingle.section_names);
-
-    arrfree(jingle.sections);
-    arrfree(jingle.symbols);
-    arrfree(jingle.reloc_entries);
+    jingle_free(&jingle);
 }
 
 void
@@ -100,6 +97,795 @@ usage(FILE *stream) {
     flag_print_options(stream);
 }
 
+typedef struct {
+    char **paths;
+    Jingle_Top *symbols;  // one per worker
+    Jingle_Top *sections; // one per worker
+} Top_Context;
+
+static void
+top_task(void *ctx, size_t worker, size_t item)
+{
+    Top_Context *c = ctx;
+
+    Jingle_File jf;
+    if (!jingle_open(&jf, c->paths[item])) return;
+
+    if (!jingle_verify(&jf)) {
+        fprintf(stderr, "[WARN] Skipping '%s': %s\n", jf.path, jf.error);
+    } else {
+        if (c->symbols)  jingle_top_symbols(&c->symbols[worker], &jf);
+        if (c->sections) jingle_top_sections(&c->sections[worker], &jf);
+    }
+
+    jingle_close(&jf);
+}
+
+static void
+print_top(Jingle_Top *top, const char *what, bool many_files)
+{
+    jingle_top_sort(top);
+
+    printf("\nTop %zu %s by size:\n", (size_t)arrlen(top->heap), what);
+    printf("        Size Name\n");
+    for (size_t i = 0; i < (size_t)arrlen(top->heap); ++i) {
+        Jingle_Top_Entry *e = &top->heap[i];
+        printf("[%2zu] %10lu %s", i, e->size, e->name);
+        if (many_files) printf(" (%s)", e->path);
+        printf("\n");
+    }
+}
+
+/// Collects the N largest symbols and/or sections over every input file, one heap per worker, merged at the end.
+static void
+display_top(char **paths, int count, size_t n, bool symbols, bool sections)
+{
+    size_t workers = jingle_worker_count(count);
+    Top_Context c = { .paths = paths };
+
+    if (symbols) {
+        c.symbols = calloc(workers, sizeof(Jingle_Top));
+        for (size_t i = 0; i < workers; ++i) c.symbols[i].limit = n;
+    }
+    if (sections) {
+        c.sections = calloc(workers, sizeof(Jingle_Top));
+        for (size_t i = 0; i < workers; ++i) c.sections[i].limit = n;
+    }
+
+    jingle_parallel_for(count, top_task, &c);
+
+    if (symbols) {
+        for (size_t i = 1; i < workers; ++i) jingle_top_merge(&c.symbols[0], &c.symbols[i]);
+        print_top(&c.symbols[0], "symbols", count > 1);
+        for (size_t i = 0; i < workers; ++i) jingle_top_free(&c.symbols[i]);
+        free(c.symbols);
+    }
+    if (sections) {
+        for (size_t i = 1; i < workers; ++i) jingle_top_merge(&c.sections[0], &c.sections[i]);
+        print_top(&c.sections[0], "sections", count > 1);
+        for (size_t i = 0; i < workers; ++i) jingle_top_free(&c.sections[i]);
+        free(c.sections);
+    }
+}
+
+typedef struct {
+    char **paths;
+    Jingle_Pattern pattern;
+    char **output; // one formatted report per input file, printed in order once every worker is done
+    size_t *output_len;
+} Name_Context;
+
+static void
+name_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Name_Context *c = ctx;
+
+    Jingle_File jf;
+    if (!jingle_open(&jf, c->paths[item])) return;
+
+    if (!jingle_verify(&jf)) {
+        fprintf(stderr, "[WARN] Skipping '%s': %s\n", jf.path, jf.error);
+        jingle_close(&jf);
+        return;
+    }
+
+    Jingle_Symtab symtab = jingle_read_symtab(&jf);
+    size_t *hits = jingle_find_symbols(&c->pattern, symtab);
+
+    if (arrlen(hits) > 0) {
+        FILE *out = open_memstream(&c->output[item], &c->output_len[item]);
+        fprintf(out, "\n%s: %zu matching symbols\n", jf.path, (size_t)arrlen(hits));
+        for (size_t i = 0; i < (size_t)arrlen(hits); ++i) {
+            Elf64_Sym *sym = &symtab.data[hits[i]];
+            fprintf(out, "[%2zu] ", hits[i]);
+            jingle_print_symbol(sym, out);
+            fprintf(out, "%s\n", &symtab.names[sym->st_name]);
+        }
+        fclose(out);
+    }
+
+    arrfree(hits);
+    jingle_close(&jf);
+}
+
+/// Lists the symbols matching a name pattern in every input file.
+static void
+display_name_matches(char **paths, int count, const char *pattern)
+{
+    Name_Context c = {
+        .paths = paths,
+        .pattern = jingle_pattern_compile(pattern),
+        .output = calloc(count, sizeof(char *)),
+        .output_len = calloc(count, sizeof(size_t)),
+    };
+
+    jingle_parallel_for(count, name_task, &c);
+
+    printf("        Value Size    Type   Bind       Vis    Ndx Name\n");
+    for (int i = 0; i < count; ++i) {
+        if (c.output[i] == NULL) continue;
+        fwrite(c.output[i], 1, c.output_len[i], stdout);
+        free(c.output[i]);
+    }
+
+    free(c.output);
+    free(c.output_len);
+}
+
+/// Byte pattern search. Inputs are handled in batches so a huge corpus never has all of its files open at once;
+/// within a batch every (file, section) pair is a separate work item.
+
+#define BYTES_BATCH 1024
+
+typedef struct {
+    uint32_t file;    // index into the batch
+    uint32_t section;
+    uint64_t offset;
+} Bytes_Hit;
+
+typedef struct {
+    Jingle_Bytes_Pattern *pattern;
+    Jingle_File *files;
+    bool *opened;
+    Bytes_Hit *items; // offset unused
+    Bytes_Hit **hits; // one array per worker
+} Bytes_Context;
+
+static void
+bytes_open_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Bytes_Context *c = ctx;
+    Jingle_File *jf = &c->files[item];
+
+    if (!jingle_open(jf, jf->path)) return;
+    if (!jingle_verify(jf)) {
+        fprintf(stderr, "[WARN] Skipping '%s': %s\n", jf->path, jf->error);
+        jingle_close(jf);
+        return;
+    }
+    c->opened[item] = true;
+}
+
+static void
+bytes_search_task(void *ctx, size_t worker, size_t item)
+{
+    Bytes_Context *c = ctx;
+    Bytes_Hit it = c->items[item];
+    string_t data = jingle_section_data(&c->files[it.file], it.section);
+
+    size_t *offsets = jingle_find_bytes(c->pattern, (unsigned char *)data.data, data.count);
+    for (size_t i = 0; i < (size_t)arrlen(offsets); ++i) {
+        Bytes_Hit hit = { .file = it.file, .section = it.section, .offset = offsets[i] };
+        arrput(c->hits[worker], hit);
+    }
+    arrfree(offsets);
+}
+
+static int
+bytes_hit_compare(const void *a, const void *b)
+{
+    const Bytes_Hit *x = a, *y = b;
+    if (x->file != y->file) return x->file < y->file ? -1 : 1;
+    if (x->section != y->section) return x->section < y->section ? -1 : 1;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    return 0;
+}
+
+static void
+display_bytes_matches(char **paths, int count, const char *pattern, Jingle_Section_Filter *filter)
+{
+    Jingle_Bytes_Pattern pat;
+    if (!jingle_bytes_pattern_parse(&pat, pattern)) {
+        fprintf(stderr, "[ERROR] Invalid byte pattern '%s' (expected hex bytes like \"0f 05\" with ?? wildcards)\n", pattern);
+        exit(1);
+    }
+
+    size_t total = 0;
+
+    for (int base = 0; base < count; base += BYTES_BATCH) {
+        size_t batch = count - base < BYTES_BATCH ? count - base : BYTES_BATCH;
+
+        Bytes_Context c = {
+            .pattern = &pat,
+            .files = calloc(batch, sizeof(Jingle_File)),
+            .opened = calloc(batch, sizeof(bool)),
+        };
+        for (size_t i = 0; i < batch; ++i) c.files[i].path = paths[base + i];
+
+        jingle_parallel_for(batch, bytes_open_task, &c);
+
+        for (size_t i = 0; i < batch; ++i) {
+            if (!c.opened[i]) continue;
+            Jingle_File *jf = &c.files[i];
+            for (size_t j = 0; j < jf->ehdr->e_shnum; ++j) {
+                Elf64_Shdr *sh = &jf->shdrs[j];
+                if (sh->sh_type == SHT_NULL || sh->sh_type == SHT_NOBITS) continue;
+                if (!jingle_section_filter_match(filter, sh)) continue;
+                Bytes_Hit it = { .file = i, .section = j };
+                arrput(c.items, it);
+            }
+        }
+
+        size_t workers = jingle_worker_count(arrlen(c.items));
+        c.hits = calloc(workers, sizeof(Bytes_Hit *));
+        jingle_parallel_for(arrlen(c.items), bytes_search_task, &c);
+
+        Bytes_Hit *hits = NULL;
+        for (size_t w = 0; w < workers; ++w) {
+            for (size_t i = 0; i < (size_t)arrlen(c.hits[w]); ++i) arrput(hits, c.hits[w][i]);
+            arrfree(c.hits[w]);
+        }
+        if (arrlen(hits) > 1) qsort(hits, arrlen(hits), sizeof(*hits), bytes_hit_compare);
+
+        Jingle_Label *labels = NULL;
+        for (size_t i = 0; i < (size_t)arrlen(hits); ++i) {
+            Bytes_Hit *h = &hits[i];
+            Jingle_File *jf = &c.files[h->file];
+            bool new_section = i == 0 || h->file != hits[i-1].file || h->section != hits[i-1].section;
+
+            if (new_section) {
+                arrfree(labels);
+                labels = jingle_section_labels(jf, jingle_read_symtab(jf), h->section);
+            }
+
+            string_t shstrtab = jingle_read_shstrtab(jf);
+            Elf64_Shdr *sh = &jf->shdrs[h->section];
+            printf("%s: [%2u] %s +0x%lx", jf->path, h->section, &shstrtab.data[sh->sh_name], h->offset);
+
+            Jingle_Label *l = jingle_nearest_label(labels, h->offset);
+            if (l) printf(" <%s+0x%lx>", l->name, h->offset - l->offset);
+            printf("\n");
+        }
+        arrfree(labels);
+        total += arrlen(hits);
+
+        for (size_t i = 0; i < batch; ++i) {
+            if (c.opened[i]) jingle_close(&c.files[i]);
+        }
+        arrfree(hits);
+        arrfree(c.items);
+        free(c.files);
+        free(c.opened);
+        free(c.hits);
+    }
+
+    printf("%zu matches\n", total);
+    jingle_bytes_pattern_free(&pat);
+}
+
+/// Duplicate content detection. Relocatable files leave the relocated fields zeroed, so the relocations that apply
+/// to a range (offset, type, target name, addend) are folded into its hash; otherwise every function calling a
+/// different external symbol through the same instruction sequence would look identical.
+
+typedef struct {
+    char **paths;
+    Jingle_Section_Filter *filter; // NULL means every allocated section
+    bool funcs;
+    Jingle_Dup_Table table;      // whole sections
+    Jingle_Dup_Table func_table; // functions, which lie inside the sections and so are counted apart from them
+} Dups_Context;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t type;
+    int64_t addend;
+    uint64_t name_hash;
+} Dups_Reloc;
+
+static int
+dups_reloc_compare(const void *a, const void *b)
+{
+    const Dups_Reloc *x = a, *y = b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    return 0;
+}
+
+/// Every relocation applying to section shndx, sorted by offset
+static Dups_Reloc *
+dups_section_relocs(Jingle_File *jf, const char **names, size_t names_count, size_t shndx)
+{
+    Dups_Reloc *relocs = NULL;
+
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
+        if (sh->sh_type != SHT_RELA || sh->sh_info != shndx || sh->sh_entsize == 0) continue;
+
+        Elf64_Rela *rela = jf->tables[i];
+        for (size_t j = 0; j < sh->sh_size / sh->sh_entsize; ++j) {
+            size_t sym = ELF64_R_SYM(rela[j].r_info);
+            const char *name = sym < names_count ? names[sym] : "";
+
+            Dups_Reloc r = {
+                .offset = rela[j].r_offset,
+                .type = ELF64_R_TYPE(rela[j].r_info),
+                .addend = rela[j].r_addend,
+                .name_hash = jingle_hash128(name, strlen(name), 0).lo,
+            };
+            arrput(relocs, r);
+        }
+    }
+
+    if (arrlen(relocs) > 1) qsort(relocs, arrlen(relocs), sizeof(*relocs), dups_reloc_compare);
+    return relocs;
+}
+
+static Jingle_Hash
+dups_hash_range(const char *data, uint64_t start, uint64_t size, Dups_Reloc *relocs)
+{
+    Jingle_Hash h = jingle_hash128(data + start, size, 0);
+
+    size_t lo = 0, hi = arrlen(relocs);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (relocs[mid].offset < start) lo = mid + 1;
+        else hi = mid;
+    }
+
+    size_t end = lo;
+    while (end < (size_t)arrlen(relocs) && relocs[end].offset < start + size) end++;
+    if (end == lo) return h;
+
+    // Rebase onto the range so identical functions at different offsets still match
+    Dups_Reloc *local = malloc((end - lo) * sizeof(*local));
+    for (size_t i = lo; i < end; ++i) {
+        local[i - lo] = relocs[i];
+        local[i - lo].offset -= start;
+    }
+    Jingle_Hash r = jingle_hash128(local, (end - lo) * sizeof(*local), h.lo);
+    free(local);
+
+    return (Jingle_Hash){ .lo = h.lo ^ r.lo, .hi = h.hi ^ r.hi };
+}
+
+static void
+dups_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Dups_Context *c = ctx;
+
+    Jingle_File jf;
+    if (!jingle_open(&jf, c->paths[item])) return;
+
+    if (!jingle_verify(&jf)) {
+        fprintf(stderr, "[WARN] Skipping '%s': %s\n", jf.path, jf.error);
+        jingle_close(&jf);
+        return;
+    }
+
+    string_t shstrtab = jingle_read_shstrtab(&jf);
+    Jingle_Symtab symtab = jingle_read_symtab(&jf);
+    Elf64_Ehdr *eh = jf.ehdr;
+    const char **names = eh->e_type == ET_REL ? jingle_symbol_names(&jf, shstrtab, symtab) : NULL;
+
+    for (size_t i = 1; i < eh->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf.shdrs[i];
+        if (sh->sh_type == SHT_NULL || sh->sh_type == SHT_NOBITS || sh->sh_size == 0) continue;
+        if (c->filter ? !jingle_section_filter_match(c->filter, sh) : !(sh->sh_flags & SHF_ALLOC)) continue;
+
+        string_t contents = jingle_section_data(&jf, i);
+        const char *data = contents.data;
+        Dups_Reloc *relocs = eh->e_type == ET_REL ? dups_section_relocs(&jf, names, symtab.count, i) : NULL;
+
+        jingle_dup_add(&c->table, dups_hash_range(data, 0, contents.count, relocs), contents.count, &shstrtab.data[sh->sh_name], jf.path);
+
+        if (c->funcs) {
+            for (size_t j = 1; j < symtab.count; ++j) {
+                Elf64_Sym *sym = &symtab.data[j];
+                if (sym->st_shndx != i || ELF64_ST_TYPE(sym->st_info) != STT_FUNC || sym->st_size == 0) continue;
+
+                uint64_t start = sym->st_value - sh->sh_addr;
+                if (start > contents.count || sym->st_size > contents.count - start) continue;
+                // A function filling its whole section is already covered by the section itself
+                if (start == 0 && sym->st_size == contents.count) continue;
+
+                jingle_dup_add(&c->func_table, dups_hash_range(data, start, sym->st_size, relocs), sym->st_size, &symtab.names[sym->st_name], jf.path);
+            }
+        }
+
+        arrfree(relocs);
+    }
+
+    free(names);
+    jingle_close(&jf);
+}
+
+/// Prints the groups of one table, the most wasteful first, under a line with their number and what they waste
+/// together
+static void
+dups_print_groups(Jingle_Dup_Table *table, const char *kind, const char *where, size_t limit)
+{
+    Jingle_Dup_Group *groups = jingle_dup_collect(table);
+
+    uint64_t wasted = 0;
+    for (size_t i = 0; i < (size_t)arrlen(groups); ++i) {
+        wasted += groups[i].size * (arrlen(groups[i].members) - 1);
+    }
+
+    printf("\n%zu duplicate %sgroups, %lu bytes wasted %s\n", (size_t)arrlen(groups), kind, wasted, where);
+
+    size_t shown = limit != 0 && limit < (size_t)arrlen(groups) ? limit : (size_t)arrlen(groups);
+    for (size_t i = 0; i < shown; ++i) {
+        Jingle_Dup_Group *g = &groups[i];
+        size_t copies = arrlen(g->members);
+        printf("[%2zu] %lu bytes x %zu copies, %lu bytes wasted (%016lx%016lx)\n", i, g->size, copies, g->size * (copies - 1), g->key.hi, g->key.lo);
+        for (size_t j = 0; j < copies; ++j) {
+            printf("       %s (%s)\n", g->members[j].name, g->members[j].path);
+        }
+    }
+
+    arrfree(groups);
+}
+
+static void
+display_dups(char **paths, int count, Jingle_Section_Filter *filter, bool funcs, size_t limit)
+{
+    Dups_Context c = { .paths = paths, .filter = filter, .funcs = funcs };
+    jingle_dup_init(&c.table);
+    jingle_dup_init(&c.func_table);
+
+    jingle_parallel_for(count, dups_task, &c);
+
+    // Function bytes are section bytes too, so functions get a total of their own rather than adding to this one
+    dups_print_groups(&c.table, "", "in total", limit);
+    if (funcs) dups_print_groups(&c.func_table, "function ", "in functions, already counted in the sections they are in", limit);
+
+    jingle_dup_free(&c.table);
+    jingle_dup_free(&c.func_table);
+}
+
+typedef struct {
+    char **paths;
+    Jingle_Build_Id *ids;
+    bool *found;
+} Build_Id_Context;
+
+static void
+build_id_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Build_Id_Context *c = ctx;
+    char *path = c->paths[item];
+
+    // Plain files only need a few headers read; archive members and compressed files have to go through the input
+    // layer, which hands them over whole
+    unsigned char magic[8] = {0};
+    ssize_t n = -1;
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        n = pread(fd, magic, sizeof(magic), 0);
+        close(fd);
+    }
+    if (n >= 0 && jingle_input_kind(magic, n) == JINGLE_INPUT_RAW) {
+        c->found[item] = jingle_read_build_id(path, &c->ids[item]);
+        return;
+    }
+
+    Jingle_File jf;
+    if (jingle_open(&jf, path)) c->found[item] = jingle_read_build_id_data(jf.file.data, jf.file.count, &c->ids[item]);
+    jingle_close(&jf);
+}
+
+/// Prints the build-id of every input and, when it can be found, the matching separate debug file.
+static void
+display_build_ids(char **paths, int count, const char *debug_dir, const char *cache_path)
+{
+    Build_Id_Context c = {
+        .paths = paths,
+        .ids = calloc(count, sizeof(Jingle_Build_Id)),
+        .found = calloc(count, sizeof(bool)),
+    };
+    jingle_parallel_for(count, build_id_task, &c);
+
+    Jingle_Debug_Cache cache;
+    jingle_debug_cache_load(&cache, debug_dir, cache_path);
+
+    for (int i = 0; i < count; ++i) {
+        if (!c.found[i]) {
+            printf("%s: no build-id\n", paths[i]);
+            continue;
+        }
+
+        char hex[2 * JINGLE_BUILD_ID_MAX + 1];
+        jingle_build_id_hex(&c.ids[i], hex);
+        const char *debug = jingle_debug_resolve(&cache, &c.ids[i]);
+        printf("%s: %s %s\n", paths[i], hex, debug ? debug : "(no debug file)");
+    }
+
+    if (!jingle_debug_cache_save(&cache)) {
+        fprintf(stderr, "[WARN] Could not write the build-id cache '%s'\n", cache_path);
+    }
+
+    jingle_debug_cache_free(&cache);
+    free(c.ids);
+    free(c.found);
+}
+
+/// Output formatted like the binutils tools. Every file is formatted by a worker into its own buffer and the buffers
+/// are printed in input order, with the per-file headers readelf and nm print for several files.
+
+typedef enum {
+    FORMAT_READELF,
+    FORMAT_NM,
+} Format_Kind;
+
+typedef struct {
+    char **paths;
+    Format_Kind kind;
+    bool header, sections, reloc, syms; // the readelf views
+    bool many_files;
+    char **output;
+    size_t *output_len;
+} Format_Context;
+
+static void
+format_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Format_Context *c = ctx;
+
+    Jingle_File jf;
+    if (!jingle_open(&jf, c->paths[item])) return;
+
+    if (!jingle_verify(&jf)) {
+        fprintf(stderr, "[WARN] Skipping '%s': %s\n", jf.path, jf.error);
+        jingle_close(&jf);
+        return;
+    }
+
+    FILE *out = open_memstream(&c->output[item], &c->output_len[item]);
+    if (c->kind == FORMAT_NM) {
+        if (c->many_files) fprintf(out, "%s:\n", jf.path);
+        if (!jingle_nm_posix(&jf, out)) fprintf(stderr, "nm: %s: no symbols\n", jf.path);
+    } else {
+        if (c->many_files) fprintf(out, "\nFile: %s\n", jf.path);
+        if (c->header)   jingle_readelf_header(&jf, out);
+        if (c->sections) jingle_readelf_sections(&jf, c->header, out);
+        if (c->reloc)    jingle_readelf_relocs(&jf, out);
+        if (c->syms)     jingle_readelf_symbols(&jf, out);
+    }
+    fclose(out);
+
+    jingle_close(&jf);
+}
+
+static void
+display_format(char **paths, int count, Format_Kind kind, bool header, bool sections, bool reloc, bool syms)
+{
+    Format_Context c = {
+        .paths = paths,
+        .kind = kind,
+        .header = header,
+        .sections = sections,
+        .reloc = reloc,
+        .syms = syms,
+        .many_files = count > 1,
+        .output = calloc(count, sizeof(char *)),
+        .output_len = calloc(count, sizeof(size_t)),
+    };
+
+    jingle_parallel_for(count, format_task, &c);
+
+    for (int i = 0; i < count; ++i) {
+        if (c.output[i] == NULL) continue;
+        fwrite(c.output[i], 1, c.output_len[i], stdout);
+        free(c.output[i]);
+    }
+
+    free(c.output);
+    free(c.output_len);
+}
+
+/// Disassembly of executable sections. A section is cut at its symbols, each piece starting on a known instruction
+/// boundary, so the pieces decode in parallel; their text is printed in order once every worker is done.
+
+typedef struct {
+    uint64_t offset;
+    uint32_t type;
+    int64_t addend;
+    bool has_addend;
+    const char *name;
+} Disasm_Reloc;
+
+typedef struct {
+    const unsigned char *data;
+    uint64_t size;
+    uint64_t address;     // what offset 0 disassembles as
+    Jingle_Label *labels;
+    uint64_t *starts;     // piece boundaries, sorted
+    Disasm_Reloc *relocs; // sorted by offset
+    const Jingle_Reloc_Arch *arch;
+    char **output;
+    size_t *output_len;
+} Disasm_Context;
+
+static int
+disasm_reloc_compare(const void *a, const void *b)
+{
+    const Disasm_Reloc *x = a, *y = b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    return 0;
+}
+
+/// Every relocation applying to section shndx, sorted by offset. Only relocatable files have any: elsewhere the
+/// code is already relocated and r_offset is an address.
+static Disasm_Reloc *
+disasm_section_relocs(Jingle_File *jf, const char **names, size_t names_count, size_t shndx)
+{
+    Disasm_Reloc *relocs = NULL;
+    if (jf->ehdr->e_type != ET_REL) return NULL;
+
+    for (size_t i = 0; i < jf->ehdr->e_shnum; ++i) {
+        Elf64_Shdr *sh = &jf->shdrs[i];
+        if ((sh->sh_type != SHT_RELA && sh->sh_type != SHT_REL) || sh->sh_info != shndx || sh->sh_entsize == 0) continue;
+
+        bool has_addend = sh->sh_type == SHT_RELA;
+        for (size_t j = 0; j < sh->sh_size / sh->sh_entsize; ++j) {
+            // Elf64_Rela starts with the same two fields as Elf64_Rel
+            Elf64_Rela *rela = (Elf64_Rela *)((char *)jf->tables[i] + j * (has_addend ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel)));
+            size_t sym = ELF64_R_SYM(rela->r_info);
+
+            Disasm_Reloc r = {
+                .offset = rela->r_offset,
+                .type = ELF64_R_TYPE(rela->r_info),
+                .addend = has_addend ? rela->r_addend : 0,
+                .has_addend = has_addend,
+                .name = sym < names_count ? names[sym] : "",
+            };
+            arrput(relocs, r);
+        }
+    }
+
+    if (arrlen(relocs) > 1) qsort(relocs, arrlen(relocs), sizeof(*relocs), disasm_reloc_compare);
+    return relocs;
+}
+
+static void
+disasm_task(void *ctx, size_t worker, size_t item)
+{
+    (void)worker;
+    Disasm_Context *c = ctx;
+
+    uint64_t start = c->starts[item];
+    uint64_t end = item + 1 < (size_t)arrlen(c->starts) ? c->starts[item + 1] : c->size;
+    FILE *out = open_memstream(&c->output[item], &c->output_len[item]);
+
+    // Labels are sorted by offset too, and several can share the piece's start
+    size_t label = 0, label_hi = arrlen(c->labels);
+    while (label < label_hi) {
+        size_t mid = label + (label_hi - label) / 2;
+        if (c->labels[mid].offset < start) label = mid + 1;
+        else label_hi = mid;
+    }
+    for (; label < (size_t)arrlen(c->labels) && c->labels[label].offset == start; ++label) {
+        fprintf(out, "\n%016lx <%s>:\n", c->address + start, c->labels[label].name);
+    }
+
+    size_t r = 0, hi = arrlen(c->relocs);
+    while (r < hi) {
+        size_t mid = r + (hi - r) / 2;
+        if (c->relocs[mid].offset < start) r = mid + 1;
+        else hi = mid;
+    }
+
+    for (uint64_t at = start; at < end;) {
+        Jingle_Insn insn;
+        jingle_disasm(c->data + at, end - at, c->address + at, &insn);
+
+        // At most 8 bytes on the instruction's line, the rest on the next one
+        size_t shown = insn.length < 8 ? insn.length : 8;
+        fprintf(out, "%8lx:\t", c->address + at);
+        for (size_t k = 0; k < 8; ++k) {
+            if (k < shown) fprintf(out, "%02x ", c->data[at + k]);
+            else fprintf(out, "   ");
+        }
+        fprintf(out, "\t%s", insn.text);
+
+        if (insn.has_target) {
+            Jingle_Label *l = NULL;
+            if (insn.target >= c->address && insn.target - c->address < c->size) {
+                l = jingle_nearest_label(c->labels, insn.target - c->address);
+            }
+            if (insn.target_is_rip) fprintf(out, "        # 0x%lx", insn.target);
+            if (l != NULL) {
+                uint64_t off = insn.target - c->address - l->offset;
+                if (off == 0) fprintf(out, " <%s>", l->name);
+                else fprintf(out, " <%s+0x%lx>", l->name, off);
+            }
+        }
+        fprintf(out, "\n");
+
+        if (insn.length > shown) {
+            fprintf(out, "%8lx:\t", c->address + at + shown);
+            for (size_t k = shown; k < insn.length; ++k) fprintf(out, "%02x ", c->data[at + k]);
+            fprintf(out, "\n");
+        }
+
+        for (; r < (size_t)arrlen(c->relocs) && c->relocs[r].offset < at + insn.length; ++r) {
+            Disasm_Reloc *rel = &c->relocs[r];
+            char buf[24];
+            const char *type = jingle_reloc_name(c->arch, rel->type, buf, sizeof(buf));
+            fprintf(out, "\t\t\t%lx: %s\t%s", rel->offset, type, rel->name);
+            if (rel->has_addend && rel->addend != 0) {
+                fprintf(out, "%c0x%lx", rel->addend < 0 ? '-' : '+', rel->addend < 0 ? (uint64_t)-rel->addend : (uint64_t)rel->addend);
+            }
+            fprintf(out, "\n");
+        }
+
+        at += insn.length;
+    }
+
+    fclose(out);
+}
+
+/// Prints section shndx of an x86-64 file as instructions, with its symbols as labels and, in relocatable files,
+/// the relocations applying to each instruction underneath it.
+static void
+print_disasm(Jingle_File *jf, size_t shndx, Jingle_Symtab symtab, const char **names)
+{
+    Elf64_Shdr *sh = &jf->shdrs[shndx];
+    string_t data = jingle_section_data(jf, shndx);
+
+    Disasm_Context c = {
+        .data = (const unsigned char *)data.data,
+        .size = data.count,
+        .address = sh->sh_addr,
+        .labels = jingle_section_labels(jf, symtab, shndx),
+        .relocs = disasm_section_relocs(jf, names, symtab.count, shndx),
+        .arch = jingle_reloc_arch(jf->ehdr->e_machine),
+    };
+
+    arrput(c.starts, 0);
+    for (size_t i = 0; i < (size_t)arrlen(c.labels); ++i) {
+        uint64_t offset = c.labels[i].offset;
+        if (offset < c.size && offset != arrlast(c.starts)) arrput(c.starts, offset);
+    }
+
+    size_t count = arrlen(c.starts);
+    c.output = calloc(count, sizeof(char *));
+    c.output_len = calloc(count, sizeof(size_t));
+    jingle_parallel_for(count, disasm_task, &c);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (c.output[i] == NULL) continue;
+        fwrite(c.output[i], 1, c.output_len[i], stdout);
+        free(c.output[i]);
+    }
+
+    free(c.output);
+    free(c.output_len);
+    arrfree(c.starts);
+    arrfree(c.relocs);
+    arrfree(c.labels);
+}
+
+static const char *
+sniff_type_name(uint16_t e_type)
+{
+    return e_type < ET_NUM ? ET_NAMES[e_type] : "(unknown)";
+}
+
 void
 test_jingle_read(int argc, char **argv)
 {
@@ -108,6 +894,20 @@ test_jingle_read(int argc, char **argv)
     bool *display_sections = flag_bool("-sections", false, "Display the section headers");
     uint64_t *display_contents = flag_uint64("-contents", 0, "Display the contents of a section");
     bool *display_reloc = flag_bool("-reloc", false, "Display the relocation entries");
+    bool *display_disasm = flag_bool("-disasm", false, "Disassemble the executable sections (x86-64 only)");
+    uint64_t *top_n = flag_uint64("-top", 0, "Only display the N largest symbols (with -syms) and/or sections (with -sections) over all input files");
+    char **name_pattern = flag_str("-name", NULL, "Only display symbols whose name matches PATTERN (substring, ^prefix or *glob?) over all input files");
+    char **bytes_pattern = flag_str("-bytes", NULL, "Search the contents of every section for a hex byte pattern with ?? wildcards, e.g. \"0f 05\"");
+    char **section_type = flag_str("-section-type", NULL, "Only search or compare sections of this type (e.g. PROGBITS)");
+    char **section_flags = flag_str("-section-flags", NULL, "Only search or compare sections with all of these flags set (W, A, X)");
+    bool *dups = flag_bool("-dups", false, "Find sections with identical content over all input files (combine with -top N to limit the groups shown)");
+    bool *dups_funcs = flag_bool("-dups-funcs", false, "With -dups, also compare the bodies of individual functions");
+    bool *build_id = flag_bool("-build-id", false, "Display the GNU build-id of every input file and the separate debug file it resolves to");
+    char **debug_dir = flag_str("-debug-dir", "/usr/lib/debug", "Where -build-id looks for separate debug files");
+    char **debug_cache = flag_str("-debug-cache", NULL, "File remembering build-id to debug file resolutions between runs");
+    char **scan_dir = flag_str("-scan", NULL, "Recursively find the ELF files under a directory and use them as the input files");
+    char **format = flag_str("-format", NULL, "Print like binutils: \"readelf\" (readelf -W, for the views picked with -header, -sections, -reloc and -syms) or \"nm\" (nm -P)");
+    uint64_t *threads = flag_uint64("-threads", 0, "Number of worker threads for multi-file modes (0 = one per CPU)");
 
     if (!flag_parse(argc, argv)) {
         usage(stderr);
@@ -118,100 +918,208 @@ test_jingle_read(int argc, char **argv)
     int rest_argc = flag_rest_argc();
     char **rest_argv = flag_rest_argv();
 
+    jingle_threads = *threads;
+
+    Jingle_Sniff *scanned = NULL;
+    char **elf_paths = NULL;
+    if (*scan_dir != NULL) {
+        scanned = jingle_scan(*scan_dir);
+        for (size_t i = 0; i < (size_t)arrlen(scanned); ++i) {
+            if (scanned[i].is_elf) arrput(elf_paths, scanned[i].path);
+        }
+        fprintf(stderr, "[INFO] Scanned %zu files under '%s', %zu are ELF\n", (size_t)arrlen(scanned), *scan_dir, (size_t)arrlen(elf_paths));
+
+        bool any_mode = *display_symtab || *display_file_header || *display_sections || *display_contents || *display_reloc || *display_disasm || *top_n || *name_pattern || *bytes_pattern || *dups || *build_id || *format;
+        if (!any_mode) {
+            printf("Class Data Type                   Machine Path\n");
+            for (size_t i = 0; i < (size_t)arrlen(scanned); ++i) {
+                Jingle_Sniff *s = &scanned[i];
+                if (!s->is_elf) continue;
+                printf("%-5s %-4s %-22s %7u %s\n", EI_CLASS_NAMES[s->ei_class], s->ei_data == ELFDATA2LSB ? "LSB" : "MSB", sniff_type_name(s->e_type), s->e_machine, s->path);
+            }
+            return;
+        }
+
+        rest_argv = elf_paths;
+        rest_argc = arrlen(elf_paths);
+    }
+
     if (rest_argc <= 0) {
         usage(stderr);
         fprintf(stderr, "[ERROR] No input files provided\n");
         exit(1);
     }
 
-    char *input_file = rest_argv[0];
-
-    FILE *f = fopen(input_file, "r");
-    if (!f) {
-        fprintf(stderr, "[ERROR] Could not open file '%s'\n", input_file);
+    // Static libraries stand for their members from here on
+    char **inputs = jingle_expand_archives(rest_argv, rest_argc);
+    rest_argv = inputs;
+    rest_argc = arrlen(inputs);
+    if (rest_argc <= 0) {
+        fprintf(stderr, "[ERROR] No input files left after expanding archives\n");
         exit(1);
     }
 
-    string_t file = string_from_file(f);
-    printf("[INFO] Read %zu bytes from '%s'\n", file.count, input_file);
+    if (*build_id) {
+        display_build_ids(rest_argv, rest_argc, *debug_dir, *debug_cache);
+        return;
+    }
 
-    if (!jingle_is_elf(file)) {
-        fprintf(stderr, "[ERROR] '%s' is not a valid ELF file (doesn't start with magic number 0x7f E L F)\n", input_file);
-        exit(1);
+    if (*dups) {
+        Jingle_Section_Filter filter;
+        if (!jingle_section_filter_parse(&filter, *section_type, *section_flags)) {
+            fprintf(stderr, "[ERROR] Invalid section filter\n");
+            exit(1);
+        }
+        bool filtered = *section_type != NULL || *section_flags != NULL;
+        display_dups(rest_argv, rest_argc, filtered ? &filter : NULL, *dups_funcs, *top_n);
+        return;
     }
 
-    // TODO: 32 bits
-    if ((unsigned char)file.data[EI_CLASS] != ELFCLASS64) {
-        fprintf(stderr, "[ERROR] We don't know how to handle 32 bit programs yet!\n");
+    if (*top_n != 0) {
+        bool symbols = *display_symtab || !*display_sections;
+        display_top(rest_argv, rest_argc, *top_n, symbols, *display_sections);
         return;
     }
 
-    string_t shstrtab = jingle_read_shstrtab(file);
-    Jingle_Symtab symtab = jingle_read_symtab(file);
-
-    /// Display the symbol table
-    if (*display_symtab) {
-        printf("\nSymbol table '%s' contains %lu entries:\n", &shstrtab.data[symtab.sh_name], symtab.count);
-        printf("        Value Size    Type   Bind       Vis    Ndx Name\n");
-        for (size_t i = 0; i < symtab.count; ++i) {
-            printf("[%2lu] ", i);
-            Elf64_Sym sym = symtab.data[i];
-            jingle_print_symbol(&sym, stdout);
-            if (ELF64_ST_TYPE(sym.st_info) == STT_SECTION) {
-                /// If the symbol type is SECTION, the name can be found from the section itself
-                Elf64_Shdr *sh = ELF64_SHDR(file.data, sym.st_shndx);
-                printf("%s\n", &shstrtab.data[sh->sh_name]);
-            } else {
-                printf("%s\n", &symtab.names[sym.st_name]);
-            }
+    if (*bytes_pattern != NULL) {
+        Jingle_Section_Filter filter;
+        if (!jingle_section_filter_parse(&filter, *section_type, *section_flags)) {
+            fprintf(stderr, "[ERROR] Invalid section filter\n");
+            exit(1);
         }
+        display_bytes_matches(rest_argv, rest_argc, *bytes_pattern, &filter);
+        return;
     }
 
-    /// Display the relocation entries
-    if (*display_reloc) {
-        Jingle_Rela relatab = jingle_read_rela(file);
+    if (*name_pattern != NULL) {
+        display_name_matches(rest_argv, rest_argc, *name_pattern);
+        return;
+    }
 
-        printf("\nRelocation table '%s' contains %lu entries:\n", &shstrtab.data[relatab.sh_name], relatab.count);
-        printf("     Offset           Type            Value\n");
-        for (size_t i = 0; i < relatab.count; ++i) {
-            printf("[%2lu] ", i);
-            Elf64_Rela rela = relatab.data[i];
-            jingle_print_rela(&rela, file, shstrtab, symtab, stdout);
+    if (*format != NULL) {
+        if (strcmp(*format, "nm") == 0) {
+            display_format(rest_argv, rest_argc, FORMAT_NM, false, false, false, false);
+        } else if (strcmp(*format, "readelf") == 0) {
+            if (!*display_file_header && !*display_sections && !*display_reloc && !*display_symtab) {
+                fprintf(stderr, "[ERROR] -format readelf needs at least one of -header, -sections, -reloc and -syms\n");
+                exit(1);
+            }
+            display_format(rest_argv, rest_argc, FORMAT_READELF, *display_file_header, *display_sections, *display_reloc, *display_symtab);
+        } else {
+            fprintf(stderr, "[ERROR] Unknown format '%s', expected readelf or nm\n", *format);
+            exit(1);
         }
+        return;
     }
 
-    /// Display the ELF header
-    Elf64_Ehdr *eh = ELF64_EHDR(file.data);
-    if (*display_file_header) jingle_print_elf_header(eh, file, stdout);
+    for (int fi = 0; fi < rest_argc; ++fi) {
+        char *input_file = rest_argv[fi];
 
-    /// Display the section headers
-    if (*display_sections) {
-        printf("\nSection header table contains %d entries:\n", eh->e_shnum);
-        printf("     Type     Flags Offset   Size     Name\n");
-        for (size_t i = 0; i < eh->e_shnum; ++i) {
-            Elf64_Shdr *sh = ELF64_SHDR(file.data, i);
-            fprintf(stdout, "[%2zu] ", i);
-            jingle_print_section_header(sh, shstrtab, stdout);
+        Jingle_File jf;
+        if (!jingle_open(&jf, input_file)) {
+            exit(1);
         }
-    }
 
-    /// Display the contents of a specific section
-    if (*display_contents != 0) {
-        Elf64_Shdr *sh = ELF64_SHDR(file.data, *display_contents);
-        printf("\nContents of section '%s':\n", &shstrtab.data[sh->sh_name]);
-        if (sh->sh_type == SHT_STRTAB) {
-            print_chars(file.data + sh->sh_offset, sh->sh_size, stdout);
-        } else {
-            printb(file.data, sh->sh_offset, sh->sh_size);
+        string_t file = jf.file;
+        if (rest_argc > 1) printf("\nFile: %s\n", input_file);
+        printf("[INFO] Read %zu bytes from '%s'\n", file.count, input_file);
+
+        if (!jingle_is_elf(file)) {
+            fprintf(stderr, "[ERROR] '%s' is not a valid ELF file (doesn't start with magic number 0x7f E L F)\n", input_file);
+            exit(1);
         }
-    }
 
-    if (file.data != NULL) {
-        free(file.data);
-    }
+        if (!jingle_verify(&jf)) {
+            fprintf(stderr, "[ERROR] '%s' is malformed: %s\n", input_file, jf.error);
+            jingle_close(&jf);
+            continue;
+        }
+
+        string_t shstrtab = jingle_read_shstrtab(&jf);
+        Jingle_Symtab symtab = jingle_read_symtab(&jf);
+        const char **names = jingle_symbol_names(&jf, shstrtab, symtab);
+
+        /// Display the symbol table
+        if (*display_symtab) {
+            printf("\nSymbol table '%s' contains %lu entries:\n", &shstrtab.data[symtab.sh_name], symtab.count);
+            printf("        Value Size    Type   Bind       Vis    Ndx Name\n");
+            for (size_t i = 0; i < symtab.count; ++i) {
+                printf("[%2lu] ", i);
+                jingle_print_symbol(&symtab.data[i], stdout);
+                /// Section symbols are named after the section itself
+                printf("%s\n", names[i]);
+            }
+        }
+
+        /// Display the relocation entries
+        if (*display_reloc) {
+            Jingle_Rela relatab = jingle_read_rela(&jf);
+            Jingle_Rel reltab = jingle_read_rel(&jf);
+            const Jingle_Reloc_Arch *arch = jingle_reloc_arch(jf.ehdr->e_machine);
+
+            if (relatab.count == 0 && reltab.count > 0) {
+                printf("\nRelocation table '%s' contains %lu entries:\n", &shstrtab.data[reltab.sh_name], reltab.count);
+                printf("     Offset           Type            Value\n");
+                for (size_t i = 0; i < reltab.count; ++i) {
+                    printf("[%2lu] ", i);
+                    jingle_print_rel(&reltab.data[i], arch, names, symtab.count, stdout);
+                }
+            } else {
+                printf("\nRelocation table '%s' contains %lu entries:\n", &shstrtab.data[relatab.sh_name], relatab.count);
+                printf("     Offset           Type            Value\n");
+                for (size_t i = 0; i < relatab.count; ++i) {
+                    printf("[%2lu] ", i);
+                    Elf64_Rela rela = relatab.data[i];
+                    jingle_print_rela(&rela, arch, names, symtab.count, stdout);
+                }
+            }
+        }
+
+        /// Display the ELF header
+        Elf64_Ehdr *eh = jf.ehdr;
+        if (*display_file_header) jingle_print_elf_header(eh, file, stdout);
+
+        /// Display the section headers
+        if (*display_sections) {
+            printf("\nSection header table contains %d entries:\n", eh->e_shnum);
+            printf("     Type     Flags Offset   Size     Name\n");
+            for (size_t i = 0; i < eh->e_shnum; ++i) {
+                Elf64_Shdr *sh = &jf.shdrs[i];
+                fprintf(stdout, "[%2zu] ", i);
+                jingle_print_section_header(sh, shstrtab, stdout);
+            }
+        }
+
+        /// Display the contents of a specific section
+        if (*display_contents != 0 && *display_contents >= eh->e_shnum) {
+            fprintf(stderr, "[ERROR] '%s' has no section %lu\n", input_file, *display_contents);
+        } else if (*display_contents != 0) {
+            Elf64_Shdr *sh = &jf.shdrs[*display_contents];
+            string_t data = jingle_section_data(&jf, *display_contents);
+            printf("\nContents of section '%s':\n", &shstrtab.data[sh->sh_name]);
+            if ((sh->sh_flags & SHF_EXECINSTR) && eh->e_machine == EM_X86_64) {
+                print_disasm(&jf, *display_contents, symtab, names);
+            } else if (sh->sh_type == SHT_STRTAB) {
+                print_chars(data.data, data.count, stdout);
+            } else {
+                printb(data.data, 0, data.count);
+            }
+        }
+
+        /// Disassemble every executable section
+        if (*display_disasm && eh->e_machine != EM_X86_64) {
+            fprintf(stderr, "[WARN] '%s': can only disassemble x86-64, not machine %u\n", input_file, eh->e_machine);
+        } else if (*display_disasm) {
+            for (size_t i = 1; i < eh->e_shnum; ++i) {
+                Elf64_Shdr *sh = &jf.shdrs[i];
+                if (!(sh->sh_flags & SHF_EXECINSTR) || sh->sh_type == SHT_NULL || sh->sh_type == SHT_NOBITS || sh->sh_size == 0) continue;
+                printf("\nDisassembly of section '%s':\n", &shstrtab.data[sh->sh_name]);
+                print_disasm(&jf, i, symtab, names);
+            }
+        }
 
-    if (f) {
-        fclose(f);
+        free(names);
+        jingle_close(&jf);
     }
 }
 
@@ -7,6 +7,15 @@
 #include <errno.h>
 #include <assert.h>
 
+// Where every buffer here comes from and goes back to; define both before the first include to use another allocator
+#if defined(STRING_T_REALLOC) != defined(STRING_T_FREE)
+#error "You must define both STRING_T_REALLOC and STRING_T_FREE, or neither."
+#endif
+#ifndef STRING_T_REALLOC
+#define STRING_T_REALLOC(ptr, size) realloc(ptr, size)
+#define STRING_T_FREE(ptr) free(ptr)
+#endif
+
 typedef struct {
     char  *data;
     size_t count;
@@ -52,6 +61,7 @@ int readall(FILE *in, char **dataptr, size_t *sizeptr);
 
 #ifdef STRING_T_IMPLEMENTATION
 
+
 string_t
 string_from_file(FILE *stream)
 {
@@ -88,17 +98,20 @@ string_t
 string_alloc(size_t n)
 {
     string_t s;
-    s.data = calloc(n, 1); // TODO: allow user to change what alloc() is used
+    s.data = STRING_T_REALLOC(NULL, n);
+    if (s.data != NULL) memset(s.data, 0, n);
     s.count = 0;
+    s.capacity = n;
     return s;
 }
 
 void
 string_free(string_t *s)
 {
-    if (s->data != NULL) free(s->data);
+    if (s->data != NULL) STRING_T_FREE(s->data);
     s->data = NULL;
     s->count = 0;
+    s->capacity = 0;
 }
 
 size_t
@@ -117,7 +130,7 @@ string_grow(string_t *s, size_t addlen, size_t min_cap)
     else if (min_cap < 4)
         min_cap = 4;
 
-    char *new_ptr = realloc(s->data, min_cap);
+    char *new_ptr = STRING_T_REALLOC(s->data, min_cap);
     if (new_ptr == NULL) {
         // Not enough memory to realloc()
         fprintf(stderr, "[ERROR] Not enough memory to allocate %lu bytes\n", addlen);
@@ -202,13 +215,13 @@ readall(FILE *in, char **dataptr, size_t *sizeptr)
             /* Overflow check. Some ANSI C compilers
                may optimize this away, though. */
             if (size <= used) {
-                free(data);
+                STRING_T_FREE(data);
                 return READALL_TOOMUCH;
             }
 
-            temp = realloc(data, size);
+            temp = STRING_T_REALLOC(data, size);
             if (temp == NULL) {
-                free(data);
+                STRING_T_FREE(data);
                 return READALL_NOMEM;
             }
             data = temp;
@@ -222,13 +235,13 @@ readall(FILE *in, char **dataptr, size_t *sizeptr)
     }
 
     if (ferror(in)) {
-        free(data);
+        STRING_T_FREE(data);
         return READALL_ERROR;
     }
 
-    temp = realloc(data, used + 1);
+    temp = STRING_T_REALLOC(data, used + 1);
     if (temp == NULL) {
-        free(data);
+        STRING_T_FREE(data);
         return READALL_NOMEM;
     }
     data = temp;